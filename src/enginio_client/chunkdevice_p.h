@@ -35,6 +35,7 @@
 **
 ****************************************************************************/
 
+#include "enginioclient_global.h"
 #include <QtCore/qiodevice.h>
 
 /*!
@@ -45,7 +46,7 @@
   \internal
 */
 
-class ChunkDevice : public QIODevice
+class ENGINIOCLIENT_EXPORT ChunkDevice : public QIODevice
 {
     Q_OBJECT
 
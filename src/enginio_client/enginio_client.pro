@@ -19,10 +19,16 @@ SOURCES += \
     enginioclient.cpp \
     enginioreply.cpp \
     enginiomodel.cpp \
+    enginiomodeljournal.cpp \
+    enginiosortfilterproxymodel.cpp \
     enginioidentity.cpp \
+    enginiometrics.cpp \
+    enginioquery.cpp \
     enginiofakereply.cpp \
     enginiodummyreply.cpp \
-    enginiostring.cpp
+    enginioscheduledreply.cpp \
+    enginiostring.cpp \
+    enginiotimestamp.cpp
 
 HEADERS += \
     chunkdevice_p.h \
@@ -32,10 +38,21 @@ HEADERS += \
     enginioclient_p.h \
     enginioreply.h \
     enginiomodel.h \
+    enginiomodelattacheddata_p.h \
+    enginiomodeljournal_p.h \
+    enginiosortfilterproxymodel.h \
     enginioidentity.h \
+    enginiometrics.h \
+    enginiometrics_p.h \
     enginioobjectadaptor_p.h \
+    enginioquery.h \
+    enginioquery_p.h \
+    enginioqueryencoder_p.h \
     enginioreply_p.h \
+    enginiorequestdatabuffer_p.h \
     enginiofakereply_p.h \
     enginiodummyreply_p.h \
-    enginiostring_p.h
+    enginioscheduledreply_p.h \
+    enginiostring_p.h \
+    enginiotimestamp_p.h
 
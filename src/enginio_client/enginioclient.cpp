@@ -42,6 +42,8 @@
 #include "enginioidentity.h"
 
 #include <QtCore/qthreadstorage.h>
+#include <QtCore/qendian.h>
+#include <QtCore/qfileinfo.h>
 #include <QtNetwork/qnetworkaccessmanager.h>
 #include <QtNetwork/qnetworkreply.h>
 
@@ -161,7 +163,9 @@
     \sa authenticationState
 */
 
-ENGINIOCLIENT_EXPORT bool gEnableEnginioDebugInfo = !qEnvironmentVariableIsSet("ENGINIO_DEBUG_INFO");
+// Request payloads are kept for EnginioReply::dumpDebugInfo() only if ENGINIO_DEBUG_INFO is set,
+// ENGINIO_DEBUG_INFO=n keeps the payload of every n-th request.
+ENGINIOCLIENT_EXPORT bool gEnableEnginioDebugInfo = qEnvironmentVariableIsSet("ENGINIO_DEBUG_INFO");
 
 EnginioClientPrivate::EnginioClientPrivate(EnginioClient *client) :
     q_ptr(client),
@@ -169,12 +173,39 @@ EnginioClientPrivate::EnginioClientPrivate(EnginioClient *client) :
     _serviceUrl(EnginioString::apiEnginIo),
     _networkManager(),
     _uploadChunkSize(512 * 1024),
-    _authenticationState(EnginioClient::NotAuthenticated)
+    _downloadSegmentSize(4 * 1024 * 1024),
+    _downloadSegmentCount(4),
+    _maxQueryUrlSize(0),
+    _requestQueueTimer(),
+    _maxAttempts(1),
+    _retryDelay(500),
+    _retryPolicy(EnginioClient::RetryIdempotentOperations),
+    _requestTimeout(0),
+    _deadlineTimer(),
+    _compressionThreshold(0),
+    _authenticationState(EnginioClient::NotAuthenticated),
+    _metrics()
 {
     assignNetworkManager();
 
+    // QNetworkAccessManager opens up to 6 connections per host, keep some of them for interactive requests
+    static const int maxRunning[RequestClassCount] = {0, 2, 3};
+    for (int i = 0; i < RequestClassCount; ++i) {
+        _requestQueues[i].running = 0;
+        _requestQueues[i].maxRunning = maxRunning[i];
+        _requestQueues[i].maxBytesPerSecond = 0;
+        _requestQueues[i].nextStart = 0;
+    }
+
     _request.setHeader(QNetworkRequest::ContentTypeHeader,
                           QStringLiteral("application/json"));
+    // Accept-Encoding is left to QNetworkAccessManager, which asks for gzip and deflate and decodes
+    // the response while it arrives, so readyRead() delivers plain JSON. Setting it turns that off.
+
+    if (Q_UNLIKELY(gEnableEnginioDebugInfo)) {
+        const int sampleRate = qgetenv("ENGINIO_DEBUG_INFO").toInt();
+        _requestData.setLimits(32, 4 * 1024, 64 * 1024, sampleRate);
+    }
 }
 
 void EnginioClientPrivate::init()
@@ -184,6 +215,9 @@ void EnginioClientPrivate::init()
     qRegisterMetaType<EnginioReply*>();
     qRegisterMetaType<EnginioIdentity*>();
     qRegisterMetaType<EnginioBasicAuthentication*>();
+    qRegisterMetaType<EnginioMetrics*>();
+
+    _metrics = EnginioMetricsPrivate::get(new EnginioMetrics(q_ptr));
 
     QObject::connect(q_ptr, &EnginioClient::sessionTerminated, AuthenticationStateTrackerFunctor(this));
     QObject::connect(q_ptr, &EnginioClient::sessionAuthenticated, AuthenticationStateTrackerFunctor(this, EnginioClient::Authenticated));
@@ -198,6 +232,17 @@ void EnginioClientPrivate::replyFinished(QNetworkReply *nreply)
     if (!ereply)
         return;
 
+    if (Q_UNLIKELY(_metrics->isEnabled())) {
+        // a download writes the data to the device, there is nothing to parse
+        _metrics->requestFinished(nreply, ereply, !_downloads.contains(nreply));
+    }
+
+    if (Q_UNLIKELY(_downloadUrlRequests.contains(nreply)))
+        cacheDownloadUrl(nreply, _downloadUrlRequests.take(nreply));
+
+    if (_downloads.contains(nreply) && !downloadFinished(ereply, nreply))
+        return;
+
     if (nreply->error() != QNetworkReply::NoError) {
         QPair<QIODevice *, qint64> deviceState = _chunkedUploads.take(nreply);
         delete deviceState.first;
@@ -212,6 +257,8 @@ void EnginioClientPrivate::replyFinished(QNetworkReply *nreply)
         if (status == EnginioString::empty || status == EnginioString::incomplete) {
             Q_ASSERT(ereply->data().value(EnginioString::objectType).toString() == EnginioString::files);
             uploadChunk(ereply, deviceState.first, deviceState.second);
+            if (Q_UNLIKELY(_pendingAttachments.contains(nreply)))
+                _pendingAttachments.insert(ereply->d->_nreply, _pendingAttachments.take(nreply));
             return;
         }
         // should never get here unless upload was successful
@@ -222,6 +269,12 @@ void EnginioClientPrivate::replyFinished(QNetworkReply *nreply)
         }
     }
 
+    if (Q_UNLIKELY(_pendingAttachments.contains(nreply)) && continueCreateWithFile(ereply, nreply))
+        return;
+
+    if (ereply->d->_deadline)
+        setDeadline(ereply, 0);
+
     if (Q_UNLIKELY(ereply->delayFinishedSignal())) {
         // delay emittion of finished signal for autotests
         _delayedReplies.insert(ereply);
@@ -229,7 +282,7 @@ void EnginioClientPrivate::replyFinished(QNetworkReply *nreply)
         ereply->dataChanged();
         ereply->emitFinished();
         q_ptr->finished(ereply);
-        if (gEnableEnginioDebugInfo)
+        if (Q_UNLIKELY(gEnableEnginioDebugInfo))
             _requestData.remove(nreply);
     }
 
@@ -249,7 +302,7 @@ bool EnginioClientPrivate::finishDelayedReplies()
                 reply->dataChanged();
                 reply->emitFinished();
                 q_ptr->finished(reply);
-                if (gEnableEnginioDebugInfo)
+                if (Q_UNLIKELY(gEnableEnginioDebugInfo))
                     _requestData.remove(reply->d->_nreply); // FIXME it is ugly, and breaks encapsulation
                 _delayedReplies.remove(reply);
                 needToReevaluate = true;
@@ -259,8 +312,639 @@ bool EnginioClientPrivate::finishDelayedReplies()
     return !_delayedReplies.isEmpty();
 }
 
+bool EnginioClientPrivate::continueCreateWithFile(EnginioReply *ereply, QNetworkReply *nreply)
+{
+    PendingAttachment attachment = _pendingAttachments.take(nreply);
+    if (nreply->error() != QNetworkReply::NoError) {
+        if (!attachment.object.isEmpty()) {
+            // the upload failed, do not leave the object behind without its file
+            QJsonObject object;
+            object[EnginioString::id] = attachment.object[EnginioString::id];
+            object[EnginioString::objectType] = attachment.object[EnginioString::objectType];
+            QNetworkReply *reply = remove<QJsonObject>(object, attachment.operation);
+            QObject::connect(reply, &QNetworkReply::finished, reply, &QObject::deleteLater);
+        }
+        return false;
+    }
+
+    if (!attachment.object.isEmpty()) {
+        // the file is uploaded, report the created object together with the file
+        attachment.object[attachment.propertyName] = ereply->data();
+        QByteArray data = QJsonDocument(attachment.object).toJson(QJsonDocument::Compact);
+        ereply->setNetworkReply(new EnginioFakeReply(this, data, 200));
+        return true;
+    }
+
+    // the object id is known, start the upload right away
+    attachment.object = ereply->data();
+
+    QJsonObject target;
+    target[EnginioString::id] = attachment.object[EnginioString::id];
+    target[EnginioString::objectType] = attachment.object[EnginioString::objectType];
+    target[EnginioString::propertyName] = attachment.propertyName;
+
+    QJsonObject file;
+    QString path = attachment.file.isLocalFile() ? attachment.file.toLocalFile() : attachment.file.path();
+    file[EnginioString::fileName] = QFileInfo(path).fileName();
+
+    QJsonObject object;
+    object[EnginioString::targetFileProperty] = target;
+    object[EnginioString::file] = file;
+
+    QNetworkReply *reply = uploadFile<QJsonObject>(object, attachment.file);
+    ereply->setNetworkReply(reply);
+    _pendingAttachments.insert(reply, attachment);
+    return true;
+}
+
+void EnginioClientPrivate::cacheDownloadUrl(QNetworkReply *nreply, const DownloadUrlKey &key)
+{
+    if (nreply->error() != QNetworkReply::NoError)
+        return;
+
+    // peek, so the content is still available for the EnginioReply
+    const QByteArray data = nreply->peek(nreply->bytesAvailable());
+    const QJsonObject object = QJsonDocument::fromJson(data).object();
+    const QDateTime expiresAt = QDateTime::fromString(object[EnginioString::expiresAt].toString(), Qt::ISODate);
+    if (!expiresAt.isValid())
+        return;
+
+    if (_downloadUrls.count() >= DownloadUrlCacheLimit) {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        QHash<DownloadUrlKey, QPair<QByteArray, qint64> >::iterator i = _downloadUrls.begin();
+        while (i != _downloadUrls.end()) {
+            if (i->second <= now + DownloadUrlExpirationMargin)
+                i = _downloadUrls.erase(i);
+            else
+                ++i;
+        }
+        if (_downloadUrls.count() >= DownloadUrlCacheLimit)
+            _downloadUrls.clear();
+    }
+    _downloadUrls.insert(key, qMakePair(data, expiresAt.toMSecsSinceEpoch()));
+}
+
+QNetworkReply *EnginioClientPrivate::sendRequest(QNetworkAccessManager::Operation operation, const QNetworkRequest &request, const QByteArray &data,
+                                                 QIODevice *body, QHttpMultiPart *multiPart, RequestClass requestClass, qint64 transferSize)
+{
+    // requests waiting in QNetworkAccessManager are ordered by the priority too
+    static const QNetworkRequest::Priority priorities[RequestClassCount] = {
+        QNetworkRequest::HighPriority,
+        QNetworkRequest::NormalPriority,
+        QNetworkRequest::LowPriority
+    };
+
+    QNetworkRequest req(request);
+    req.setPriority(priorities[requestClass]);
+
+    // a repeated request needs the scheduled reply to keep the same reply for all attempts
+    const bool retryable = _maxAttempts > 1 && !multiPart && (!body || !body->isSequential())
+            && (_retryPolicy == EnginioClient::RetryAllOperations || isIdempotent(operation, req));
+
+    if (!retryable && canStartRequest(requestClass)) {
+        QNetworkReply *reply = startRequest(operation, req, data, body, multiPart, requestClass, transferSize);
+        if (Q_UNLIKELY(_metrics->isEnabled())) {
+            _metrics->requestQueued(reply);
+            _metrics->requestSent(reply, transferSize);
+        }
+        return reply;
+    }
+
+    EnginioScheduledReply *reply = new EnginioScheduledReply(this, operation, req, data, body, multiPart, requestClass, transferSize);
+    reply->setRetryable(retryable);
+    if (Q_UNLIKELY(_metrics->isEnabled()))
+        _metrics->requestQueued(reply);
+    scheduleRequest(reply);
+    return reply;
+}
+
+void EnginioClientPrivate::scheduleRequest(EnginioScheduledReply *reply)
+{
+    RequestClass requestClass = RequestClass(reply->requestClass());
+    if (canStartRequest(requestClass)) {
+        reply->setNetworkReply(startRequest(reply->operation(), reply->request(), reply->data(), reply->body(),
+                                            reply->multiPart(), requestClass, reply->transferSize()));
+        if (Q_UNLIKELY(_metrics->isEnabled()))
+            _metrics->requestSent(reply, reply->transferSize());
+        return;
+    }
+    _requestQueues[requestClass].pending.enqueue(reply);
+    processRequestQueues();
+}
+
+bool EnginioClientPrivate::isIdempotent(QNetworkAccessManager::Operation operation, const QNetworkRequest &request)
+{
+    switch (operation) {
+    case QNetworkAccessManager::HeadOperation:
+    case QNetworkAccessManager::GetOperation:
+    case QNetworkAccessManager::PutOperation:
+    case QNetworkAccessManager::DeleteOperation:
+        return true;
+    case QNetworkAccessManager::CustomOperation: {
+        const QByteArray verb = request.attribute(QNetworkRequest::CustomVerbAttribute).toByteArray();
+        return verb == "GET" || verb == "PUT" || verb == "DELETE" || verb == "HEAD";
+    }
+    case QNetworkAccessManager::PostOperation:
+        // a query sent in the body
+        return request.rawHeader("X-HTTP-Method-Override") == "GET";
+    default:
+        return false;
+    }
+}
+
+bool EnginioClientPrivate::canStartRequest(RequestClass requestClass) const
+{
+    for (int i = InteractiveRequest; i <= requestClass; ++i) {
+        if (!_requestQueues[i].pending.isEmpty())
+            return false;
+    }
+    const RequestQueue &queue = _requestQueues[requestClass];
+    if (queue.maxRunning && queue.running >= queue.maxRunning)
+        return false;
+    return !queue.maxBytesPerSecond || queue.nextStart <= QDateTime::currentMSecsSinceEpoch();
+}
+
+QNetworkReply *EnginioClientPrivate::startRequest(QNetworkAccessManager::Operation operation, const QNetworkRequest &req, const QByteArray &data,
+                                                  QIODevice *body, QHttpMultiPart *multiPart, RequestClass requestClass, qint64 transferSize)
+{
+    RequestQueue &queue = _requestQueues[requestClass];
+    ++queue.running;
+    if (queue.maxBytesPerSecond) {
+        // the next request of the class may start when this one would be transferred at the given rate
+        queue.nextStart = qMax(queue.nextStart, QDateTime::currentMSecsSinceEpoch())
+                + transferSize * 1000 / queue.maxBytesPerSecond;
+    }
+
+    QNetworkReply *reply = 0;
+    switch (operation) {
+    case QNetworkAccessManager::GetOperation:
+        reply = networkManager()->get(req);
+        break;
+    case QNetworkAccessManager::PutOperation:
+        reply = body ? networkManager()->put(req, body) : networkManager()->put(req, data);
+        break;
+    case QNetworkAccessManager::PostOperation:
+        if (multiPart)
+            reply = networkManager()->post(req, multiPart);
+        else
+            reply = body ? networkManager()->post(req, body) : networkManager()->post(req, data);
+        break;
+    case QNetworkAccessManager::DeleteOperation:
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+        if (!data.isEmpty()) {
+            reply = networkManager()->deleteResource(req, data);
+            break;
+        }
+#endif
+        reply = networkManager()->deleteResource(req);
+        break;
+    case QNetworkAccessManager::CustomOperation:
+        reply = networkManager()->sendCustomRequest(req, req.attribute(QNetworkRequest::CustomVerbAttribute).toByteArray(), body);
+        break;
+    default:
+        Q_UNREACHABLE();
+    }
+
+    RunningRequest running;
+    running.requestClass = requestClass;
+    running.finished = QObject::connect(reply, &QNetworkReply::finished, RequestFinishedFunctor(this, reply));
+    // a reply may be deleted before it is finished
+    running.destroyed = QObject::connect(reply, &QNetworkReply::destroyed, RequestFinishedFunctor(this, reply));
+    _runningRequests.insert(reply, running);
+    return reply;
+}
+
+void EnginioClientPrivate::requestFinished(QNetworkReply *nreply)
+{
+    QHash<QNetworkReply*, RunningRequest>::iterator i = _runningRequests.find(nreply);
+    if (i == _runningRequests.end())
+        return;
+    QObject::disconnect(i->finished);
+    QObject::disconnect(i->destroyed);
+    --_requestQueues[i->requestClass].running;
+    _runningRequests.erase(i);
+    processRequestQueues();
+}
+
+void EnginioClientPrivate::processRequestQueues()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (int i = InteractiveRequest; i < RequestClassCount; ++i) {
+        RequestQueue &queue = _requestQueues[i];
+        while (!queue.pending.isEmpty()) {
+            EnginioScheduledReply *reply = queue.pending.head();
+            if (!reply || reply->isFinished()) {
+                // deleted or aborted before it was sent
+                queue.pending.dequeue();
+                continue;
+            }
+            if (queue.maxRunning && queue.running >= queue.maxRunning)
+                break;
+            if (queue.maxBytesPerSecond && queue.nextStart > now) {
+                if (!_requestQueueTimer) {
+                    _requestQueueTimer = new QTimer(q_ptr);
+                    _requestQueueTimer->setSingleShot(true);
+                    _connections.append(QObject::connect(_requestQueueTimer, &QTimer::timeout, ProcessRequestQueuesFunctor(this)));
+                }
+                if (!_requestQueueTimer->isActive() || _requestQueueTimer->remainingTime() > queue.nextStart - now)
+                    _requestQueueTimer->start(queue.nextStart - now);
+                break;
+            }
+            queue.pending.dequeue();
+            reply->setNetworkReply(startRequest(reply->operation(), reply->request(), reply->data(), reply->body(),
+                                                reply->multiPart(), RequestClass(reply->requestClass()), reply->transferSize()));
+            if (Q_UNLIKELY(_metrics->isEnabled()))
+                _metrics->requestSent(reply, reply->transferSize());
+        }
+        // less important requests yield to the waiting ones
+        if (!queue.pending.isEmpty())
+            return;
+    }
+}
+
+void EnginioClientPrivate::setDeadline(EnginioReply *ereply, qint64 deadline)
+{
+    qint64 &current = ereply->d->_deadline;
+    if (current)
+        _deadlines.remove(current, ereply);
+    current = ereply->isFinished() ? 0 : deadline;
+    if (current)
+        _deadlines.insert(current, ereply);
+
+    if (_deadlines.isEmpty()) {
+        if (_deadlineTimer)
+            _deadlineTimer->stop();
+        return;
+    }
+    if (!_deadlineTimer) {
+        _deadlineTimer = new QTimer(q_ptr);
+        _deadlineTimer->setSingleShot(true);
+        _connections.append(QObject::connect(_deadlineTimer, &QTimer::timeout, ProcessDeadlinesFunctor(this)));
+    }
+    _deadlineTimer->start(qMax(qint64(0), _deadlines.firstKey() - QDateTime::currentMSecsSinceEpoch()));
+}
+
+void EnginioClientPrivate::processDeadlines()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    while (!_deadlines.isEmpty() && _deadlines.firstKey() <= now) {
+        QPointer<EnginioReply> ereply = _deadlines.take(_deadlines.firstKey());
+        if (!ereply || ereply->isFinished())
+            continue;
+        ereply->d->_deadline = 0;
+        ereply->d->_timedOut = true;
+        // a waiting chunk or segment is dropped from the request queue as well
+        ereply->d->_nreply->abort();
+    }
+    if (!_deadlines.isEmpty())
+        _deadlineTimer->start(qMax(qint64(0), _deadlines.firstKey() - now));
+}
+
+// http://tools.ietf.org/html/rfc1952#section-8, constant so that clients in several threads can share it
+static const quint32 crc32Table[256] = {
+    0x00000000u, 0x77073096u, 0xee0e612cu, 0x990951bau, 0x076dc419u, 0x706af48fu,
+    0xe963a535u, 0x9e6495a3u, 0x0edb8832u, 0x79dcb8a4u, 0xe0d5e91eu, 0x97d2d988u,
+    0x09b64c2bu, 0x7eb17cbdu, 0xe7b82d07u, 0x90bf1d91u, 0x1db71064u, 0x6ab020f2u,
+    0xf3b97148u, 0x84be41deu, 0x1adad47du, 0x6ddde4ebu, 0xf4d4b551u, 0x83d385c7u,
+    0x136c9856u, 0x646ba8c0u, 0xfd62f97au, 0x8a65c9ecu, 0x14015c4fu, 0x63066cd9u,
+    0xfa0f3d63u, 0x8d080df5u, 0x3b6e20c8u, 0x4c69105eu, 0xd56041e4u, 0xa2677172u,
+    0x3c03e4d1u, 0x4b04d447u, 0xd20d85fdu, 0xa50ab56bu, 0x35b5a8fau, 0x42b2986cu,
+    0xdbbbc9d6u, 0xacbcf940u, 0x32d86ce3u, 0x45df5c75u, 0xdcd60dcfu, 0xabd13d59u,
+    0x26d930acu, 0x51de003au, 0xc8d75180u, 0xbfd06116u, 0x21b4f4b5u, 0x56b3c423u,
+    0xcfba9599u, 0xb8bda50fu, 0x2802b89eu, 0x5f058808u, 0xc60cd9b2u, 0xb10be924u,
+    0x2f6f7c87u, 0x58684c11u, 0xc1611dabu, 0xb6662d3du, 0x76dc4190u, 0x01db7106u,
+    0x98d220bcu, 0xefd5102au, 0x71b18589u, 0x06b6b51fu, 0x9fbfe4a5u, 0xe8b8d433u,
+    0x7807c9a2u, 0x0f00f934u, 0x9609a88eu, 0xe10e9818u, 0x7f6a0dbbu, 0x086d3d2du,
+    0x91646c97u, 0xe6635c01u, 0x6b6b51f4u, 0x1c6c6162u, 0x856530d8u, 0xf262004eu,
+    0x6c0695edu, 0x1b01a57bu, 0x8208f4c1u, 0xf50fc457u, 0x65b0d9c6u, 0x12b7e950u,
+    0x8bbeb8eau, 0xfcb9887cu, 0x62dd1ddfu, 0x15da2d49u, 0x8cd37cf3u, 0xfbd44c65u,
+    0x4db26158u, 0x3ab551ceu, 0xa3bc0074u, 0xd4bb30e2u, 0x4adfa541u, 0x3dd895d7u,
+    0xa4d1c46du, 0xd3d6f4fbu, 0x4369e96au, 0x346ed9fcu, 0xad678846u, 0xda60b8d0u,
+    0x44042d73u, 0x33031de5u, 0xaa0a4c5fu, 0xdd0d7cc9u, 0x5005713cu, 0x270241aau,
+    0xbe0b1010u, 0xc90c2086u, 0x5768b525u, 0x206f85b3u, 0xb966d409u, 0xce61e49fu,
+    0x5edef90eu, 0x29d9c998u, 0xb0d09822u, 0xc7d7a8b4u, 0x59b33d17u, 0x2eb40d81u,
+    0xb7bd5c3bu, 0xc0ba6cadu, 0xedb88320u, 0x9abfb3b6u, 0x03b6e20cu, 0x74b1d29au,
+    0xead54739u, 0x9dd277afu, 0x04db2615u, 0x73dc1683u, 0xe3630b12u, 0x94643b84u,
+    0x0d6d6a3eu, 0x7a6a5aa8u, 0xe40ecf0bu, 0x9309ff9du, 0x0a00ae27u, 0x7d079eb1u,
+    0xf00f9344u, 0x8708a3d2u, 0x1e01f268u, 0x6906c2feu, 0xf762575du, 0x806567cbu,
+    0x196c3671u, 0x6e6b06e7u, 0xfed41b76u, 0x89d32be0u, 0x10da7a5au, 0x67dd4accu,
+    0xf9b9df6fu, 0x8ebeeff9u, 0x17b7be43u, 0x60b08ed5u, 0xd6d6a3e8u, 0xa1d1937eu,
+    0x38d8c2c4u, 0x4fdff252u, 0xd1bb67f1u, 0xa6bc5767u, 0x3fb506ddu, 0x48b2364bu,
+    0xd80d2bdau, 0xaf0a1b4cu, 0x36034af6u, 0x41047a60u, 0xdf60efc3u, 0xa867df55u,
+    0x316e8eefu, 0x4669be79u, 0xcb61b38cu, 0xbc66831au, 0x256fd2a0u, 0x5268e236u,
+    0xcc0c7795u, 0xbb0b4703u, 0x220216b9u, 0x5505262fu, 0xc5ba3bbeu, 0xb2bd0b28u,
+    0x2bb45a92u, 0x5cb36a04u, 0xc2d7ffa7u, 0xb5d0cf31u, 0x2cd99e8bu, 0x5bdeae1du,
+    0x9b64c2b0u, 0xec63f226u, 0x756aa39cu, 0x026d930au, 0x9c0906a9u, 0xeb0e363fu,
+    0x72076785u, 0x05005713u, 0x95bf4a82u, 0xe2b87a14u, 0x7bb12baeu, 0x0cb61b38u,
+    0x92d28e9bu, 0xe5d5be0du, 0x7cdcefb7u, 0x0bdbdf21u, 0x86d3d2d4u, 0xf1d4e242u,
+    0x68ddb3f8u, 0x1fda836eu, 0x81be16cdu, 0xf6b9265bu, 0x6fb077e1u, 0x18b74777u,
+    0x88085ae6u, 0xff0f6a70u, 0x66063bcau, 0x11010b5cu, 0x8f659effu, 0xf862ae69u,
+    0x616bffd3u, 0x166ccf45u, 0xa00ae278u, 0xd70dd2eeu, 0x4e048354u, 0x3903b3c2u,
+    0xa7672661u, 0xd06016f7u, 0x4969474du, 0x3e6e77dbu, 0xaed16a4au, 0xd9d65adcu,
+    0x40df0b66u, 0x37d83bf0u, 0xa9bcae53u, 0xdebb9ec5u, 0x47b2cf7fu, 0x30b5ffe9u,
+    0xbdbdf21cu, 0xcabac28au, 0x53b39330u, 0x24b4a3a6u, 0xbad03605u, 0xcdd70693u,
+    0x54de5729u, 0x23d967bfu, 0xb3667a2eu, 0xc4614ab8u, 0x5d681b02u, 0x2a6f2b94u,
+    0xb40bbe37u, 0xc30c8ea1u, 0x5a05df1bu, 0x2d02ef8du
+};
+
+quint32 EnginioClientPrivate::crc32(const QByteArray &data)
+{
+    quint32 crc = 0xffffffffu;
+    const uchar *begin = reinterpret_cast<const uchar *>(data.constData());
+    const uchar *end = begin + data.size();
+    for (const uchar *c = begin; c != end; ++c)
+        crc = crc32Table[(crc ^ *c) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffu;
+}
+
+QByteArray EnginioClientPrivate::gzip(const QByteArray &data)
+{
+    // qCompress writes the size (4 bytes), the zlib header (2 bytes), the deflate stream
+    // and the adler32 checksum (4 bytes); gzip wraps the same deflate stream differently.
+    const QByteArray zlib = qCompress(data);
+    const int deflateSize = zlib.size() - 4 - 2 - 4;
+    if (Q_UNLIKELY(deflateSize <= 0))
+        return QByteArray();
+
+    // deflate, no flags, no modification time, unknown OS
+    static const char header[10] = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff' };
+    uchar trailer[8];
+    qToLittleEndian<quint32>(crc32(data), trailer);
+    qToLittleEndian<quint32>(quint32(data.size()), trailer + 4);
+
+    QByteArray result;
+    result.reserve(sizeof(header) + deflateSize + sizeof(trailer));
+    result.append(header, sizeof(header));
+    result.append(zlib.constData() + 6, deflateSize);
+    result.append(reinterpret_cast<const char *>(trailer), sizeof(trailer));
+    return result;
+}
+
+static bool parseContentRange(const QByteArray &contentRange, qint64 *first, qint64 *total)
+{
+    // Content-Range: bytes {first}-{last}/{total} or bytes */{total}
+    const int space = contentRange.indexOf(' ');
+    const int dash = contentRange.indexOf('-', space);
+    const int slash = contentRange.lastIndexOf('/');
+    if (space == -1 || slash == -1)
+        return false;
+    bool ok;
+    *total = contentRange.mid(slash + 1).trimmed().toLongLong(&ok);
+    if (!ok)
+        *total = -1;
+    *first = dash == -1 ? -1 : contentRange.mid(space + 1, dash - space - 1).toLongLong(&ok);
+    return ok;
+}
+
+QNetworkReply *EnginioClientPrivate::downloadSegment(EnginioReply *ereply, FileDownload *download)
+{
+    QNetworkRequest req(download->url);
+    // ranges are counted in not encoded bytes
+    req.setRawHeader(QByteArrayLiteral("Accept-Encoding"), QByteArrayLiteral("identity"));
+
+    FileDownload::Segment segment = {download->nextPos, download->nextPos, false};
+    if (download->device->isSequential()) {
+        // a sequential device can be filled only by one stream
+        download->openEnded = true;
+    } else if (download->total == -1 && download->nextPos != download->startPos) {
+        // the server did not tell us the file size, so we ask for the rest in one go
+        req.setRawHeader(QByteArrayLiteral("Range"),
+                         QByteArrayLiteral("bytes=") + QByteArray::number(download->nextPos) + QByteArrayLiteral("-"));
+        download->openEnded = true;
+    } else {
+        qint64 end = download->nextPos + _downloadSegmentSize;
+        if (download->total != -1)
+            end = qMin(end, download->total);
+        req.setRawHeader(QByteArrayLiteral("Range"),
+                         QByteArrayLiteral("bytes=") + QByteArray::number(download->nextPos)
+                         + QByteArrayLiteral("-") + QByteArray::number(end - 1));
+        download->nextPos = end;
+    }
+
+    QNetworkReply *reply = sendRequest(QNetworkAccessManager::GetOperation, req, QByteArray(), 0, 0, BulkRequest, _downloadSegmentSize);
+    segment.readyRead = QObject::connect(reply, &QNetworkReply::readyRead, DownloadReadyReadFunctor(this, reply));
+    download->segments.insert(reply, segment);
+    _downloads.insert(reply, download);
+    registerReply(reply, ereply);
+    return reply;
+}
+
+void EnginioClientPrivate::scheduleDownloadSegments(EnginioReply *ereply, FileDownload *download)
+{
+    if (download->openEnded)
+        return;
+    if (download->total == -1) {
+        if (download->segments.isEmpty())
+            downloadSegment(ereply, download);
+        return;
+    }
+    while (download->segments.count() < _downloadSegmentCount && download->nextPos < download->total)
+        downloadSegment(ereply, download);
+}
+
+void EnginioClientPrivate::downloadReadyRead(QNetworkReply *nreply)
+{
+    FileDownload *download = _downloads.value(nreply);
+    if (!download || !download->segments.contains(nreply))
+        return;
+
+    EnginioReply *ereply = _replyReplyMap.value(nreply);
+    FileDownload::Segment &segment = download->segments[nreply];
+    bool sizeDiscovered = false;
+    if (!segment.started) {
+        segment.started = true;
+        const int status = nreply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status == 206) {
+            qint64 first, total;
+            if (parseContentRange(nreply->rawHeader(QByteArrayLiteral("Content-Range")), &first, &total)) {
+                segment.pos = first;
+                if (download->total == -1 && total != -1) {
+                    download->total = total;
+                    sizeDiscovered = true;
+                }
+            }
+        } else if (status == 200) {
+            // The server ignored the range, the whole file is coming, we will skip
+            // what we had before the download started. The other segments would
+            // write the same data again, so this stream replaces them.
+            if (download->segments.count() > 1) {
+                if (ereply && ereply->d->_nreply != nreply) {
+                    ereply->d->_nreply->deleteLater();
+                    ereply->d->_nreply = nreply;
+                    nreply->setParent(ereply);
+                }
+                abortDownloadSegments(download, nreply);
+            }
+            segment.begin = download->startPos;
+            segment.pos = 0;
+            download->received = 0;
+            download->openEnded = true;
+            const QVariant length = nreply->header(QNetworkRequest::ContentLengthHeader);
+            if (length.isValid())
+                download->total = length.toLongLong();
+        }
+        if (!download->infoPath.isEmpty() && download->total != -1 && !download->info.contains(EnginioString::size)) {
+            // a longer file at the target path cannot be a part of this one
+            download->info[EnginioString::size] = double(download->total);
+            writeDownloadInfo(download->infoPath, download->info);
+        }
+    }
+
+    if (nreply->error() != QNetworkReply::NoError)
+        return;
+
+    const QByteArray data = nreply->readAll();
+    const qint64 skip = qBound(Q_INT64_C(0), segment.begin - segment.pos, qint64(data.size()));
+    segment.pos += skip;
+    if (skip != data.size()) {
+        QIODevice *device = download->device;
+        if (!device->isSequential() && device->pos() != segment.pos)
+            device->seek(segment.pos);
+        const qint64 written = device->write(data.constData() + skip, data.size() - skip);
+        if (written != data.size() - skip) {
+            qWarning() << "Enginio: Writing downloaded data failed:" << device->errorString();
+            nreply->abort();
+            return;
+        }
+        segment.pos += written;
+        download->received += written;
+        if (ereply)
+            emit ereply->progress(download->startPos + download->received, download->total);
+    }
+
+    // Now we know the file size, so the rest can be downloaded in parallel
+    if (sizeDiscovered && ereply)
+        scheduleDownloadSegments(ereply, download);
+}
+
+/*
+  Returns true if the download is over and \a ereply can be finished, false if it still
+  waits for other network replies.
+*/
+bool EnginioClientPrivate::downloadFinished(EnginioReply *ereply, QNetworkReply *nreply)
+{
+    FileDownload *download = _downloads.take(nreply);
+    Q_ASSERT(download);
+
+    if (download->url.isEmpty()) {
+        // the download url request finished
+        if (nreply->error() != QNetworkReply::NoError) {
+            finishDownload(download, false);
+            return true;
+        }
+        download->url = QUrl(ereply->data()[EnginioString::expiringUrl].toString());
+        if (!download->url.isValid() || download->url.isEmpty()) {
+            finishDownload(download, false);
+            ereply->setNetworkReply(new EnginioFakeReply(this, constructErrorMessage(QByteArrayLiteral("Download url could not be resolved"))));
+            return false;
+        }
+        ereply->setNetworkReply(downloadSegment(ereply, download));
+        return false;
+    }
+
+    // the segment data, which were not consumed yet
+    downloadReadyRead(nreply);
+    const FileDownload::Segment segment = download->segments.take(nreply);
+    QObject::disconnect(segment.readyRead);
+
+    if (nreply->error() != QNetworkReply::NoError) {
+        // "416 Requested Range Not Satisfiable" is fine if we already have the whole file
+        qint64 first, total;
+        const bool alreadyComplete = nreply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 416
+                && parseContentRange(nreply->rawHeader(QByteArrayLiteral("Content-Range")), &first, &total)
+                && total == segment.begin;
+        finishDownload(download, alreadyComplete);
+        if (alreadyComplete) {
+            // nothing left to download
+            ereply->setNetworkReply(new EnginioFakeReply(this, QByteArray(), 200));
+            return false;
+        }
+    } else {
+        scheduleDownloadSegments(ereply, download);
+        if (!download->segments.isEmpty()) {
+            if (ereply->d->_nreply == nreply) {
+                // the reply has to point to a running request until the whole download is finished
+                QNetworkReply *running = download->segments.constBegin().key();
+                running->setParent(ereply);
+                ereply->d->_nreply = running;
+                ereply->d->_data = QJsonObject();
+            }
+            nreply->deleteLater();
+            return false;
+        }
+        finishDownload(download, true);
+    }
+
+    if (ereply->d->_nreply != nreply) {
+        ereply->d->_nreply->deleteLater();
+        ereply->d->_nreply = nreply;
+        nreply->setParent(ereply);
+        ereply->d->_data = QJsonObject();
+    }
+    return true;
+}
+
+void EnginioClientPrivate::abortDownloadSegments(FileDownload *download, QNetworkReply *except)
+{
+    QMap<QNetworkReply*, FileDownload::Segment>::iterator i = download->segments.begin();
+    while (i != download->segments.end()) {
+        QNetworkReply *segment = i.key();
+        if (segment == except) {
+            ++i;
+            continue;
+        }
+        QObject::disconnect(i->readyRead);
+        i = download->segments.erase(i);
+        // the segment is not reported as finished
+        _downloads.remove(segment);
+        _replyReplyMap.remove(segment);
+        segment->abort();
+        segment->deleteLater();
+    }
+}
+
+void EnginioClientPrivate::finishDownload(FileDownload *download, bool complete)
+{
+    // abort all segments that may be still running
+    abortDownloadSegments(download, 0);
+
+    if (download->ownsDevice)
+        delete download->device;
+    // an incomplete file is kept with its info, so that the download can be resumed
+    if (complete && !download->infoPath.isEmpty())
+        QFile::remove(download->infoPath);
+    delete download;
+}
+
+QJsonObject EnginioClientPrivate::readDownloadInfo(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly))
+        return QJsonObject();
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+void EnginioClientPrivate::writeDownloadInfo(const QString &path, const QJsonObject &info)
+{
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate) || file.write(QJsonDocument(info).toJson(QJsonDocument::Compact)) == -1)
+        qWarning() << "Enginio: Writing download info failed:" << file.errorString();
+}
+
 EnginioClientPrivate::~EnginioClientPrivate()
 {
+    QSet<FileDownload*> downloads = _downloads.values().toSet();
+    foreach (FileDownload *download, downloads) {
+        foreach (const FileDownload::Segment &segment, download->segments)
+            QObject::disconnect(segment.readyRead);
+        if (download->ownsDevice)
+            delete download->device;
+        delete download;
+    }
+    foreach (const RunningRequest &request, _runningRequests) {
+        QObject::disconnect(request.finished);
+        QObject::disconnect(request.destroyed);
+    }
     foreach (const QMetaObject::Connection &identityConnection, _identityConnections)
         QObject::disconnect(identityConnection);
     foreach (const QMetaObject::Connection &connection, _connections)
@@ -319,6 +1003,8 @@ void EnginioClient::setBackendId(const QByteArray &backendId)
     if (d->_backendId != backendId) {
         d->_backendId = backendId;
         d->_request.setRawHeader("Enginio-Backend-Id", d->_backendId);
+        d->_downloadUrls.clear();
+        d->_requestTemplates.clear();
         emit backendIdChanged(backendId);
     }
 }
@@ -340,10 +1026,331 @@ void EnginioClient::setBackendSecret(const QByteArray &backendSecret)
     if (d->_backendSecret != backendSecret) {
         d->_backendSecret = backendSecret;
         d->_request.setRawHeader("Enginio-Backend-Secret", d->_backendSecret);
+        d->_downloadUrls.clear();
+        d->_requestTemplates.clear();
         emit backendSecretChanged(backendSecret);
     }
 }
 
+/*!
+  \enum EnginioClient::RetryPolicy
+
+  This enum describes which requests are sent again after a transient failure.
+  \value RetryIdempotentOperations Only requests which can be repeated without side effects
+         (query, update, remove and file downloads)
+  \value RetryAllOperations Also requests creating data, which may be stored twice
+
+  \sa maxAttempts
+*/
+
+/*!
+  \property EnginioClient::maxAttempts
+  \brief How many times a request is sent before its failure is reported.
+
+  Requests failing with a transient error, like a lost connection or a 500, 502, 503
+  or 504 response, are sent again after \l retryDelay. Only requests allowed by the
+  \l retryPolicy are repeated and the same EnginioReply is used for all attempts.
+  A request is not repeated if a part of its response was already delivered.
+
+  The default value is 1, which means that no request is repeated.
+*/
+int EnginioClient::maxAttempts() const
+{
+    Q_D(const EnginioClient);
+    return d->_maxAttempts;
+}
+
+void EnginioClient::setMaxAttempts(int maxAttempts)
+{
+    Q_D(EnginioClient);
+    maxAttempts = qMax(1, maxAttempts);
+    if (d->_maxAttempts != maxAttempts) {
+        d->_maxAttempts = maxAttempts;
+        emit maxAttemptsChanged(maxAttempts);
+    }
+}
+
+/*!
+  \property EnginioClient::retryDelay
+  \brief The delay in milliseconds before the first repeated attempt.
+
+  The delay is doubled for each next attempt, up to ten minutes, and a random
+  jitter is applied, so clients failing at the same time do not repeat their
+  requests all at once.
+  The default value is 500.
+
+  \sa maxAttempts
+*/
+int EnginioClient::retryDelay() const
+{
+    Q_D(const EnginioClient);
+    return d->_retryDelay;
+}
+
+void EnginioClient::setRetryDelay(int msecs)
+{
+    Q_D(EnginioClient);
+    msecs = qMax(0, msecs);
+    if (d->_retryDelay != msecs) {
+        d->_retryDelay = msecs;
+        emit retryDelayChanged(msecs);
+    }
+}
+
+/*!
+  \property EnginioClient::retryPolicy
+  \brief Which requests are repeated after a transient failure.
+
+  The default value is RetryIdempotentOperations.
+
+  \sa maxAttempts
+*/
+EnginioClient::RetryPolicy EnginioClient::retryPolicy() const
+{
+    Q_D(const EnginioClient);
+    return d->_retryPolicy;
+}
+
+void EnginioClient::setRetryPolicy(RetryPolicy policy)
+{
+    Q_D(EnginioClient);
+    if (d->_retryPolicy != policy) {
+        d->_retryPolicy = policy;
+        emit retryPolicyChanged(policy);
+    }
+}
+
+/*!
+  \property EnginioClient::requestTimeout
+  \brief The time in milliseconds a request may take before it is aborted.
+
+  The timeout is applied to every request created afterwards and covers the whole
+  operation, for example all chunks of a file upload. A request which does not finish
+  in time finishes with the EnginioReply::TimeoutError error type. The timeout of
+  a single request can be changed with EnginioReply::setTimeout().
+
+  The default value is 0, which means that requests never time out.
+*/
+int EnginioClient::requestTimeout() const
+{
+    Q_D(const EnginioClient);
+    return d->_requestTimeout;
+}
+
+void EnginioClient::setRequestTimeout(int msecs)
+{
+    Q_D(EnginioClient);
+    msecs = qMax(0, msecs);
+    if (d->_requestTimeout != msecs) {
+        d->_requestTimeout = msecs;
+        emit requestTimeoutChanged(msecs);
+    }
+}
+
+/*!
+  \property EnginioClient::maxQueryUrlSize
+  \brief The url length in bytes above which a query is sent in the request body.
+
+  Such a query, for example one with a filter listing hundreds of ids, is sent as
+  a POST with the \c{X-HTTP-Method-Override: GET} header and its parameters in a
+  JSON body, so it is not cut by proxies and servers limiting the url length.
+  The backend must support the method override, otherwise the query body would
+  be stored as a new object. Full text searches are always sent in the url.
+
+  The default value is 0, which means that queries are always sent in the url.
+*/
+int EnginioClient::maxQueryUrlSize() const
+{
+    Q_D(const EnginioClient);
+    return d->_maxQueryUrlSize;
+}
+
+void EnginioClient::setMaxQueryUrlSize(int bytes)
+{
+    Q_D(EnginioClient);
+    bytes = qMax(0, bytes);
+    if (d->_maxQueryUrlSize != bytes) {
+        d->_maxQueryUrlSize = bytes;
+        emit maxQueryUrlSizeChanged(bytes);
+    }
+}
+
+/*!
+  \property EnginioClient::compressionThreshold
+  \brief The size in bytes from which request bodies are sent gzip compressed.
+
+  Objects sent by create() and update() and queries too long for the url are
+  compressed if their JSON is at least this long, which saves bandwidth on slow
+  uplinks at the cost of some CPU time. A body which does not get smaller is sent
+  as it is. Uploaded files are never compressed.
+
+  Responses are always accepted gzip or deflate encoded and are decoded while
+  they are received.
+
+  The default value is 0, which means that request bodies are not compressed.
+
+  \sa EnginioMetrics::compressionRatio
+*/
+int EnginioClient::compressionThreshold() const
+{
+    Q_D(const EnginioClient);
+    return d->_compressionThreshold;
+}
+
+void EnginioClient::setCompressionThreshold(int bytes)
+{
+    Q_D(EnginioClient);
+    bytes = qMax(0, bytes);
+    if (d->_compressionThreshold != bytes) {
+        d->_compressionThreshold = bytes;
+        emit compressionThresholdChanged(bytes);
+    }
+}
+
+/*!
+  \property EnginioClient::downloadSegmentSize
+  \brief The size in bytes of the ranges in which downloaded files are requested.
+
+  A file downloaded with downloadFile() into a device is fetched in ranged
+  requests of this size, up to \l downloadSegmentCount of them running in parallel.
+  Smaller segments let other requests in more often, larger ones cost less
+  request overhead.
+
+  The default value is 4 MiB.
+*/
+int EnginioClient::downloadSegmentSize() const
+{
+    Q_D(const EnginioClient);
+    return d->_downloadSegmentSize;
+}
+
+void EnginioClient::setDownloadSegmentSize(int bytes)
+{
+    Q_D(EnginioClient);
+    bytes = qMax(1, bytes);
+    if (d->_downloadSegmentSize != bytes) {
+        d->_downloadSegmentSize = bytes;
+        emit downloadSegmentSizeChanged(bytes);
+    }
+}
+
+/*!
+  \property EnginioClient::downloadSegmentCount
+  \brief How many segments of a downloaded file are requested at the same time.
+
+  The requests are still limited by setMaxRunningRequests() for the
+  BulkRequests class. The default value is 4.
+
+  \sa downloadSegmentSize
+*/
+int EnginioClient::downloadSegmentCount() const
+{
+    Q_D(const EnginioClient);
+    return d->_downloadSegmentCount;
+}
+
+void EnginioClient::setDownloadSegmentCount(int count)
+{
+    Q_D(EnginioClient);
+    count = qMax(1, count);
+    if (d->_downloadSegmentCount != count) {
+        d->_downloadSegmentCount = count;
+        emit downloadSegmentCountChanged(count);
+    }
+}
+
+/*!
+  \property EnginioClient::metrics
+  \brief The request counters, latencies and traces of this client.
+
+  The metrics are collected only after EnginioMetrics::enabled is set.
+
+  \sa EnginioMetrics
+*/
+EnginioMetrics *EnginioClient::metrics() const
+{
+    Q_D(const EnginioClient);
+    return d->_metrics->q;
+}
+
+/*!
+  \enum EnginioClient::RequestClass
+
+  This enum describes the classes in which requests are scheduled. A request is
+  sent only when no request of a more important class is waiting, so large
+  transfers yield to the requests the application is waiting for.
+  \value InteractiveRequests Object, user and usergroup operations
+  \value BackgroundRequests File metadata requests and multipart uploads
+  \value BulkRequests Chunks of file uploads and segments of file downloads
+
+  \sa setMaxRunningRequests(), setMaxBytesPerSecond()
+*/
+
+/*!
+  Returns how many requests of the \a requestClass may run at the same time.
+  \sa setMaxRunningRequests()
+*/
+int EnginioClient::maxRunningRequests(RequestClass requestClass) const
+{
+    Q_D(const EnginioClient);
+    if (uint(requestClass) >= EnginioClientPrivate::RequestClassCount)
+        return 0;
+    return d->_requestQueues[requestClass].maxRunning;
+}
+
+/*!
+  Limits the requests of the \a requestClass running at the same time to \a count.
+  Further requests of the class wait until one of them finishes.
+
+  QNetworkAccessManager opens up to six connections to a host, so by default
+  up to two background and three bulk requests run at the same time, which
+  keeps a connection free for interactive requests. The value 0 means no limit,
+  which is the default for InteractiveRequests.
+*/
+void EnginioClient::setMaxRunningRequests(RequestClass requestClass, int count)
+{
+    Q_D(EnginioClient);
+    if (uint(requestClass) >= EnginioClientPrivate::RequestClassCount)
+        return;
+    d->_requestQueues[requestClass].maxRunning = qMax(0, count);
+    d->processRequestQueues();
+}
+
+/*!
+  Returns the byte rate the requests of the \a requestClass are limited to.
+  \sa setMaxBytesPerSecond()
+*/
+int EnginioClient::maxBytesPerSecond(RequestClass requestClass) const
+{
+    Q_D(const EnginioClient);
+    if (uint(requestClass) >= EnginioClientPrivate::RequestClassCount)
+        return 0;
+    return d->_requestQueues[requestClass].maxBytesPerSecond;
+}
+
+/*!
+  Limits the data the requests of the \a requestClass send and receive to
+  \a bytes per second, for example to keep a file upload from saturating a slow uplink.
+
+  The limit is kept by delaying the start of the next request of the class by
+  the time the previous one would take at the given rate, so it applies to
+  requests of a known size, like upload chunks and download segments, and not
+  within a single request.
+
+  The default value is 0, which means no limit.
+*/
+void EnginioClient::setMaxBytesPerSecond(RequestClass requestClass, int bytes)
+{
+    Q_D(EnginioClient);
+    if (uint(requestClass) >= EnginioClientPrivate::RequestClassCount)
+        return;
+    EnginioClientPrivate::RequestQueue &queue = d->_requestQueues[requestClass];
+    queue.maxBytesPerSecond = qMax(0, bytes);
+    if (!queue.maxBytesPerSecond)
+        queue.nextStart = 0;
+    d->processRequestQueues();
+}
+
 /*!
   \property EnginioClient::serviceUrl
   \brief Enginio backend URL.
@@ -375,6 +1382,8 @@ void EnginioClient::setServiceUrl(const QUrl &serviceUrl)
     Q_D(EnginioClient);
     if (d->_serviceUrl != serviceUrl) {
         d->_serviceUrl = serviceUrl;
+        d->_downloadUrls.clear();
+        d->_requestTemplates.clear();
         emit serviceUrlChanged(serviceUrl);
     }
 }
@@ -441,6 +1450,9 @@ EnginioReply *EnginioClient::search(const QJsonObject &query)
   To query the database of all objects of type "objects.todo":
   \snippet enginioclient/tst_enginioclient.cpp query-todo
 
+  A \c fields array in the \a query lists the properties that should be returned,
+  it is passed to the backend which may still return whole objects.
+
   \return EnginioReply containing the status and the result once it is finished.
   \sa EnginioReply, create(), update(), remove(), Operation
  */
@@ -454,6 +1466,48 @@ EnginioReply* EnginioClient::query(const QJsonObject &query, const Operation ope
     return ereply;
 }
 
+/*!
+  \overload
+  \brief Query the database with a typed \a query.
+
+  The parameters of the \a query are compiled directly to the request url,
+  which makes it cheaper than the JSON based query for frequent requests.
+
+  \return EnginioReply containing the status and the result once it is finished.
+  \sa EnginioQuery
+ */
+EnginioReply *EnginioClient::query(const EnginioQuery &query)
+{
+    Q_D(EnginioClient);
+
+    QNetworkReply *nreply = d->query(EnginioQueryPrivate::get(query));
+    EnginioReply *ereply = new EnginioReply(d, nreply);
+
+    return ereply;
+}
+
+/*!
+  \brief Count the objects matching the \a query.
+
+  Only the total number of objects that \l query() would return for the same \a query
+  and \a operation is requested, at most one object, reduced to its id, is transferred.
+  The \c limit, \c offset, \c sort and \c include parameters of the \a query are ignored.
+
+  The number is the \c count property of EnginioReply::data().
+
+  \return EnginioReply containing the status and the result once it is finished.
+  \sa EnginioReply, query(), Operation
+ */
+EnginioReply *EnginioClient::count(const QJsonObject &query, const Operation operation)
+{
+    Q_D(EnginioClient);
+
+    QNetworkReply *nreply = d->count<QJsonObject>(query, static_cast<EnginioClientPrivate::Operation>(operation));
+    EnginioReply *ereply = new EnginioReply(d, nreply);
+
+    return ereply;
+}
+
 /*!
   \brief Insert a new \a object into the database.
 
@@ -564,6 +1618,33 @@ EnginioReply* EnginioClient::uploadFile(const QJsonObject &object, const QUrl &f
     return ereply;
 }
 
+/*!
+  \brief Creates an \a object and stores a \a file attached to it in Enginio
+
+  This is a shortcut for \l create() followed by \l uploadFile(), the upload
+  is started as soon as the id of the new object is known, without waiting
+  for the application to handle the first reply. The file is stored in the
+  property \a propertyName of the created object.
+
+  The returned reply finishes after the upload is done. Its data contains the
+  created object, with \a propertyName set to the uploaded file.
+  If the object could not be created, the reply contains that error and
+  no upload is attempted. If the upload fails, the reply contains the upload
+  error and the created object is removed again, so that no object is left
+  without its file.
+
+  \sa create(), uploadFile()
+*/
+EnginioReply* EnginioClient::createWithFile(const QJsonObject &object, const QString &propertyName, const QUrl &file, const Operation operation)
+{
+    Q_D(EnginioClient);
+
+    QNetworkReply *nreply = d->createWithFile<QJsonObject>(object, propertyName, file, operation);
+    EnginioReply *ereply = new EnginioReply(d, nreply);
+
+    return ereply;
+}
+
 /*!
   \brief Download a file stored in Enginio
 
@@ -590,6 +1671,53 @@ EnginioReply* EnginioClient::downloadFile(const QJsonObject &object)
     return ereply;
 }
 
+/*!
+  \overload
+  \brief Download a file stored in Enginio directly into the \a device
+
+  The file described by \a object is fetched from the download URL and its content is written
+  to the \a device as it arrives, so the file is never buffered as a whole in memory. The
+  progress() signal of the returned reply reports the number of bytes written. The
+  \a device has to be open for writing and it has to stay valid until the reply is finished.
+
+  Writing starts at the current position of a random access \a device. Bytes before that
+  position are treated as already downloaded, which allows resuming of an interrupted
+  download. Large files are fetched in several ranged requests running in parallel.
+
+  \sa uploadFile()
+*/
+EnginioReply* EnginioClient::downloadFile(const QJsonObject &object, QIODevice *device)
+{
+    Q_D(EnginioClient);
+
+    QNetworkReply *nreply = d->downloadFile<QJsonObject>(object, device);
+    EnginioReply *ereply = new EnginioReply(d, nreply);
+
+    return ereply;
+}
+
+/*!
+  \overload
+  \brief Download a file stored in Enginio into a local \a file
+
+  The content described by \a object is written directly to the \a file. While the
+  download runs, a \c{.download} file next to it records the file id, the variant and
+  the size. If the download is interrupted, it is kept, so that a next download of the
+  same file to the same path requests only the missing part. Without it, an existing
+  \a file is overwritten. The \c{.download} file is removed once the download is complete.
+
+  \sa uploadFile()
+*/
+EnginioReply* EnginioClient::downloadFile(const QJsonObject &object, const QUrl &file)
+{
+    Q_D(EnginioClient);
+
+    QNetworkReply *nreply = d->downloadFile<QJsonObject>(object, file);
+    EnginioReply *ereply = new EnginioReply(d, nreply);
+
+    return ereply;
+}
+
 Q_GLOBAL_STATIC(QThreadStorage<QNetworkAccessManager*>, NetworkManager)
 
 void EnginioClientPrivate::assignNetworkManager()
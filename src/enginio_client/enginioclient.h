@@ -51,8 +51,11 @@ class EnginioClientPrivate;
 class QNetworkAccessManager;
 
 class QNetworkReply;
+class QIODevice;
 class EnginioReply;
 class EnginioIdentity;
+class EnginioMetrics;
+class EnginioQuery;
 
 class ENGINIOCLIENT_EXPORT EnginioClient : public QObject
 {
@@ -77,6 +80,20 @@ public:
     };
     Q_ENUMS(Operation)
 
+    enum RetryPolicy {
+        RetryIdempotentOperations,
+        RetryAllOperations
+    };
+    Q_ENUMS(RetryPolicy)
+
+    enum RequestClass {
+        // Do not forget to keep in sync with EnginioClientPrivate::RequestClass!
+        InteractiveRequests,
+        BackgroundRequests,
+        BulkRequests
+    };
+    Q_ENUMS(RequestClass)
+
     explicit EnginioClient(QObject *parent = 0);
     ~EnginioClient();
 
@@ -85,6 +102,15 @@ public:
     Q_PROPERTY(QUrl serviceUrl READ serviceUrl WRITE setServiceUrl NOTIFY serviceUrlChanged FINAL)
     Q_PROPERTY(EnginioIdentity *identity READ identity WRITE setIdentity NOTIFY identityChanged FINAL)
     Q_PROPERTY(AuthenticationState authenticationState READ authenticationState NOTIFY authenticationStateChanged FINAL)
+    Q_PROPERTY(int maxAttempts READ maxAttempts WRITE setMaxAttempts NOTIFY maxAttemptsChanged FINAL)
+    Q_PROPERTY(int retryDelay READ retryDelay WRITE setRetryDelay NOTIFY retryDelayChanged FINAL)
+    Q_PROPERTY(RetryPolicy retryPolicy READ retryPolicy WRITE setRetryPolicy NOTIFY retryPolicyChanged FINAL)
+    Q_PROPERTY(int requestTimeout READ requestTimeout WRITE setRequestTimeout NOTIFY requestTimeoutChanged FINAL)
+    Q_PROPERTY(int maxQueryUrlSize READ maxQueryUrlSize WRITE setMaxQueryUrlSize NOTIFY maxQueryUrlSizeChanged FINAL)
+    Q_PROPERTY(int compressionThreshold READ compressionThreshold WRITE setCompressionThreshold NOTIFY compressionThresholdChanged FINAL)
+    Q_PROPERTY(int downloadSegmentSize READ downloadSegmentSize WRITE setDownloadSegmentSize NOTIFY downloadSegmentSizeChanged FINAL)
+    Q_PROPERTY(int downloadSegmentCount READ downloadSegmentCount WRITE setDownloadSegmentCount NOTIFY downloadSegmentCountChanged FINAL)
+    Q_PROPERTY(EnginioMetrics *metrics READ metrics CONSTANT FINAL)
 
     QByteArray backendId() const Q_REQUIRED_RESULT;
     void setBackendId(const QByteArray &backendId);
@@ -98,15 +124,43 @@ public:
     void setServiceUrl(const QUrl &serviceUrl);
     QNetworkAccessManager *networkManager() const Q_REQUIRED_RESULT;
 
+    int maxAttempts() const Q_REQUIRED_RESULT;
+    void setMaxAttempts(int maxAttempts);
+    int retryDelay() const Q_REQUIRED_RESULT;
+    void setRetryDelay(int msecs);
+    RetryPolicy retryPolicy() const Q_REQUIRED_RESULT;
+    void setRetryPolicy(RetryPolicy policy);
+    int requestTimeout() const Q_REQUIRED_RESULT;
+    void setRequestTimeout(int msecs);
+    int maxQueryUrlSize() const Q_REQUIRED_RESULT;
+    void setMaxQueryUrlSize(int bytes);
+    int compressionThreshold() const Q_REQUIRED_RESULT;
+    void setCompressionThreshold(int bytes);
+    int downloadSegmentSize() const Q_REQUIRED_RESULT;
+    void setDownloadSegmentSize(int bytes);
+    int downloadSegmentCount() const Q_REQUIRED_RESULT;
+    void setDownloadSegmentCount(int count);
+    EnginioMetrics *metrics() const Q_REQUIRED_RESULT;
+
+    Q_INVOKABLE int maxRunningRequests(RequestClass requestClass) const;
+    Q_INVOKABLE void setMaxRunningRequests(RequestClass requestClass, int count);
+    Q_INVOKABLE int maxBytesPerSecond(RequestClass requestClass) const;
+    Q_INVOKABLE void setMaxBytesPerSecond(RequestClass requestClass, int bytes);
+
     Q_INVOKABLE EnginioReply *customRequest(const QUrl &url, const QByteArray &httpOperation, const QJsonObject &data = QJsonObject());
     Q_INVOKABLE EnginioReply *search(const QJsonObject &query);
     Q_INVOKABLE EnginioReply *query(const QJsonObject &query, const Operation operation = ObjectOperation);
+    EnginioReply *query(const EnginioQuery &query);
+    Q_INVOKABLE EnginioReply *count(const QJsonObject &query, const Operation operation = ObjectOperation);
     Q_INVOKABLE EnginioReply *create(const QJsonObject &object, const Operation operation = ObjectOperation);
     Q_INVOKABLE EnginioReply *update(const QJsonObject &object, const Operation operation = ObjectOperation);
     Q_INVOKABLE EnginioReply *remove(const QJsonObject &object, const Operation operation = ObjectOperation);
 
     Q_INVOKABLE EnginioReply *uploadFile(const QJsonObject &associatedObject, const QUrl &file);
+    Q_INVOKABLE EnginioReply *createWithFile(const QJsonObject &object, const QString &propertyName, const QUrl &file, const Operation operation = ObjectOperation);
     Q_INVOKABLE EnginioReply *downloadFile(const QJsonObject &object);
+    EnginioReply *downloadFile(const QJsonObject &object, QIODevice *device);
+    EnginioReply *downloadFile(const QJsonObject &object, const QUrl &file);
 
     bool finishDelayedReplies();
 Q_SIGNALS:
@@ -118,6 +172,14 @@ Q_SIGNALS:
     void serviceUrlChanged(const QUrl& url);
     void authenticationStateChanged(const AuthenticationState state);
     void identityChanged(const EnginioIdentity *identity);
+    void maxAttemptsChanged(int maxAttempts);
+    void retryDelayChanged(int msecs);
+    void retryPolicyChanged(RetryPolicy policy);
+    void requestTimeoutChanged(int msecs);
+    void maxQueryUrlSizeChanged(int bytes);
+    void compressionThresholdChanged(int bytes);
+    void downloadSegmentSizeChanged(int bytes);
+    void downloadSegmentCountChanged(int count);
     void finished(EnginioReply *reply);
     void error(EnginioReply *reply);
 
@@ -134,5 +196,9 @@ Q_DECLARE_TYPEINFO(EnginioClient::Operation, Q_PRIMITIVE_TYPE);
 Q_DECLARE_METATYPE(EnginioClient::Operation);
 Q_DECLARE_TYPEINFO(EnginioClient::AuthenticationState, Q_PRIMITIVE_TYPE);
 Q_DECLARE_METATYPE(EnginioClient::AuthenticationState);
+Q_DECLARE_TYPEINFO(EnginioClient::RetryPolicy, Q_PRIMITIVE_TYPE);
+Q_DECLARE_METATYPE(EnginioClient::RetryPolicy);
+Q_DECLARE_TYPEINFO(EnginioClient::RequestClass, Q_PRIMITIVE_TYPE);
+Q_DECLARE_METATYPE(EnginioClient::RequestClass);
 
 #endif // ENGINIOCLIENT_H
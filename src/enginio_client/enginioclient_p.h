@@ -42,8 +42,13 @@
 #include "enginioclient.h"
 #include "enginioreply.h"
 #include "enginiofakereply_p.h"
+#include "enginioscheduledreply_p.h"
 #include "enginioidentity.h"
+#include "enginiometrics_p.h"
 #include "enginioobjectadaptor_p.h"
+#include "enginioquery_p.h"
+#include "enginioqueryencoder_p.h"
+#include "enginiorequestdatabuffer_p.h"
 #include "enginiostring_p.h"
 
 #include <QNetworkAccessManager>
@@ -59,6 +64,9 @@
 #include <QtCore/qjsonarray.h>
 #include <QtCore/qbuffer.h>
 #include <QtCore/qlinkedlist.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qqueue.h>
+#include <QtCore/qtimer.h>
 
 #define CHECK_AND_SET_URL_PATH_IMPL(Url, Object, Operation, Flags) \
     {\
@@ -75,6 +83,20 @@
 #define CHECK_AND_SET_PATH_WITH_ID(Url, Object, Operation) \
     CHECK_AND_SET_URL_PATH_IMPL(Url, Object, Operation, EnginioClientPrivate::IncludeIdInPath)
 
+#define CHECK_AND_PREPARE_REQUEST_IMPL(Request, Object, Operation, Flags) \
+    QNetworkRequest Request; \
+    {\
+        QByteArray _errorMsg; \
+        if (!prepareRequest(&Request, Object, Operation, &_errorMsg, Flags)) \
+            return new EnginioFakeReply(this, _errorMsg); \
+    }
+
+#define CHECK_AND_PREPARE_REQUEST(Request, Object, Operation) \
+    CHECK_AND_PREPARE_REQUEST_IMPL(Request, Object, Operation, EnginioClientPrivate::Default)
+
+#define CHECK_AND_PREPARE_REQUEST_WITH_ID(Request, Object, Operation) \
+    CHECK_AND_PREPARE_REQUEST_IMPL(Request, Object, Operation, EnginioClientPrivate::IncludeIdInPath)
+
 static QByteArray constructErrorMessage(QByteArray msg)
 {
     static QByteArray msgBegin = QByteArrayLiteral("{\"errors\": [{\"message\": \"");
@@ -84,8 +106,14 @@ static QByteArray constructErrorMessage(QByteArray msg)
 
 class ENGINIOCLIENT_EXPORT EnginioClientPrivate
 {
-    enum PathOptions { Default, IncludeIdInPath = 1};
+    enum {
+        DownloadUrlCacheLimit = 1024,
+        DownloadUrlExpirationMargin = 30 * 1000, // ms, the url should not expire before the download starts
+        RequestTemplateCacheLimit = 256
+    };
 
+public:
+    enum PathOptions { Default, IncludeIdInPath = 1};
 
     template<class T>
     static bool getPath(const T &object, int operation, QString *path, QByteArray *errorMsg, PathOptions flags = Default)
@@ -197,6 +225,7 @@ class ENGINIOCLIENT_EXPORT EnginioClientPrivate
         return true;
     }
 
+private:
     class ReplyFinishedFunctor
     {
         EnginioClientPrivate *d;
@@ -318,21 +347,120 @@ public:
     QMetaObject::Connection _networkManagerConnection;
     QNetworkRequest _request;
     QMap<QNetworkReply*, EnginioReply*> _replyReplyMap;
-    QMap<QNetworkReply*, QByteArray> _requestData;
+    EnginioRequestDataBuffer _requestData; // used only if gEnableEnginioDebugInfo is set
 
     // device and last position
     QMap<QNetworkReply*, QPair<QIODevice*, qint64> > _chunkedUploads;
     qint64 _uploadChunkSize;
+
+    struct FileDownload
+    {
+        struct Segment
+        {
+            qint64 begin; // first byte requested by the segment
+            qint64 pos; // position of the next received byte in the file
+            bool started;
+            QMetaObject::Connection readyRead;
+        };
+
+        QIODevice *device;
+        bool ownsDevice;
+        QString infoPath; // describes an unfinished download to a file, so that it can be resumed
+        QJsonObject info;
+        QUrl url; // empty until the download url is resolved
+        qint64 startPos; // bytes before this position were downloaded already
+        qint64 nextPos; // first byte that was not requested yet
+        qint64 total; // file size or -1 if not known yet
+        qint64 received;
+        bool openEnded; // a request without an upper range limit is running
+        QMap<QNetworkReply*, Segment> segments;
+    };
+    // every segment of a download and the download url request are mapped to the same instance
+    QMap<QNetworkReply*, FileDownload*> _downloads;
+    int _downloadSegmentSize;
+    int _downloadSegmentCount;
+
+    // bytes, a longer query url is sent as a POST with the parameters in a JSON body, 0 means never
+    int _maxQueryUrlSize;
+
+    struct PendingAttachment {
+        QString propertyName;
+        QUrl file;
+        EnginioClient::Operation operation;
+        QJsonObject object; // empty until the object is created
+    };
+    QMap<QNetworkReply*, PendingAttachment> _pendingAttachments;
+
+    typedef QPair<QString /* file id */, QString /* variant */> DownloadUrlKey;
+    // download url reply data and its expiration time in ms since epoch
+    QHash<DownloadUrlKey, QPair<QByteArray, qint64> > _downloadUrls;
+    QMap<QNetworkReply*, DownloadUrlKey> _downloadUrlRequests;
+
+    // The request with the url and the headers for an operation and an object type, so
+    // that they do not need to be built for every request. Cleared whenever _request or
+    // _serviceUrl change.
+    struct RequestTemplate
+    {
+        QNetworkRequest request;
+        QString path;
+    };
+    QHash<QPair<int, QString>, RequestTemplate> _requestTemplates;
+
+    // Requests are sent in the order of their class, a class waits while
+    // requests of a more important class are queued.
+    enum RequestClass {
+        InteractiveRequest = EnginioClient::InteractiveRequests, // object operations the application is waiting for
+        BackgroundRequest = EnginioClient::BackgroundRequests, // file metadata and multipart uploads
+        BulkRequest = EnginioClient::BulkRequests, // upload chunks and download segments
+        RequestClassCount
+    };
+    struct RequestQueue {
+        QQueue<QPointer<EnginioScheduledReply> > pending;
+        int running;
+        int maxRunning; // 0 means no limit
+        int maxBytesPerSecond; // 0 means no limit
+        qint64 nextStart; // ms since epoch, delays requests to keep the byte rate
+    };
+    RequestQueue _requestQueues[RequestClassCount];
+    struct RunningRequest {
+        RequestClass requestClass;
+        QMetaObject::Connection finished;
+        QMetaObject::Connection destroyed;
+    };
+    QHash<QNetworkReply*, RunningRequest> _runningRequests;
+    QTimer *_requestQueueTimer;
+
+    int _maxAttempts;
+    int _retryDelay;
+    EnginioClient::RetryPolicy _retryPolicy;
+
+    int _requestTimeout; // ms, 0 means no timeout
+    // replies ordered by their deadline in ms since epoch
+    QMultiMap<qint64, QPointer<EnginioReply> > _deadlines;
+    QTimer *_deadlineTimer;
+
+    int _compressionThreshold; // bytes, 0 means no compression
+
     QJsonObject _identityToken;
     EnginioClient::AuthenticationState _authenticationState;
 
     QSet<EnginioReply*> _delayedReplies; // Used only for testing
 
+    EnginioMetricsPrivate *_metrics; // owned by q_ptr
+
     void init();
 
     void replyFinished(QNetworkReply *nreply);
     bool finishDelayedReplies();
 
+    void downloadReadyRead(QNetworkReply *nreply);
+    void requestFinished(QNetworkReply *nreply);
+    void processRequestQueues();
+    void scheduleRequest(EnginioScheduledReply *reply);
+    void setDeadline(EnginioReply *ereply, qint64 deadline);
+    void processDeadlines();
+    void cacheDownloadUrl(QNetworkReply *nreply, const DownloadUrlKey &key);
+
     void setAuthenticationState(const EnginioClient::AuthenticationState state)
     {
         if (_authenticationState == state)
@@ -357,15 +485,90 @@ public:
         if (reply) {
             _identityToken = reply->data();
             sessionToken = _identityToken[EnginioString::sessionToken].toString().toLatin1();
+        } else {
+            _identityToken = QJsonObject();
         }
 
         _request.setRawHeader(QByteArrayLiteral("Enginio-Backend-Session"), sessionToken);
+        // download urls may depend on the user permissions
+        _downloadUrls.clear();
+        _requestTemplates.clear();
         if (sessionToken.isEmpty())
             emit q_ptr->sessionTerminated();
         else
             emit q_ptr->sessionAuthenticated(reply);
     }
 
+    template<class T>
+    bool prepareRequest(QNetworkRequest *request, const T &object, int operation, QByteArray *errorMsg, PathOptions flags = Default)
+    {
+        QString objectType;
+        switch (operation) {
+        case ObjectOperation:
+            objectType = object[EnginioString::objectType].toString();
+            if (objectType.isEmpty())
+                break; // getPath reports the error
+            // fall through
+        case UserOperation:
+        case UsergroupOperation:
+        case SearchOperation:
+        case AuthenticationOperation:
+        case SessionOperation: {
+            QString id;
+            if (flags & IncludeIdInPath) {
+                id = object[EnginioString::id].toString();
+                if (id.isEmpty())
+                    break;
+            }
+            const RequestTemplate &requestTemplate = this->requestTemplate(operation, objectType);
+            *request = requestTemplate.request;
+            if (!id.isEmpty()) {
+                QUrl url(requestTemplate.request.url());
+                url.setPath(requestTemplate.path + QLatin1Char('/') + id);
+                request->setUrl(url);
+            }
+            return true;
+        }
+        default:
+            break;
+        }
+
+        // the id is in the middle of the path, or the object is not valid
+        QString path;
+        if (!getPath(object, operation, &path, errorMsg, flags))
+            return false;
+        QUrl url(_serviceUrl);
+        url.setPath(path);
+        *request = _request;
+        request->setUrl(url);
+        return true;
+    }
+
+    const RequestTemplate &requestTemplate(int operation, const QString &objectType)
+    {
+        const QPair<int, QString> key(operation, objectType);
+        QHash<QPair<int, QString>, RequestTemplate>::const_iterator cached = _requestTemplates.constFind(key);
+        if (cached != _requestTemplates.constEnd())
+            return *cached;
+
+        if (_requestTemplates.count() >= RequestTemplateCacheLimit)
+            _requestTemplates.clear();
+
+        QJsonObject object;
+        if (!objectType.isEmpty())
+            object[EnginioString::objectType] = objectType;
+        RequestTemplate requestTemplate;
+        QByteArray errorMsg;
+        const bool valid = getPath(object, operation, &requestTemplate.path, &errorMsg);
+        Q_ASSERT(valid);
+        Q_UNUSED(valid);
+        QUrl url(_serviceUrl);
+        url.setPath(requestTemplate.path);
+        requestTemplate.request = _request;
+        requestTemplate.request.setUrl(url);
+        return *_requestTemplates.insert(key, requestTemplate);
+    }
+
     void registerReply(QNetworkReply *nreply, EnginioReply *ereply)
     {
         _replyReplyMap[nreply] = ereply;
@@ -402,15 +605,12 @@ public:
 
     QNetworkReply *identify(const QJsonObject &object)
     {
-        QUrl url(_serviceUrl);
-        CHECK_AND_SET_PATH(url, object, AuthenticationOperation);
+        CHECK_AND_PREPARE_REQUEST(req, object, AuthenticationOperation);
 
-        QNetworkRequest req(_request);
-        req.setUrl(url);
         QByteArray data(QJsonDocument(object).toJson(QJsonDocument::Compact));
-        QNetworkReply *reply = networkManager()->post(req, data);
+        QNetworkReply *reply = sendRequest(QNetworkAccessManager::PostOperation, req, data);
 
-        if (gEnableEnginioDebugInfo)
+        if (Q_UNLIKELY(gEnableEnginioDebugInfo))
             _requestData.insert(reply, data);
 
         return reply;
@@ -446,9 +646,10 @@ public:
             buffer->open(QIODevice::ReadOnly);
         }
 
-        QNetworkReply *reply = networkManager()->sendCustomRequest(req, httpOperation, buffer);
+        req.setAttribute(QNetworkRequest::CustomVerbAttribute, httpOperation);
+        QNetworkReply *reply = sendRequest(QNetworkAccessManager::CustomOperation, req, buffer, InteractiveRequest, payload.size());
 
-        if (gEnableEnginioDebugInfo && !payload.isEmpty())
+        if (Q_UNLIKELY(gEnableEnginioDebugInfo) && !payload.isEmpty())
             _requestData.insert(reply, payload);
 
         if (buffer)
@@ -460,11 +661,7 @@ public:
     template<class T>
     QNetworkReply *update(const ObjectAdaptor<T> &object, const EnginioClient::Operation operation)
     {
-        QUrl url(_serviceUrl);
-        CHECK_AND_SET_PATH_WITH_ID(url, object, operation);
-
-        QNetworkRequest req(_request);
-        req.setUrl(url);
+        CHECK_AND_PREPARE_REQUEST_WITH_ID(req, object, operation);
 
         // TODO FIXME we need to remove "id" and "objectType" because of an internal server error.
         // It failes at least for ACL but maybe for others too.
@@ -478,9 +675,9 @@ public:
         o.remove(EnginioString::id);
         QByteArray data = o.toJson();
 
-        QNetworkReply *reply = networkManager()->put(req, data);
+        QNetworkReply *reply = sendRequest(QNetworkAccessManager::PutOperation, req, compressBody(&req, data));
 
-        if (gEnableEnginioDebugInfo)
+        if (Q_UNLIKELY(gEnableEnginioDebugInfo))
             _requestData.insert(reply, data);
 
         return reply;
@@ -489,11 +686,7 @@ public:
     template<class T>
     QNetworkReply *remove(const ObjectAdaptor<T> &object, const EnginioClient::Operation operation)
     {
-        QUrl url(_serviceUrl);
-        CHECK_AND_SET_PATH_WITH_ID(url, object, operation);
-
-        QNetworkRequest req(_request);
-        req.setUrl(url);
+        CHECK_AND_PREPARE_REQUEST_WITH_ID(req, object, operation);
 
         // TODO FIXME we need to remove "id" and "objectType" because of an internal server error.
         // It failes at least for ACL but maybe for others too.
@@ -511,20 +704,21 @@ public:
             QBuffer *buffer = new QBuffer();
             buffer->setData(data);
             buffer->open(QIODevice::ReadOnly);
-            QNetworkReply *reply = networkManager()->sendCustomRequest(req, QByteArrayLiteral("DELETE"), buffer);
+            req.setAttribute(QNetworkRequest::CustomVerbAttribute, QByteArrayLiteral("DELETE"));
+            QNetworkReply *reply = sendRequest(QNetworkAccessManager::CustomOperation, req, buffer, InteractiveRequest, data.size());
             buffer->setParent(reply);
 
-            if (gEnableEnginioDebugInfo)
+            if (Q_UNLIKELY(gEnableEnginioDebugInfo))
                 _requestData.insert(reply, data);
 
             return reply;
         }
-        return networkManager()->deleteResource(req);
+        return sendRequest(QNetworkAccessManager::DeleteOperation, req);
 #else
         QByteArray data = o.toJson();
-        QNetworkReply *reply = networkManager()->deleteResource(req, data);
+        QNetworkReply *reply = sendRequest(QNetworkAccessManager::DeleteOperation, req, data);
 
-        if (gEnableEnginioDebugInfo)
+        if (Q_UNLIKELY(gEnableEnginioDebugInfo))
             _requestData.insert(reply, data);
 
         return reply;
@@ -534,72 +728,166 @@ public:
     template<class T>
     QNetworkReply *create(const ObjectAdaptor<T> &object, const EnginioClient::Operation operation)
     {
-        QUrl url(_serviceUrl);
-        CHECK_AND_SET_PATH(url, object, operation);
-
-        QNetworkRequest req(_request);
-        req.setUrl(url);
+        CHECK_AND_PREPARE_REQUEST(req, object, operation);
 
         QByteArray data = object.toJson();
 
-        QNetworkReply *reply = networkManager()->post(req, data);
+        QNetworkReply *reply = sendRequest(QNetworkAccessManager::PostOperation, req, compressBody(&req, data));
 
-        if (gEnableEnginioDebugInfo)
+        if (Q_UNLIKELY(gEnableEnginioDebugInfo))
             _requestData.insert(reply, data);
 
         return reply;
     }
 
     template<class T>
-    QNetworkReply *query(const ObjectAdaptor<T> &object, const Operation operation)
+    QNetworkReply *createWithFile(const ObjectAdaptor<T> &object, const QString &propertyName, const QUrl &fileUrl, const EnginioClient::Operation operation)
     {
-        QUrl url(_serviceUrl);
-        CHECK_AND_SET_PATH(url, object, operation);
+        if (!fileUrl.scheme().isEmpty() && !fileUrl.isLocalFile())
+            qWarning() << "Enginio: Upload must be local file.";
+        QString path = fileUrl.isLocalFile() ? fileUrl.toLocalFile() : fileUrl.path();
+
+        // fail before creating an object that would never get its file
+        if (!QFile::exists(path)) {
+            QByteArray msg = QByteArray("Cannot upload a not existing file ('") + path.toUtf8() + QByteArray("')");
+            msg = constructErrorMessage(msg);
+            return new EnginioFakeReply(this, msg);
+        }
 
+        QNetworkReply *reply = create(object, operation);
+        PendingAttachment attachment;
+        attachment.propertyName = propertyName;
+        attachment.file = fileUrl;
+        attachment.operation = operation;
+        _pendingAttachments.insert(reply, attachment);
+        return reply;
+    }
+
+    template<class T>
+    static bool encodeQuery(const ObjectAdaptor<T> &object, const Operation operation, EnginioQueryEncoder *encoder)
+    {
         // TODO add all params here
-        QUrlQuery urlQuery;
         if (int limit = object[EnginioString::limit].toInt()) {
-            urlQuery.addQueryItem(EnginioString::limit, QString::number(limit));
+            encoder->addItem(QLatin1String("limit"), limit);
         }
         if (int offset = object[EnginioString::offset].toInt()) {
-            urlQuery.addQueryItem(EnginioString::offset, QString::number(offset));
+            encoder->addItem(QLatin1String("offset"), offset);
         }
         if (object.contains(EnginioString::count)) { // TODO docs are saying about integer but it is not interpreted.
-            urlQuery.addQueryItem(EnginioString::count, QString(0, Qt::Uninitialized));
+            encoder->addItem(QLatin1String("count"), QString());
         }
         ValueAdaptor<T> include = object[EnginioString::include];
         if (include.isComposedType()) {
-            urlQuery.addQueryItem(EnginioString::include,
-                QString::fromUtf8(include.toJson()));
+            encoder->addItem(QLatin1String("include"), include);
         }
         ValueAdaptor<T> sort = object[EnginioString::sort];
         if (sort.isComposedType()) {
-            urlQuery.addQueryItem(EnginioString::sort,
-                QString::fromUtf8(sort.toJson()));
+            encoder->addItem(QLatin1String("sort"), sort);
+        }
+        ValueAdaptor<T> fields = object[EnginioString::fields];
+        if (fields.isComposedType()) { // a backend without projection support ignores it
+            encoder->addItem(QLatin1String("fields"), fields);
         }
         if (operation == SearchOperation) {
             ValueAdaptor<T> search = object[EnginioString::search];
             ArrayAdaptor<T> objectTypes = object[EnginioString::objectTypes].toArray();
-            if (search.isComposedType()) {
-                for (typename ArrayAdaptor<T>::const_iterator i = objectTypes.constBegin(); i != objectTypes.constEnd(); ++i) {
-                    urlQuery.addQueryItem(QStringLiteral("objectTypes[]"), (*i).toString());
-                }
-                urlQuery.addQueryItem(EnginioString::search,
-                    QString::fromUtf8(search.toJson()));
-            } else {
-                return new EnginioFakeReply(this, constructErrorMessage(QByteArrayLiteral("Fulltext Search: 'search' parameter(s) missing")));
+            if (!search.isComposedType())
+                return false;
+            for (typename ArrayAdaptor<T>::const_iterator i = objectTypes.constBegin(); i != objectTypes.constEnd(); ++i) {
+                encoder->addItem(QLatin1String("objectTypes[]"), (*i).toString());
             }
+            encoder->addItem(QLatin1String("search"), search);
         } else
         if (object[EnginioString::query].isComposedType()) { // TODO docs are inconsistent on that
-            urlQuery.addQueryItem(QStringLiteral("q"),
-                QString::fromUtf8(object[EnginioString::query].toJson()));
+            encoder->addItem(QLatin1String("q"), object[EnginioString::query]);
         }
-        url.setQuery(urlQuery);
+        return true;
+    }
 
-        QNetworkRequest req(_request);
-        req.setUrl(url);
+    template<class T>
+    static void encodeCount(const ObjectAdaptor<T> &object, EnginioQueryEncoder *encoder)
+    {
+        // Only the total is of interest. One result projected to its id keeps the response small
+        // without relying on limit=0, which a backend may take as its default page size;
+        // offset, sort and include do not change the count.
+        encoder->addItem(QLatin1String("limit"), 1);
+        encoder->addItem(QLatin1String("count"), QString());
+        encoder->addItem(QLatin1String("fields"), QJsonValue(QJsonArray() << EnginioString::id));
+        if (object[EnginioString::query].isComposedType()) {
+            encoder->addItem(QLatin1String("q"), object[EnginioString::query]);
+        }
+    }
+
+    bool isQueryTooLong(const QNetworkRequest &request, const EnginioQueryEncoder &encoder) const Q_REQUIRED_RESULT
+    {
+        return _maxQueryUrlSize && encoder.size() + 1 + request.url().toEncoded().size() > _maxQueryUrlSize;
+    }
+
+    QNetworkReply *sendQuery(QNetworkRequest request, const EnginioQueryEncoder &encoder)
+    {
+        if (encoder.format() == EnginioQueryEncoder::JsonBody) {
+            // the backend handles it as a GET of the url, with the parameters taken from the body
+            request.setRawHeader(QByteArrayLiteral("X-HTTP-Method-Override"), QByteArrayLiteral("GET"));
+            const QByteArray body = compressBody(&request, encoder.body());
+            return sendRequest(QNetworkAccessManager::PostOperation, request, body);
+        }
+        if (!encoder.isEmpty()) {
+            QUrl url(request.url());
+            encoder.applyTo(&url);
+            request.setUrl(url);
+        }
+        return sendRequest(QNetworkAccessManager::GetOperation, request);
+    }
+
+    template<class T>
+    QNetworkReply *query(const ObjectAdaptor<T> &object, const Operation operation)
+    {
+        CHECK_AND_PREPARE_REQUEST(req, object, operation);
+
+        EnginioQueryEncoder encoder;
+        if (!encodeQuery(object, operation, &encoder))
+            return new EnginioFakeReply(this, constructErrorMessage(QByteArrayLiteral("Fulltext Search: 'search' parameter(s) missing")));
+        // search repeats the objectTypes[] item, which can not be expressed in the JSON body
+        if (Q_UNLIKELY(isQueryTooLong(req, encoder)) && operation != SearchOperation) {
+            EnginioQueryEncoder body(EnginioQueryEncoder::JsonBody);
+            encodeQuery(object, operation, &body);
+            return sendQuery(req, body);
+        }
+        return sendQuery(req, encoder);
+    }
 
-        return networkManager()->get(req);
+    QNetworkReply *query(const EnginioQueryPrivate *query)
+    {
+        if (query->operation != ObjectOperation && query->operation != UserOperation && query->operation != UsergroupOperation)
+            return new EnginioFakeReply(this, constructErrorMessage(QByteArrayLiteral("EnginioQuery supports only object, user and usergroup queries")));
+        if (query->operation == ObjectOperation && query->objectType.isEmpty())
+            return new EnginioFakeReply(this, constructErrorMessage(QByteArrayLiteral("Requested object operation requires non empty \'objectType\' value")));
+
+        // the path and the headers come from the template, only the parameters are encoded
+        const QNetworkRequest req(requestTemplate(query->operation, query->operation == ObjectOperation ? query->objectType : QString()).request);
+        EnginioQueryEncoder encoder;
+        query->encode(&encoder);
+        if (Q_UNLIKELY(isQueryTooLong(req, encoder))) {
+            EnginioQueryEncoder body(EnginioQueryEncoder::JsonBody);
+            query->encode(&body);
+            return sendQuery(req, body);
+        }
+        return sendQuery(req, encoder);
+    }
+
+    template<class T>
+    QNetworkReply *count(const ObjectAdaptor<T> &object, const Operation operation)
+    {
+        CHECK_AND_PREPARE_REQUEST(req, object, operation);
+
+        EnginioQueryEncoder encoder;
+        encodeCount(object, &encoder);
+        if (Q_UNLIKELY(isQueryTooLong(req, encoder))) {
+            EnginioQueryEncoder body(EnginioQueryEncoder::JsonBody);
+            encodeCount(object, &body);
+            return sendQuery(req, body);
+        }
+        return sendQuery(req, encoder);
     }
 
     template<class T>
@@ -607,20 +895,93 @@ public:
     {
         QUrl url(_serviceUrl);
         CHECK_AND_SET_PATH(url, object, FileGetDownloadUrlOperation);
+        QString variant;
         if (object.contains(EnginioString::variant)) {
-            QString variant = object[EnginioString::variant].toString();
+            variant = object[EnginioString::variant].toString();
             QUrlQuery query;
             query.addQueryItem(EnginioString::variant, variant);
             url.setQuery(query);
         }
 
+        // reuse the url as long as it is valid
+        const DownloadUrlKey key(object[EnginioString::id].toString(), variant);
+        QHash<DownloadUrlKey, QPair<QByteArray, qint64> >::const_iterator cached = _downloadUrls.constFind(key);
+        if (cached != _downloadUrls.constEnd()) {
+            if (cached->second > QDateTime::currentMSecsSinceEpoch() + DownloadUrlExpirationMargin)
+                return new EnginioFakeReply(this, cached->first, 200);
+            _downloadUrls.remove(key);
+        }
+
         QNetworkRequest req(_request);
         req.setUrl(url);
 
-        QNetworkReply *reply = networkManager()->get(req);
+        QNetworkReply *reply = sendRequest(QNetworkAccessManager::GetOperation, req, QByteArray(), BackgroundRequest);
+        _downloadUrlRequests.insert(reply, key);
         return reply;
     }
 
+    template<class T>
+    QNetworkReply *downloadFile(const ObjectAdaptor<T> &object, QIODevice *device, bool ownsDevice = false,
+                                const QString &infoPath = QString(), const QJsonObject &info = QJsonObject())
+    {
+        if (!device->isOpen() || !device->isWritable()) {
+            if (ownsDevice)
+                delete device;
+            return new EnginioFakeReply(this, constructErrorMessage(QByteArrayLiteral("Download target device has to be open for writing")));
+        }
+
+        FileDownload *download = new FileDownload;
+        download->device = device;
+        download->ownsDevice = ownsDevice;
+        download->infoPath = infoPath;
+        download->info = info;
+        download->startPos = download->nextPos = device->isSequential() ? 0 : device->pos();
+        download->total = -1;
+        download->received = 0;
+        download->openEnded = false;
+
+        QNetworkReply *reply = downloadFile(object);
+        _downloads.insert(reply, download);
+        return reply;
+    }
+
+    template<class T>
+    QNetworkReply *downloadFile(const ObjectAdaptor<T> &object, const QUrl &fileUrl)
+    {
+        if (!fileUrl.scheme().isEmpty() && !fileUrl.isLocalFile())
+            qWarning() << "Enginio: Download target must be local file.";
+        QString path = fileUrl.isLocalFile() ? fileUrl.toLocalFile() : fileUrl.path();
+
+        // an existing file is resumed only if the info file, written next to it when
+        // the download started, tells that it is a part of the same file
+        QJsonObject info;
+        info[EnginioString::id] = object[EnginioString::id].toString();
+        if (object.contains(EnginioString::variant))
+            info[EnginioString::variant] = object[EnginioString::variant].toString();
+        const QString infoPath = path + QStringLiteral(".download");
+        const QJsonObject previousInfo = readDownloadInfo(infoPath);
+        QFile *file = new QFile(path);
+        bool resume = previousInfo.value(EnginioString::id) == info.value(EnginioString::id)
+                && previousInfo.value(EnginioString::variant) == info.value(EnginioString::variant)
+                && file->exists();
+        if (resume && previousInfo.contains(EnginioString::size))
+            resume = file->size() <= qint64(previousInfo.value(EnginioString::size).toDouble());
+
+        if (!file->open(resume ? QFile::ReadWrite : QFile::ReadWrite | QFile::Truncate)) {
+            QByteArray msg = QByteArray("File ('") + path.toUtf8() + QByteArray("') could not be opened for writing");
+            msg = constructErrorMessage(msg);
+            delete file;
+            return new EnginioFakeReply(this, msg);
+        }
+        if (resume) {
+            file->seek(file->size());
+            info = previousInfo;
+        } else {
+            writeDownloadInfo(infoPath, info);
+        }
+        return downloadFile(object, file, true, infoPath, info);
+    }
+
     template<class T>
     QNetworkReply *uploadFile(const ObjectAdaptor<T> &object, const QUrl &fileUrl)
     {
@@ -656,7 +1017,7 @@ public:
         else
             reply = uploadChunked(object, device);
 
-        if (gEnableEnginioDebugInfo) {
+        if (Q_UNLIKELY(gEnableEnginioDebugInfo)) {
             QByteArray data = object.toJson();
             _requestData.insert(reply, data);
         }
@@ -671,6 +1032,22 @@ public:
 
     void assignNetworkManager();
     static QNetworkAccessManager *prepareNetworkManagerInThread() Q_REQUIRED_RESULT;
+    static quint32 crc32(const QByteArray &data) Q_REQUIRED_RESULT;
+    static QByteArray gzip(const QByteArray &data) Q_REQUIRED_RESULT;
+
+    QByteArray compressBody(QNetworkRequest *request, const QByteArray &data)
+    {
+        if (!_compressionThreshold || data.size() < _compressionThreshold)
+            return data;
+        const QByteArray compressed = gzip(data);
+        const bool smaller = !compressed.isEmpty() && compressed.size() < data.size();
+        if (Q_UNLIKELY(_metrics->isEnabled()))
+            _metrics->requestCompressed(data.size(), smaller ? compressed.size() : data.size());
+        if (!smaller) // already compressed or too small to benefit
+            return data;
+        request->setRawHeader(QByteArrayLiteral("Content-Encoding"), QByteArrayLiteral("gzip"));
+        return compressed;
+    }
 
     bool isSignalConnected(const QMetaMethod &signal) const Q_REQUIRED_RESULT
     {
@@ -704,8 +1081,108 @@ public:
         QNetworkReply *_reply;
     };
 
+    class RequestFinishedFunctor
+    {
+    public:
+        RequestFinishedFunctor(EnginioClientPrivate *client, QNetworkReply *reply)
+            : _client(client), _reply(reply)
+        {
+            Q_ASSERT(_client);
+            Q_ASSERT(_reply);
+        }
+
+        void operator ()()
+        {
+            _client->requestFinished(_reply);
+        }
+    private:
+        EnginioClientPrivate *_client;
+        QNetworkReply *_reply;
+    };
+
+    class ProcessRequestQueuesFunctor
+    {
+    public:
+        ProcessRequestQueuesFunctor(EnginioClientPrivate *client)
+            : _client(client)
+        {
+            Q_ASSERT(_client);
+        }
+
+        void operator ()()
+        {
+            _client->processRequestQueues();
+        }
+    private:
+        EnginioClientPrivate *_client;
+    };
+
+    class ProcessDeadlinesFunctor
+    {
+    public:
+        ProcessDeadlinesFunctor(EnginioClientPrivate *client)
+            : _client(client)
+        {
+            Q_ASSERT(_client);
+        }
+
+        void operator ()()
+        {
+            _client->processDeadlines();
+        }
+    private:
+        EnginioClientPrivate *_client;
+    };
+
+    class DownloadReadyReadFunctor
+    {
+    public:
+        DownloadReadyReadFunctor(EnginioClientPrivate *client, QNetworkReply *reply)
+            : _client(client), _reply(reply)
+        {
+            Q_ASSERT(_client);
+            Q_ASSERT(_reply);
+        }
+
+        void operator ()()
+        {
+            _client->downloadReadyRead(_reply);
+        }
+    private:
+        EnginioClientPrivate *_client;
+        QNetworkReply *_reply;
+    };
+
 private:
 
+    QNetworkReply *sendRequest(QNetworkAccessManager::Operation operation, const QNetworkRequest &request, const QByteArray &data = QByteArray(), RequestClass requestClass = InteractiveRequest)
+    {
+        return sendRequest(operation, request, data, 0, 0, requestClass, data.size());
+    }
+    QNetworkReply *sendRequest(QNetworkAccessManager::Operation operation, const QNetworkRequest &request, QIODevice *body, RequestClass requestClass, qint64 transferSize)
+    {
+        return sendRequest(operation, request, QByteArray(), body, 0, requestClass, transferSize);
+    }
+    QNetworkReply *sendRequest(const QNetworkRequest &request, QHttpMultiPart *multiPart, RequestClass requestClass, qint64 transferSize)
+    {
+        return sendRequest(QNetworkAccessManager::PostOperation, request, QByteArray(), 0, multiPart, requestClass, transferSize);
+    }
+    QNetworkReply *sendRequest(QNetworkAccessManager::Operation operation, const QNetworkRequest &request, const QByteArray &data,
+                               QIODevice *body, QHttpMultiPart *multiPart, RequestClass requestClass, qint64 transferSize);
+    QNetworkReply *startRequest(QNetworkAccessManager::Operation operation, const QNetworkRequest &request, const QByteArray &data,
+                                QIODevice *body, QHttpMultiPart *multiPart, RequestClass requestClass, qint64 transferSize);
+    bool canStartRequest(RequestClass requestClass) const Q_REQUIRED_RESULT;
+    static bool isIdempotent(QNetworkAccessManager::Operation operation, const QNetworkRequest &request) Q_REQUIRED_RESULT;
+
+    QNetworkReply *downloadSegment(EnginioReply *ereply, FileDownload *download);
+    void scheduleDownloadSegments(EnginioReply *ereply, FileDownload *download);
+    bool downloadFinished(EnginioReply *ereply, QNetworkReply *nreply);
+    bool continueCreateWithFile(EnginioReply *ereply, QNetworkReply *nreply);
+    void abortDownloadSegments(FileDownload *download, QNetworkReply *except);
+    void finishDownload(FileDownload *download, bool complete);
+    static QJsonObject readDownloadInfo(const QString &path);
+    static void writeDownloadInfo(const QString &path, const QJsonObject &info);
+
     template<class T>
     QNetworkReply *uploadAsHttpMultiPart(const ObjectAdaptor<T> &object, QIODevice *device, const QString &mimeType)
     {
@@ -717,7 +1194,7 @@ private:
         req.setUrl(serviceUrl);
 
         QHttpMultiPart *multiPart = createHttpMultiPart(object, device, mimeType);
-        QNetworkReply *reply = networkManager()->post(req, multiPart);
+        QNetworkReply *reply = sendRequest(req, multiPart, BackgroundRequest, device->size());
         multiPart->setParent(reply);
         device->setParent(multiPart);
         _connections.append(QObject::connect(reply, &QNetworkReply::uploadProgress, UploadProgressFunctor(this, reply)));
@@ -762,7 +1239,7 @@ private:
         QNetworkRequest req(_request);
         req.setUrl(serviceUrl);
 
-        QNetworkReply *reply = networkManager()->post(req, object.toJson());
+        QNetworkReply *reply = sendRequest(QNetworkAccessManager::PostOperation, req, object.toJson(), BackgroundRequest);
         _chunkedUploads.insert(reply, qMakePair(device, static_cast<qint64>(0)));
         _connections.append(QObject::connect(reply, &QNetworkReply::uploadProgress, UploadProgressFunctor(this, reply)));
         return reply;
@@ -796,10 +1273,13 @@ private:
 
         Q_ASSERT(device->isOpen());
 
+        if (Q_UNLIKELY(_metrics->isEnabled()))
+            _metrics->chunkUploaded();
+
         ChunkDevice *chunkDevice = new ChunkDevice(device, startPos, _uploadChunkSize);
         chunkDevice->open(QIODevice::ReadOnly);
 
-        QNetworkReply *reply = networkManager()->put(req, chunkDevice);
+        QNetworkReply *reply = sendRequest(QNetworkAccessManager::PutOperation, req, chunkDevice, BulkRequest, endPos - startPos);
         chunkDevice->setParent(reply);
         _chunkedUploads.insert(reply, qMakePair(device, endPos));
         ereply->setNetworkReply(reply);
@@ -810,5 +1290,8 @@ private:
 #undef CHECK_AND_SET_URL_PATH_IMPL
 #undef CHECK_AND_SET_PATH_WITH_ID
 #undef CHECK_AND_SET_PATH
+#undef CHECK_AND_PREPARE_REQUEST_IMPL
+#undef CHECK_AND_PREPARE_REQUEST_WITH_ID
+#undef CHECK_AND_PREPARE_REQUEST
 
 #endif // ENGINIOCLIENT_P_H
@@ -36,13 +36,25 @@
 ****************************************************************************/
 
 #include "enginiodummyreply_p.h"
+#include "enginioclient_p.h"
 
-EnginioDummyReply::EnginioDummyReply(QObject *parent)
+EnginioDummyReply::EnginioDummyReply(EnginioClientPrivate *client, QObject *parent)
     : QNetworkReply(parent)
+    , _client(client)
 {
 }
 
-void EnginioDummyReply::abort() { Q_UNIMPLEMENTED(); }
+void EnginioDummyReply::abort()
+{
+    if (isFinished())
+        return;
+    setError(OperationCanceledError, QStringLiteral("Operation canceled"));
+    setFinished(true);
+    emit error(OperationCanceledError);
+    emit finished();
+    // the shared network manager did not create this reply, so it is completed directly
+    _client->replyFinished(this);
+}
 
 bool EnginioDummyReply::isSequential() const
 {
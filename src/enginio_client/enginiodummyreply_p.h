@@ -46,8 +46,9 @@ class EnginioReply;
 class ENGINIOCLIENT_EXPORT EnginioDummyReply : public QNetworkReply
 {
     Q_OBJECT
+    EnginioClientPrivate *_client;
 public:
-    explicit EnginioDummyReply(QObject *parent = 0);
+    explicit EnginioDummyReply(EnginioClientPrivate *client, QObject *parent = 0);
 
     virtual void abort() Q_DECL_OVERRIDE;
     virtual bool isSequential() const Q_DECL_OVERRIDE;
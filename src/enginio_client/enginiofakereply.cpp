@@ -53,10 +53,28 @@ struct FinishedFunctor
 EnginioFakeReply::EnginioFakeReply(EnginioClientPrivate *parent, QByteArray msg)
     : QNetworkReply(parent->q_ptr)
     , _msg(msg)
+{
+    init(parent, 400);
+}
+
+/*!
+  \internal
+  Creates a reply which finishes with \a data as a content. The reply is an error
+  only if \a backendStatus is an HTTP error code.
+*/
+EnginioFakeReply::EnginioFakeReply(EnginioClientPrivate *parent, QByteArray data, int backendStatus)
+    : QNetworkReply(parent->q_ptr)
+    , _msg(data)
+{
+    init(parent, backendStatus);
+}
+
+void EnginioFakeReply::init(EnginioClientPrivate *parent, int backendStatus)
 {
     QIODevice::open(QIODevice::ReadOnly | QIODevice::Unbuffered);
-    setError(ContentNotFoundError, QString::fromUtf8(msg));
-    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 400);
+    if (backendStatus >= 400)
+        setError(ContentNotFoundError, QString::fromUtf8(_msg));
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, backendStatus);
     QNetworkAccessManager *qnam = parent->networkManager();
     setFinished(true);
     FinishedFunctor fin = {qnam, this};
@@ -64,7 +82,14 @@ EnginioFakeReply::EnginioFakeReply(EnginioClientPrivate *parent, QByteArray msg)
     QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
 }
 
-void EnginioFakeReply::abort() {}
+void EnginioFakeReply::abort()
+{
+    // The finished signal is still pending, so the content can be replaced.
+    // EnginioReply::abort() does not call it after the signal was delivered.
+    _msg.clear();
+    setError(OperationCanceledError, QStringLiteral("Operation canceled"));
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, QVariant());
+}
 
 bool EnginioFakeReply::isSequential() const
 {
@@ -81,7 +106,7 @@ qint64 EnginioFakeReply::readData(char *dest, qint64 n)
     if (pos() > _msg.size())
         return -1;
     qint64 size = qMin(qint64(_msg.size() - pos()), n);
-    memcpy(dest, _msg.constData(), size);
+    memcpy(dest, _msg.constData() + pos(), size);
     return size;
 }
 
@@ -50,12 +50,16 @@ class ENGINIOCLIENT_EXPORT EnginioFakeReply : public QNetworkReply
     QByteArray _msg;
 public:
     explicit EnginioFakeReply(EnginioClientPrivate *parent, QByteArray msg);
+    EnginioFakeReply(EnginioClientPrivate *parent, QByteArray data, int backendStatus);
 
     virtual void abort() Q_DECL_OVERRIDE;
     virtual bool isSequential() const Q_DECL_OVERRIDE;
     virtual qint64 size() const Q_DECL_OVERRIDE;
     virtual qint64 readData(char *dest, qint64 n) Q_DECL_OVERRIDE;
     virtual qint64 writeData(const char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+
+private:
+    void init(EnginioClientPrivate *parent, int backendStatus);
 };
 
 #endif // ENGINIOFAKEREPLY_P_H
@@ -0,0 +1,582 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#include "enginiometrics_p.h"
+#include "enginioreply.h"
+
+#include <QtCore/qdatetime.h>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qstringlist.h>
+#include <QtNetwork/qnetworkrequest.h>
+
+/*!
+  \class EnginioMetrics
+  \inmodule enginio-qt
+  \ingroup enginio-client
+  \target EnginioMetricsCpp
+  \brief EnginioMetrics reports what an EnginioClient does on the network.
+
+  Every EnginioClient has one instance, returned by EnginioClient::metrics(). Nothing is
+  collected until \l enabled is set, a disabled instance does not slow the requests down.
+
+  The properties are the totals since the last reset(), snapshot() returns everything,
+  including the request count, errors and latency histogram per operation and the
+  count per HTTP status, in a form which can be passed on to a monitoring system:
+
+  \code
+    client->metrics()->setEnabled(true);
+    ...
+    QJsonObject metrics = client->metrics()->snapshot();
+  \endcode
+
+  An operation is the HTTP method and the resource of a request, for example "GET objects",
+  "PUT files/chunk" or "POST auth/identity".
+
+  If \l tracing is set as well, the requestTraced() signal is emitted for every finished
+  request with the time it spent in each phase.
+
+  For the QML version see \l {Enginio1::EnginioMetrics}{EnginioMetrics (QML)}
+*/
+
+/*!
+  \qmltype EnginioMetrics
+  \instantiates EnginioMetrics
+  \inqmlmodule Enginio 1
+  \ingroup engino-qml
+
+  \brief Reports what an Enginio client does on the network
+
+  \code
+    Enginio {
+        id: enginio
+        metrics.enabled: true
+    }
+    Text {
+        text: enginio.metrics.requestCount + " requests, " + enginio.metrics.inFlight + " running"
+    }
+  \endcode
+
+  The QML version of EnginioMetrics supports the same functionality as the C++ version.
+  \l {EnginioMetricsCpp}{EnginioMetrics C++}
+*/
+
+/*!
+  \property EnginioMetrics::enabled
+  \brief Whether the metrics are collected, false by default.
+
+  Disabling the metrics drops the running requests from the \l inFlight count,
+  the totals are kept until reset() is called.
+*/
+
+/*!
+  \qmlproperty bool Enginio1::EnginioMetrics::enabled
+  Whether the metrics are collected, false by default.
+*/
+
+/*!
+  \property EnginioMetrics::tracing
+  \brief Whether requestTraced() is emitted for finished requests, false by default.
+
+  Tracing has an effect only if the metrics are \l enabled. A traced response is
+  parsed before the finished signal, so that the time spent on it can be reported.
+*/
+
+/*!
+  \qmlproperty bool Enginio1::EnginioMetrics::tracing
+  Whether requestTraced() is emitted for finished requests, false by default.
+*/
+
+/*!
+  \property EnginioMetrics::requestCount
+  \brief The number of finished requests, including the failed ones.
+*/
+
+/*!
+  \property EnginioMetrics::errorCount
+  \brief The number of requests which finished with an error.
+*/
+
+/*!
+  \property EnginioMetrics::retryCount
+  \brief The number of times a request was repeated after a transient failure.
+  \sa EnginioClient::maxAttempts
+*/
+
+/*!
+  \property EnginioMetrics::uploadChunkCount
+  \brief The number of chunks sent by chunked file uploads.
+*/
+
+/*!
+  \property EnginioMetrics::inFlight
+  \brief The number of requests which are queued or running.
+*/
+
+/*!
+  \property EnginioMetrics::bytesSent
+  \brief The size of the request bodies sent, including repeated requests.
+*/
+
+/*!
+  \property EnginioMetrics::bytesReceived
+  \brief The size of the response bodies received.
+*/
+
+/*!
+  \property EnginioMetrics::compressionRatio
+  \brief The compressed size of the request bodies sent gzip compressed divided by their original size.
+
+  It is 1 if no request body was compressed.
+  \sa EnginioClient::compressionThreshold
+*/
+
+/*!
+  \qmlproperty int Enginio1::EnginioMetrics::requestCount
+  The number of finished requests, including the failed ones.
+*/
+
+/*!
+  \qmlproperty int Enginio1::EnginioMetrics::errorCount
+  The number of requests which finished with an error.
+*/
+
+/*!
+  \qmlproperty int Enginio1::EnginioMetrics::inFlight
+  The number of requests which are queued or running.
+*/
+
+/*!
+  \fn EnginioMetrics::updated()
+  \brief The signal is emitted when a request is queued or finished while the metrics are enabled.
+*/
+
+/*!
+  \fn EnginioMetrics::requestTraced(const QJsonObject &span)
+  \brief The signal is emitted for each finished request if \l tracing is enabled.
+
+  The \a span contains the operation, the url path, the HTTP status, whether the request
+  failed, the number of attempts, the transferred bytes and the phases of the request in
+  milliseconds since it was queued: "sent", "firstByte", "received" and "finished". The time
+  between "received" and "finished" was spent on parsing the response. "start" is the time
+  the request was queued in milliseconds since the epoch.
+*/
+
+/*!
+  \fn EnginioMetrics::enabledChanged(bool enabled)
+  \internal
+*/
+
+/*!
+  \fn EnginioMetrics::tracingChanged(bool tracing)
+  \internal
+*/
+
+const int EnginioMetricsPrivate::BucketBounds[BucketCount - 1] = {
+    1, 2, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000
+};
+
+EnginioMetricsPrivate::Histogram::Histogram()
+    : count(0)
+    , sum(0)
+{
+    for (int i = 0; i < BucketCount; ++i)
+        buckets[i] = 0;
+}
+
+void EnginioMetricsPrivate::Histogram::add(qint64 msecs)
+{
+    int bucket = 0;
+    while (bucket < BucketCount - 1 && msecs > BucketBounds[bucket])
+        ++bucket;
+    ++buckets[bucket];
+    ++count;
+    sum += msecs;
+}
+
+QJsonObject EnginioMetricsPrivate::Histogram::toJson() const
+{
+    // cumulative, every bucket counts the requests which took at most "le" ms
+    QJsonArray result;
+    int cumulative = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        cumulative += buckets[i];
+        QJsonObject bucket;
+        if (i < BucketCount - 1)
+            bucket[QStringLiteral("le")] = BucketBounds[i];
+        else
+            bucket[QStringLiteral("le")] = QStringLiteral("+Inf");
+        bucket[QStringLiteral("count")] = cumulative;
+        result.append(bucket);
+    }
+
+    QJsonObject histogram;
+    histogram[QStringLiteral("count")] = count;
+    histogram[QStringLiteral("sum")] = double(sum);
+    histogram[QStringLiteral("buckets")] = result;
+    return histogram;
+}
+
+EnginioMetricsPrivate::OperationMetrics::OperationMetrics()
+    : count(0)
+    , errors(0)
+{}
+
+EnginioMetricsPrivate::EnginioMetricsPrivate(EnginioMetrics *metrics)
+    : q(metrics)
+    , _enabled(false)
+    , _tracing(false)
+{
+    _clock.start();
+    clear();
+}
+
+EnginioMetricsPrivate::~EnginioMetricsPrivate()
+{
+    foreach (QNetworkReply *reply, _spans.keys())
+        dropSpan(reply);
+}
+
+QString EnginioMetricsPrivate::operationName(const QNetworkReply *reply)
+{
+    QString method;
+    const QByteArray methodOverride = reply->request().rawHeader("X-HTTP-Method-Override");
+    if (!methodOverride.isEmpty()) { // a query sent in the body
+        method = QString::fromLatin1(methodOverride);
+    } else switch (reply->operation()) {
+    case QNetworkAccessManager::HeadOperation: method = QStringLiteral("HEAD"); break;
+    case QNetworkAccessManager::GetOperation: method = QStringLiteral("GET"); break;
+    case QNetworkAccessManager::PutOperation: method = QStringLiteral("PUT"); break;
+    case QNetworkAccessManager::PostOperation: method = QStringLiteral("POST"); break;
+    case QNetworkAccessManager::DeleteOperation: method = QStringLiteral("DELETE"); break;
+    default:
+        method = QString::fromLatin1(reply->request().attribute(QNetworkRequest::CustomVerbAttribute).toByteArray());
+    }
+
+    // "/v1/objects/todos/{id}" is "objects", "/v1/files/{id}/chunk" is "files/chunk"
+    const QStringList segments = reply->url().path().split(QLatin1Char('/'), QString::SkipEmptyParts);
+    if (segments.value(0) != QStringLiteral("v1"))
+        return method + QStringLiteral(" download"); // an expiring file url
+    QString resource = segments.value(1);
+    const QString last = segments.last();
+    if (segments.count() > 2 && (last == QStringLiteral("chunk") || last == QStringLiteral("download_url")
+                                 || last == QStringLiteral("access") || last == QStringLiteral("members")
+                                 || last == QStringLiteral("identity")))
+        resource += QLatin1Char('/') + last;
+    return method + QLatin1Char(' ') + resource;
+}
+
+void EnginioMetricsPrivate::requestQueued(QNetworkReply *reply)
+{
+    Span span;
+    span.operation = operationName(reply);
+    span.path = reply->url().path();
+    span.queued = _clock.elapsed();
+    span.sent = 0;
+    span.firstByte = 0;
+    span.attempts = 0;
+    span.bytesSent = 0;
+    span.metaDataChanged = QObject::connect(reply, &QNetworkReply::metaDataChanged, FirstByteFunctor(this, reply));
+    span.destroyed = QObject::connect(reply, &QNetworkReply::destroyed, ReplyDestroyedFunctor(this, reply));
+    _spans.insert(reply, span);
+    _peakInFlight = qMax(_peakInFlight, _spans.count());
+    emit q->updated();
+}
+
+void EnginioMetricsPrivate::requestSent(QNetworkReply *reply, qint64 transferSize)
+{
+    QHash<QNetworkReply*, Span>::iterator i = _spans.find(reply);
+    if (i == _spans.end())
+        return;
+    if (!i->sent)
+        i->sent = _clock.elapsed();
+    ++i->attempts;
+    i->bytesSent += transferSize;
+    _bytesSent += transferSize;
+}
+
+void EnginioMetricsPrivate::firstByte(QNetworkReply *reply)
+{
+    QHash<QNetworkReply*, Span>::iterator i = _spans.find(reply);
+    if (i != _spans.end() && !i->firstByte)
+        i->firstByte = _clock.elapsed();
+}
+
+void EnginioMetricsPrivate::requestFinished(QNetworkReply *reply, EnginioReply *ereply, bool parse)
+{
+    QHash<QNetworkReply*, Span>::iterator i = _spans.find(reply);
+    if (i == _spans.end())
+        return;
+    const Span span = i.value();
+    _spans.erase(i);
+    QObject::disconnect(span.metaDataChanged);
+    QObject::disconnect(span.destroyed);
+
+    const qint64 received = _clock.elapsed();
+    if (parse && _tracing)
+        ereply->data(); // the result is cached by the reply
+    const qint64 finished = _clock.elapsed();
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const bool error = reply->error() != QNetworkReply::NoError;
+    const QVariant contentLength = reply->header(QNetworkRequest::ContentLengthHeader);
+    const qint64 bytesReceived = contentLength.isValid() ? contentLength.toLongLong() : reply->bytesAvailable();
+    // QNetworkAccessManager keeps Content-Encoding of a response it decoded, but drops its Content-Length
+    const QByteArray contentEncoding = reply->rawHeader("Content-Encoding");
+
+    ++_requestCount;
+    if (error)
+        ++_errorCount;
+    _bytesReceived += bytesReceived;
+    if (!contentEncoding.isEmpty() && contentEncoding != "identity") {
+        ++_encodedResponses;
+        _encodedResponseBytes += bytesReceived;
+    }
+    ++_statuses[status];
+    OperationMetrics &operation = _operations[span.operation];
+    ++operation.count;
+    if (error)
+        ++operation.errors;
+    operation.latency.add(received - span.queued);
+
+    emit q->updated();
+
+    if (!_tracing)
+        return;
+
+    QJsonObject trace;
+    trace[QStringLiteral("operation")] = span.operation;
+    trace[QStringLiteral("path")] = span.path;
+    trace[QStringLiteral("status")] = status;
+    trace[QStringLiteral("error")] = error;
+    trace[QStringLiteral("attempts")] = span.attempts;
+    trace[QStringLiteral("bytesSent")] = double(span.bytesSent);
+    trace[QStringLiteral("bytesReceived")] = double(bytesReceived);
+    trace[QStringLiteral("start")] = double(QDateTime::currentMSecsSinceEpoch() - (finished - span.queued));
+    trace[QStringLiteral("sent")] = double(span.sent ? span.sent - span.queued : 0);
+    trace[QStringLiteral("firstByte")] = double(span.firstByte ? span.firstByte - span.queued : 0);
+    trace[QStringLiteral("received")] = double(received - span.queued);
+    trace[QStringLiteral("finished")] = double(finished - span.queued);
+    emit q->requestTraced(trace);
+}
+
+void EnginioMetricsPrivate::requestRetried()
+{
+    ++_retryCount;
+}
+
+void EnginioMetricsPrivate::chunkUploaded()
+{
+    ++_uploadChunkCount;
+}
+
+void EnginioMetricsPrivate::requestCompressed(qint64 size, qint64 compressedSize)
+{
+    ++_compressedRequests;
+    _compressedRequestBytes += size;
+    _compressedRequestBytesSent += compressedSize;
+}
+
+void EnginioMetricsPrivate::dropSpan(QNetworkReply *reply)
+{
+    const Span span = _spans.take(reply);
+    QObject::disconnect(span.metaDataChanged);
+    QObject::disconnect(span.destroyed);
+}
+
+void EnginioMetricsPrivate::clear()
+{
+    _requestCount = 0;
+    _errorCount = 0;
+    _retryCount = 0;
+    _uploadChunkCount = 0;
+    _peakInFlight = _spans.count();
+    _bytesSent = 0;
+    _bytesReceived = 0;
+    _compressedRequests = 0;
+    _compressedRequestBytes = 0;
+    _compressedRequestBytesSent = 0;
+    _encodedResponses = 0;
+    _encodedResponseBytes = 0;
+    _operations.clear();
+    _statuses.clear();
+}
+
+EnginioMetrics::EnginioMetrics(QObject *parent)
+    : QObject(parent)
+    , d(new EnginioMetricsPrivate(this))
+{}
+
+/*!
+  Destroys the EnginioMetrics.
+*/
+EnginioMetrics::~EnginioMetrics()
+{}
+
+bool EnginioMetrics::isEnabled() const
+{
+    return d->_enabled;
+}
+
+void EnginioMetrics::setEnabled(bool enabled)
+{
+    if (enabled == d->_enabled)
+        return;
+    d->_enabled = enabled;
+    if (!enabled) {
+        foreach (QNetworkReply *reply, d->_spans.keys())
+            d->dropSpan(reply);
+    }
+    emit enabledChanged(enabled);
+}
+
+bool EnginioMetrics::isTracing() const
+{
+    return d->_tracing;
+}
+
+void EnginioMetrics::setTracing(bool tracing)
+{
+    if (tracing == d->_tracing)
+        return;
+    d->_tracing = tracing;
+    emit tracingChanged(tracing);
+}
+
+int EnginioMetrics::requestCount() const
+{
+    return d->_requestCount;
+}
+
+int EnginioMetrics::errorCount() const
+{
+    return d->_errorCount;
+}
+
+int EnginioMetrics::retryCount() const
+{
+    return d->_retryCount;
+}
+
+int EnginioMetrics::uploadChunkCount() const
+{
+    return d->_uploadChunkCount;
+}
+
+int EnginioMetrics::inFlight() const
+{
+    return d->_spans.count();
+}
+
+qint64 EnginioMetrics::bytesSent() const
+{
+    return d->_bytesSent;
+}
+
+qint64 EnginioMetrics::bytesReceived() const
+{
+    return d->_bytesReceived;
+}
+
+qreal EnginioMetrics::compressionRatio() const
+{
+    if (!d->_compressedRequestBytes)
+        return 1;
+    return qreal(d->_compressedRequestBytesSent) / d->_compressedRequestBytes;
+}
+
+/*!
+  Returns all metrics collected since the last reset() as JSON.
+
+  The latency histograms are in milliseconds, each bucket counts the requests
+  which took at most "le" milliseconds. "compression" reports the request bodies
+  sent gzip compressed with their size before and after the compression, and the
+  responses received gzip or deflate encoded with their decoded size.
+*/
+QJsonObject EnginioMetrics::snapshot() const
+{
+    QJsonObject operations;
+    for (QHash<QString, EnginioMetricsPrivate::OperationMetrics>::const_iterator i = d->_operations.constBegin();
+         i != d->_operations.constEnd(); ++i) {
+        QJsonObject operation;
+        operation[QStringLiteral("count")] = i->count;
+        operation[QStringLiteral("errors")] = i->errors;
+        operation[QStringLiteral("latency")] = i->latency.toJson();
+        operations[i.key()] = operation;
+    }
+
+    QJsonObject statuses;
+    for (QHash<int, int>::const_iterator i = d->_statuses.constBegin(); i != d->_statuses.constEnd(); ++i)
+        statuses[QString::number(i.key())] = i.value();
+
+    int queued = 0;
+    for (QHash<QNetworkReply*, EnginioMetricsPrivate::Span>::const_iterator i = d->_spans.constBegin(); i != d->_spans.constEnd(); ++i) {
+        if (!i->sent)
+            ++queued;
+    }
+
+    QJsonObject compression;
+    compression[QStringLiteral("requests")] = d->_compressedRequests;
+    compression[QStringLiteral("requestBytes")] = double(d->_compressedRequestBytes);
+    compression[QStringLiteral("requestBytesSent")] = double(d->_compressedRequestBytesSent);
+    compression[QStringLiteral("ratio")] = compressionRatio();
+    compression[QStringLiteral("responses")] = d->_encodedResponses;
+    compression[QStringLiteral("responseBytes")] = double(d->_encodedResponseBytes);
+
+    QJsonObject result;
+    result[QStringLiteral("requests")] = d->_requestCount;
+    result[QStringLiteral("errors")] = d->_errorCount;
+    result[QStringLiteral("retries")] = d->_retryCount;
+    result[QStringLiteral("uploadChunks")] = d->_uploadChunkCount;
+    result[QStringLiteral("bytesSent")] = double(d->_bytesSent);
+    result[QStringLiteral("bytesReceived")] = double(d->_bytesReceived);
+    result[QStringLiteral("inFlight")] = d->_spans.count();
+    result[QStringLiteral("queued")] = queued;
+    result[QStringLiteral("peakInFlight")] = d->_peakInFlight;
+    result[QStringLiteral("operations")] = operations;
+    result[QStringLiteral("statuses")] = statuses;
+    result[QStringLiteral("compression")] = compression;
+    return result;
+}
+
+/*!
+  Sets all totals to zero, the running requests are still counted when they finish.
+*/
+void EnginioMetrics::reset()
+{
+    d->clear();
+    emit updated();
+}
@@ -0,0 +1,96 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#ifndef ENGINIOMETRICS_H
+#define ENGINIOMETRICS_H
+
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qscopedpointer.h>
+
+#include "enginioclient_global.h"
+
+class EnginioMetricsPrivate;
+class ENGINIOCLIENT_EXPORT EnginioMetrics : public QObject
+{
+    Q_OBJECT
+public:
+    ~EnginioMetrics();
+
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool tracing READ isTracing WRITE setTracing NOTIFY tracingChanged)
+    Q_PROPERTY(int requestCount READ requestCount NOTIFY updated)
+    Q_PROPERTY(int errorCount READ errorCount NOTIFY updated)
+    Q_PROPERTY(int retryCount READ retryCount NOTIFY updated)
+    Q_PROPERTY(int uploadChunkCount READ uploadChunkCount NOTIFY updated)
+    Q_PROPERTY(int inFlight READ inFlight NOTIFY updated)
+    Q_PROPERTY(qint64 bytesSent READ bytesSent NOTIFY updated)
+    Q_PROPERTY(qint64 bytesReceived READ bytesReceived NOTIFY updated)
+    Q_PROPERTY(qreal compressionRatio READ compressionRatio NOTIFY updated)
+
+    bool isEnabled() const Q_REQUIRED_RESULT;
+    void setEnabled(bool enabled);
+    bool isTracing() const Q_REQUIRED_RESULT;
+    void setTracing(bool tracing);
+
+    int requestCount() const Q_REQUIRED_RESULT;
+    int errorCount() const Q_REQUIRED_RESULT;
+    int retryCount() const Q_REQUIRED_RESULT;
+    int uploadChunkCount() const Q_REQUIRED_RESULT;
+    int inFlight() const Q_REQUIRED_RESULT;
+    qint64 bytesSent() const Q_REQUIRED_RESULT;
+    qint64 bytesReceived() const Q_REQUIRED_RESULT;
+    qreal compressionRatio() const Q_REQUIRED_RESULT;
+
+    Q_INVOKABLE QJsonObject snapshot() const Q_REQUIRED_RESULT;
+    Q_INVOKABLE void reset();
+
+Q_SIGNALS:
+    void enabledChanged(bool enabled);
+    void tracingChanged(bool tracing);
+    void updated();
+    void requestTraced(const QJsonObject &span);
+
+private:
+    explicit EnginioMetrics(QObject *parent);
+    Q_DISABLE_COPY(EnginioMetrics)
+    QScopedPointer<EnginioMetricsPrivate> d;
+    friend class EnginioMetricsPrivate;
+    friend class EnginioClientPrivate;
+};
+
+#endif // ENGINIOMETRICS_H
@@ -0,0 +1,174 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#ifndef ENGINIOMETRICS_P_H
+#define ENGINIOMETRICS_P_H
+
+#include "enginiometrics.h"
+
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qstring.h>
+#include <QtNetwork/qnetworkreply.h>
+
+class EnginioReply;
+
+/*!
+  \brief Collects the numbers published by EnginioMetrics
+
+  EnginioClientPrivate calls the hooks only if isEnabled() returns true, so
+  a disabled instance costs one branch per request.
+
+  \internal
+*/
+class EnginioMetricsPrivate
+{
+public:
+    enum { BucketCount = 14 };
+    static const int BucketBounds[BucketCount - 1]; // ms, the last bucket is unbounded
+
+    struct Histogram
+    {
+        Histogram();
+        void add(qint64 msecs);
+        QJsonObject toJson() const;
+
+        int count;
+        qint64 sum; // ms
+        int buckets[BucketCount];
+    };
+
+    struct OperationMetrics
+    {
+        OperationMetrics();
+
+        int count;
+        int errors;
+        Histogram latency;
+    };
+
+    // the phases of one request in ms since the timer start, 0 if not reached yet
+    struct Span
+    {
+        QString operation;
+        QString path;
+        qint64 queued;
+        qint64 sent;
+        qint64 firstByte;
+        int attempts;
+        qint64 bytesSent;
+        QMetaObject::Connection metaDataChanged;
+        QMetaObject::Connection destroyed;
+    };
+
+    class FirstByteFunctor
+    {
+        EnginioMetricsPrivate *_metrics;
+        QNetworkReply *_reply;
+    public:
+        FirstByteFunctor(EnginioMetricsPrivate *metrics, QNetworkReply *reply)
+            : _metrics(metrics)
+            , _reply(reply)
+        {
+            Q_ASSERT(_metrics);
+        }
+
+        void operator ()()
+        {
+            _metrics->firstByte(_reply);
+        }
+    };
+
+    class ReplyDestroyedFunctor
+    {
+        EnginioMetricsPrivate *_metrics;
+        QNetworkReply *_reply;
+    public:
+        ReplyDestroyedFunctor(EnginioMetricsPrivate *metrics, QNetworkReply *reply)
+            : _metrics(metrics)
+            , _reply(reply)
+        {
+            Q_ASSERT(_metrics);
+        }
+
+        void operator ()()
+        {
+            _metrics->dropSpan(_reply);
+        }
+    };
+
+    EnginioMetrics *q;
+    bool _enabled;
+    bool _tracing;
+    QElapsedTimer _clock;
+    int _requestCount;
+    int _errorCount;
+    int _retryCount;
+    int _uploadChunkCount;
+    int _peakInFlight;
+    qint64 _bytesSent;
+    qint64 _bytesReceived;
+    int _compressedRequests;
+    qint64 _compressedRequestBytes; // before the compression
+    qint64 _compressedRequestBytesSent;
+    int _encodedResponses; // decoded by QNetworkAccessManager
+    qint64 _encodedResponseBytes; // after the decoding
+    QHash<QString, OperationMetrics> _operations;
+    QHash<int, int> _statuses; // by HTTP status, 0 for network errors
+    QHash<QNetworkReply*, Span> _spans; // running requests
+
+    explicit EnginioMetricsPrivate(EnginioMetrics *metrics);
+    ~EnginioMetricsPrivate();
+
+    static EnginioMetricsPrivate *get(EnginioMetrics *metrics) { return metrics->d.data(); }
+
+    bool isEnabled() const Q_REQUIRED_RESULT { return _enabled; }
+
+    void requestQueued(QNetworkReply *reply);
+    void requestSent(QNetworkReply *reply, qint64 transferSize);
+    void firstByte(QNetworkReply *reply);
+    void requestFinished(QNetworkReply *reply, EnginioReply *ereply, bool parse);
+    void requestRetried();
+    void chunkUploaded();
+    void requestCompressed(qint64 size, qint64 compressedSize);
+    void dropSpan(QNetworkReply *reply);
+    void clear();
+
+    static QString operationName(const QNetworkReply *reply);
+};
+
+#endif // ENGINIOMETRICS_P_H
@@ -40,107 +40,75 @@
 #include "enginioclient_p.h"
 #include "enginiofakereply_p.h"
 #include "enginiodummyreply_p.h"
+#include "enginiomodelattacheddata_p.h"
+#include "enginiomodeljournal_p.h"
+#include "enginiotimestamp_p.h"
 
 #include <QtCore/qobject.h>
 #include <QtCore/qvector.h>
+#include <QtCore/qcryptographichash.h>
+#include <QtCore/qdatastream.h>
+#include <QtCore/qdir.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qsavefile.h>
 #include <QtCore/qjsonobject.h>
 #include <QtCore/qjsonarray.h>
+#include <QtCore/qjsondocument.h>
 #include <QtCore/qdatetime.h>
+#include <QtCore/qpointer.h>
+#include <QtCore/qtimer.h>
 #include <QtCore/quuid.h>
 
-struct EnginioModelPrivateAttachedData
+class ObjectsContainer
 {
-    uint ref;
-    int row;
-    EnginioReply *createReply;
-};
-Q_DECLARE_TYPEINFO(EnginioModelPrivateAttachedData, Q_PRIMITIVE_TYPE);
-
-#ifndef QT_NO_DEBUG_STREAM
-QDebug operator<<(QDebug dbg, const EnginioModelPrivateAttachedData &a)
-{
-    dbg.nospace() << "EnginioModelPrivateAttachedData(";
-    dbg.nospace() << a.ref << ", "<< a.row;
-    dbg.nospace() << ')';
-    return dbg.space();
-}
-#endif
-
-class AttachedDataContainer: public QHash<QString /* object id */, EnginioModelPrivateAttachedData>
-{
-    // TODO QHash is not the right structure, we need to index by id, row and we want to make
-    // bulk update of the data.
-    typedef EnginioModelPrivateAttachedData AttachedData;
-    typedef QHash<QString /* object id */, AttachedData> Base;
-public:
-    using Base::contains;
-    using Base::value;
+    // The updatedAt of every object is converted once, when the object is stored,
+    // so that checking which version of an object is newer compares integers.
+    QJsonArray _objects;
+    QVector<qint64> _updatedAt;
 
-    bool contains(int row) const
+    static qint64 updatedAtOf(const QJsonValue &value)
     {
-        // TODO optimize it
-        for (Base::const_iterator i = constBegin();
-             i != constEnd();
-             ++i) {
-            if (i.value().row == row)
-                return true;
-        }
-        return false;
+        return EnginioTimestamp::fromJson(value.toObject()[EnginioString::updatedAt]);
     }
 
-    AttachedData value(int row) const
+public:
+    ObjectsContainer &operator=(const QJsonArray &objects)
     {
-        // TODO optimize it
-        for (Base::const_iterator i = constBegin();
-             i != constEnd();
-             ++i) {
-            if (i.value().row == row)
-                return i.value();
-        }
-        Q_UNREACHABLE();
+        _objects = objects;
+        _updatedAt.resize(objects.count());
+        for (int i = 0; i < objects.count(); ++i)
+            _updatedAt[i] = updatedAtOf(objects.at(i));
+        return *this;
     }
 
-    void updateAllDataAfterRow(const int row) {
-        // TODO optimize it is almost O(n log(n))
-        QList<QString> keys = this->keys();
-        foreach (const QString &key, keys) {
-            AttachedData &data = (*this)[key];
-            if (data.row > row)
-                --data.row;
-            else if (data.row == row)
-                data.row = -1;
-        }
+    const QJsonArray &array() const { return _objects; }
+    int count() const { return _objects.count(); }
+    bool isEmpty() const { return _objects.isEmpty(); }
+    QJsonValue at(int row) const { return _objects.at(row); }
+    QJsonValue first() const { return _objects.first(); }
+    qint64 updatedAt(int row) const { return _updatedAt.at(row); }
+
+    void append(const QJsonValue &value)
+    {
+        _objects.append(value);
+        _updatedAt.append(updatedAtOf(value));
     }
 
-    AttachedData ref(const QString &id, int row)
+    void replace(int row, const QJsonValue &value)
     {
-        AttachedData &data = (*this)[id];
-        ++data.ref;
-        Q_ASSERT(data.ref == 1 || data.row == row);
-        data.row = row;
-        return data;
+        replace(row, value, updatedAtOf(value));
     }
 
-    AttachedData ref(int row)
+    void replace(int row, const QJsonValue &value, qint64 updatedAt)
     {
-        // TODO optimize it
-        Base::iterator i = begin();
-        for (; i != end(); ++i) {
-            if (i.value().row == row)
-                break;
-        }
-        AttachedData &data = *i;
-        ++data.ref;
-        return data;
+        _objects.replace(row, value);
+        _updatedAt[row] = updatedAt;
     }
 
-    AttachedData deref(const QString &id)
+    void removeAt(int row)
     {
-        Q_ASSERT(contains(id));
-        AttachedData attachedData = take(id);
-        if (--attachedData.ref)
-            insert(id, attachedData);
-        return attachedData;
+        _objects.removeAt(row);
+        _updatedAt.remove(row);
     }
 };
 
@@ -153,6 +121,8 @@ class EnginioModelPrivate {
 
     const static int FullModelReset;
     const static int IncrementalModelUpdate;
+    const static int DeltaModelUpdate;
+    const static int TotalCountUpdate;
     mutable QMap<const EnginioReply*, QPair<int /*row*/, QJsonObject> > _dataChanged;
     typedef EnginioModelPrivateAttachedData AttachedData;
     AttachedDataContainer _attachedData;
@@ -162,7 +132,33 @@ class EnginioModelPrivate {
     unsigned _rolesCounter;
     QHash<int, QString> _roles;
 
-    QJsonArray _data; // TODO replace by a sparse array, and add laziness
+    ObjectsContainer _data; // TODO replace by a sparse array, and add laziness
+
+    enum { JournalRetryInterval = 15000 };
+    EnginioModelJournal _journal;
+    const EnginioReply *_journalReply;
+    QTimer *_journalTimer;
+    bool _offline;
+
+    enum {
+        SnapshotMagic = 0x45534e50, // "ESNP"
+        SnapshotVersion = 1,
+        SnapshotHeaderSize = 8
+    };
+    QString _snapshotDirectory;
+    QString _snapshotFile;
+    bool _snapshotDirty;
+    bool _keepRows; // the rows belong to the current query, new results are merged into them
+
+    enum { DeltaSyncLimit = 100 };
+    bool _deltaSync;
+    qint64 _watermark; // the newest updatedAt fetched from the backend
+
+    EnginioModel::ConflictPolicy _conflictPolicy;
+    QHash<QString, qint64> _editTimes; // the last local edit of an object in the backend clock, for LastWriterWins
+    qint64 _clockOffset; // the backend clock minus the client clock
+
+    int _totalCount; // -1 if unknown
 
     class EnginioDestroyed
     {
@@ -212,6 +208,96 @@ class EnginioModelPrivate {
 
     };
 
+    class IdentityChanged
+    {
+        EnginioModelPrivate *model;
+    public:
+        IdentityChanged(EnginioModelPrivate *m)
+            : model(m)
+        {
+            Q_ASSERT(m);
+        }
+
+        void operator ()()
+        {
+            model->identityChanged();
+        }
+    };
+
+    class ResetWatermark
+    {
+        EnginioModelPrivate *model;
+    public:
+        ResetWatermark(EnginioModelPrivate *m)
+            : model(m)
+        {
+            Q_ASSERT(m);
+        }
+
+        void operator ()()
+        {
+            model->_watermark = EnginioTimestamp::Invalid;
+            model->_keepRows = false;
+            model->pruneEditTimes();
+        }
+    };
+
+    class SyncTotalCount
+    {
+        EnginioModelPrivate *model;
+    public:
+        SyncTotalCount(EnginioModelPrivate *m)
+            : model(m)
+        {
+            Q_ASSERT(m);
+        }
+
+        void operator ()()
+        {
+            // without pagination all matching objects are in the model
+            if (!model->isPaginated())
+                model->setTotalCount(model->_data.count());
+        }
+
+        void operator ()(const QModelIndex &, int, int)
+        {
+            operator ()();
+        }
+    };
+
+    class ReplayJournal
+    {
+        EnginioModelPrivate *model;
+    public:
+        ReplayJournal(EnginioModelPrivate *m)
+            : model(m)
+        {
+            Q_ASSERT(m);
+        }
+
+        void operator ()()
+        {
+            model->replayJournal();
+        }
+    };
+
+    class NetworkAccessibleChanged
+    {
+        EnginioModelPrivate *model;
+    public:
+        NetworkAccessibleChanged(EnginioModelPrivate *m)
+            : model(m)
+        {
+            Q_ASSERT(m);
+        }
+
+        void operator ()(QNetworkAccessManager::NetworkAccessibility accessible)
+        {
+            if (accessible == QNetworkAccessManager::Accessible)
+                model->replayJournal();
+        }
+    };
+
 public:
     EnginioModelPrivate(EnginioModel *q_ptr)
         : _enginio(0)
@@ -220,14 +306,37 @@ public:
         , _latestRequestedOffset(0)
         , _canFetchMore(false)
         , _rolesCounter(EnginioModel::SyncedRole)
+        , _journalReply(0)
+        , _journalTimer(new QTimer(q))
+        , _offline(false)
+        , _snapshotDirty(false)
+        , _keepRows(false)
+        , _deltaSync(false)
+        , _watermark(EnginioTimestamp::Invalid)
+        , _conflictPolicy(EnginioModel::ServerWins)
+        , _clockOffset(0)
+        , _totalCount(-1)
     {
+        _journalTimer->setSingleShot(true);
+        _journalTimer->setInterval(JournalRetryInterval);
+        QObject::connect(_journalTimer, &QTimer::timeout, ReplayJournal(this));
+        // the watermark has to be reset before the new query is executed
+        QObject::connect(q, &EnginioModel::queryChanged, ResetWatermark(this));
+        QObject::connect(q, &EnginioModel::operationChanged, ResetWatermark(this));
+        QObject::connect(q, &EnginioModel::enginioChanged, ResetWatermark(this));
         QObject::connect(q, &EnginioModel::queryChanged, QueryChanged(this));
         QObject::connect(q, &EnginioModel::operationChanged, QueryChanged(this));
         QObject::connect(q, &EnginioModel::enginioChanged, QueryChanged(this));
+        QObject::connect(q, &EnginioModel::journalFileChanged, QueryChanged(this));
+        QObject::connect(q, &EnginioModel::snapshotDirectoryChanged, QueryChanged(this));
+        QObject::connect(q, &EnginioModel::rowsInserted, SyncTotalCount(this));
+        QObject::connect(q, &EnginioModel::rowsRemoved, SyncTotalCount(this));
+        QObject::connect(q, &EnginioModel::modelReset, SyncTotalCount(this));
     }
 
     ~EnginioModelPrivate()
     {
+        saveSnapshot();
         foreach (const QMetaObject::Connection &connection, _connections)
             QObject::disconnect(connection);
     }
@@ -248,9 +357,14 @@ public:
         if (_enginio) {
             _connections.append(QObject::connect(_enginio, &EnginioClient::finished, FinishedRequest(this)));
             _connections.append(QObject::connect(_enginio, &QObject::destroyed, EnginioDestroyed(this)));
+            _connections.append(QObject::connect(_enginio, &EnginioClient::backendIdChanged, ResetWatermark(this)));
             _connections.append(QObject::connect(_enginio, &EnginioClient::backendIdChanged, QueryChanged(this)));
             _connections.append(QObject::connect(_enginio, &EnginioClient::backendSecretChanged, QueryChanged(this)));
+            _connections.append(QObject::connect(_enginio, &EnginioClient::sessionAuthenticated, IdentityChanged(this)));
+            _connections.append(QObject::connect(_enginio, &EnginioClient::sessionTerminated, IdentityChanged(this)));
+            _connections.append(QObject::connect(_enginio->networkManager(), &QNetworkAccessManager::networkAccessibleChanged, NetworkAccessibleChanged(this)));
         }
+        abandonJournalReply();
         emit q->enginioChanged(_enginio);
     }
 
@@ -261,6 +375,10 @@ public:
 
     EnginioReply *append(const QJsonObject &value)
     {
+        _snapshotDirty = true;
+        if (_journal.isOpen())
+            return appendJournaled(value);
+
         QJsonObject object(value);
         object[EnginioString::objectType] = _query[EnginioString::objectType]; // TODO think about it, it means that not all queries are valid
         EnginioReply *ereply = _enginio->create(object, _operation);
@@ -282,16 +400,23 @@ public:
             _dataChanged.insert(ereply, qMakePair(row, object));
             q->endInsertRows();
         }
+        adjustTotalCount(1);
         return ereply;
     }
 
     struct SwapNetworkReplyBase
     {
-        EnginioReply *_reply;
+        QPointer<EnginioReply> _reply;
         EnginioModelPrivate *_model;
         QJsonObject _object;
         QString _tmpId;
 
+        bool isAborted() const
+        {
+            // the dummy reply is finished only if the delayed operation was aborted
+            return !_reply || _reply->isFinished();
+        }
+
         void markAsError(QByteArray msg)
         {
             EnginioClientPrivate *client = EnginioClientPrivate::get(_model->_enginio);
@@ -323,6 +448,8 @@ public:
         SwapNetworkReplyBase d;
         void operator ()(EnginioReply *finishedCreateReply)
         {
+            if (d.isAborted())
+                return;
             if (finishedCreateReply->isError()) {
                 d.markAsError(QByteArrayLiteral("Dependent create query failed, so object coudl not be removed"));
             } else {
@@ -336,8 +463,11 @@ public:
 
     EnginioReply *remove(int row)
     {
+        _snapshotDirty = true;
         QJsonObject oldObject = _data.at(row).toObject();
         QString id = oldObject[EnginioString::id].toString();
+        if (_journal.isOpen() && !id.isEmpty())
+            return removeJournaled(row, oldObject, id);
         if (id.isEmpty())
             return removeDelayed(row, oldObject);
         return removeNow(row, oldObject, id);
@@ -416,20 +546,207 @@ public:
         if (!_enginio || _enginio->backendId().isEmpty() || _enginio->backendSecret().isEmpty())
             return;
         if (!_query.isEmpty()) {
-            const EnginioReply *ereply = _enginio->query(_query, _operation);
-            if (_canFetchMore)
-                _latestRequestedOffset = _query[EnginioString::limit].toDouble();
-            QObject::connect(ereply, &EnginioReply::finished, ereply, &EnginioReply::deleteLater);
-            _dataChanged.insert(ereply, qMakePair(FullModelReset, QJsonObject()));
+            if (!_snapshotDirectory.isEmpty()) {
+                const QString fileName = snapshotFileName();
+                if (fileName != _snapshotFile) {
+                    saveSnapshot();
+                    _snapshotFile = fileName;
+                    _keepRows = loadSnapshot();
+                }
+            }
+            if (_keepRows && canFetchDelta()) {
+                _keepRows = false;
+                fetchDelta();
+            } else {
+                const EnginioReply *ereply = _enginio->query(_query, _operation);
+                if (_canFetchMore)
+                    _latestRequestedOffset = _query[EnginioString::limit].toDouble();
+                QObject::connect(ereply, &EnginioReply::finished, ereply, &EnginioReply::deleteLater);
+                _dataChanged.insert(ereply, qMakePair(FullModelReset, QJsonObject()));
+                if (isPaginated())
+                    fetchTotalCount();
+            }
+        }
+        replayJournal();
+    }
+
+    bool isPaginated() const Q_REQUIRED_RESULT
+    {
+        return _query.contains(EnginioString::limit);
+    }
+
+    void fetchTotalCount()
+    {
+        const EnginioReply *ereply = _enginio->count(_query, _operation);
+        QObject::connect(ereply, &EnginioReply::finished, ereply, &EnginioReply::deleteLater);
+        _dataChanged.insert(ereply, qMakePair(TotalCountUpdate, QJsonObject()));
+    }
+
+    int totalCount() const Q_REQUIRED_RESULT
+    {
+        return _totalCount;
+    }
+
+    void setTotalCount(int totalCount)
+    {
+        if (_totalCount == totalCount)
+            return;
+        _totalCount = totalCount;
+        emit q->totalCountChanged(totalCount);
+    }
+
+    void adjustTotalCount(int delta)
+    {
+        // only paginated models count objects which are not in the model
+        if (isPaginated() && _totalCount != -1)
+            setTotalCount(qMax(0, _totalCount + delta));
+    }
+
+    void refresh()
+    {
+        // without delta sync, a refresh resets the model like a new query
+        _keepRows = _deltaSync && !_data.isEmpty();
+        execute();
+    }
+
+    bool deltaSync() const Q_REQUIRED_RESULT
+    {
+        return _deltaSync;
+    }
+
+    void setDeltaSync(bool deltaSync)
+    {
+        _deltaSync = deltaSync;
+        emit q->deltaSyncChanged(deltaSync);
+    }
+
+    bool canMergeRows() const Q_REQUIRED_RESULT
+    {
+        // merged objects are appended, which would break the order and the size of a sorted,
+        // limited or paged result, those are reset instead
+        return !isPaginated()
+                && !_query.contains(EnginioString::pageSize)
+                && !_query.contains(EnginioString::sort);
+    }
+
+    bool canFetchDelta() const Q_REQUIRED_RESULT
+    {
+        // queries filtering by updatedAt need a full fetch
+        return _deltaSync
+                && _watermark != EnginioTimestamp::Invalid
+                && canMergeRows()
+                && !_query[EnginioString::query].toObject().contains(EnginioString::updatedAt);
+    }
+
+    void fetchDelta(int offset = 0)
+    {
+        // {"query": {"updatedAt": {"$gte": {"$type": "time", "$value": watermark}}}, "offset": offset,
+        //  "sort": [{"sortBy": "updatedAt", "direction": "asc"}, {"sortBy": "id", "direction": "asc"}]}
+        // Objects updated at the watermark are fetched again, because the watermark has only
+        // millisecond precision and a page may end in the middle of objects with the same
+        // updatedAt. The offset skips the ones fetched by the previous pages.
+        QJsonObject time;
+        time[EnginioString::queryType] = EnginioString::time;
+        time[EnginioString::queryValue] = EnginioTimestamp::toString(_watermark);
+        QJsonObject newer;
+        newer[EnginioString::queryGte] = time;
+        QJsonObject filter = _query[EnginioString::query].toObject();
+        filter[EnginioString::updatedAt] = newer;
+        QJsonObject sortByTime;
+        sortByTime[EnginioString::sortBy] = EnginioString::updatedAt;
+        sortByTime[EnginioString::direction] = EnginioString::asc;
+        QJsonObject sortById;
+        sortById[EnginioString::sortBy] = EnginioString::id;
+        sortById[EnginioString::direction] = EnginioString::asc;
+
+        QJsonObject query(_query);
+        query[EnginioString::query] = filter;
+        query[EnginioString::sort] = QJsonArray() << sortByTime << sortById;
+        query[EnginioString::limit] = DeltaSyncLimit;
+        if (offset)
+            query[EnginioString::offset] = offset;
+        else
+            query.remove(EnginioString::offset);
+
+        EnginioReply *ereply = _enginio->query(query, _operation);
+        QObject::connect(ereply, &EnginioReply::finished, ereply, &EnginioReply::deleteLater);
+        _dataChanged.insert(ereply, qMakePair(DeltaModelUpdate, query));
+    }
+
+    void fetchObject(const QString &id)
+    {
+        // {"query": {..., "id": id}}, the result is merged into the rows like a delta
+        if (!canMergeRows()) {
+            refresh();
+            return;
+        }
+        QJsonObject filter = _query[EnginioString::query].toObject();
+        filter[EnginioString::id] = id;
+        QJsonObject query(_query);
+        query[EnginioString::query] = filter;
+        query.remove(EnginioString::offset);
+
+        EnginioReply *ereply = _enginio->query(query, _operation);
+        QObject::connect(ereply, &EnginioReply::finished, ereply, &EnginioReply::deleteLater);
+        _dataChanged.insert(ereply, qMakePair(DeltaModelUpdate, query));
+    }
+
+    void updateWatermark(const QJsonArray &data)
+    {
+        for (int i = 0; i < data.count(); ++i) {
+            const qint64 updatedAt = EnginioTimestamp::fromJson(data.at(i).toObject()[EnginioString::updatedAt]);
+            if (updatedAt > _watermark)
+                _watermark = updatedAt;
+        }
+    }
+
+    void merge(const QJsonArray &data)
+    {
+        // Changed objects replace the rows with the same id, new objects are appended
+        QHash<QString, int> rows;
+        rows.reserve(_data.count());
+        for (int row = 0; row < _data.count(); ++row)
+            rows.insert(_data.at(row).toObject()[EnginioString::id].toString(), row);
+
+        QJsonArray added;
+        for (int i = 0; i < data.count(); ++i) {
+            const QJsonObject object = data.at(i).toObject();
+            const QString id = object[EnginioString::id].toString();
+            QHash<QString, int>::const_iterator row = rows.constFind(id);
+            if (row == rows.constEnd()) {
+                added.append(object);
+            } else if (_attachedData.contains(id)) {
+                continue; // the response of the local change resolves conflicts
+            } else if (_data.at(row.value()).toObject() != object) {
+                _data.replace(row.value(), object);
+                emit q->dataChanged(q->index(row.value()), q->index(row.value()));
+            }
+        }
+        if (!added.isEmpty()) {
+            q->beginInsertRows(QModelIndex(), _data.count(), _data.count() + added.count() - 1);
+            for (int i = 0; i < added.count(); ++i)
+                _data.append(added.at(i));
+            q->endInsertRows();
         }
     }
 
     void finishedRequest(const EnginioReply *response)
     {
+        if (response == _journalReply) {
+            finishedJournalRequest(response);
+            return;
+        }
+
         // We get all finished requests, check if we started this one
         if (!_dataChanged.contains(response))
             return;
 
+        if (_offline && !isOfflineError(response)) {
+            // the backend is reachable again
+            setOffline(false);
+            replayJournal();
+        }
+
         // ### TODO proper error handling
         // this kind of response happens when the backend id/secret is missing
         if (!response->data()[EnginioString::message].isNull())
@@ -438,18 +755,47 @@ public:
         QPair<int, QJsonObject> requestInfo = _dataChanged.take(response);
         int row = requestInfo.first;
         if (row == FullModelReset) {
-            q->beginResetModel();
-            _attachedData.clear();
-            _data = response->data()[EnginioString::results].toArray();
-            syncRoles();
-            _canFetchMore = _canFetchMore && _data.count() && (_query[EnginioString::limit].toDouble() <= _data.count());
-            q->endResetModel();
+            if (_journal.isOpen() && isOfflineError(response)) {
+                // keep the cached data, it is all we have without connectivity
+                setOffline(true);
+                return;
+            }
+            if (_keepRows && response->isError()) {
+                // the shown rows are kept, but they may be outdated
+                qWarning() << "EnginioModel: Fetching the query failed, the rows are not updated:" << response->errorString();
+                _keepRows = false;
+                return;
+            }
+            QJsonArray data = response->data()[EnginioString::results].toArray();
+            project(data);
+            _watermark = EnginioTimestamp::Invalid;
+            updateWatermark(data);
+            overlayJournal(data, true);
+            if (_keepRows && _data.count() && canMergeRows()) {
+                // the rows are already shown, only apply the differences
+                reconcile(data);
+            } else {
+                q->beginResetModel();
+                _attachedData.clear();
+                pruneEditTimes();
+                _data = data;
+                syncRoles();
+                _canFetchMore = _canFetchMore && _data.count() && (_query[EnginioString::limit].toDouble() <= _data.count());
+                q->endResetModel();
+            }
+            _keepRows = false;
+            _snapshotDirty = true;
+            saveSnapshot();
         } else if (row == IncrementalModelUpdate) {
             Q_ASSERT(_canFetchMore);
             QJsonArray data(response->data()[EnginioString::results].toArray());
+            project(data);
             QJsonObject query(requestInfo.second);
             int offset = query[EnginioString::offset].toDouble();
             int limit = query[EnginioString::limit].toDouble();
+            const bool canFetchMore = limit <= data.count();
+            updateWatermark(data);
+            overlayJournal(data, false);
             int dataCount = data.count();
 
             int startingOffset = qMax(offset, _data.count());
@@ -459,64 +805,240 @@ public:
                 _data.append(data[i]);
             }
 
-            _canFetchMore = limit <= dataCount;
+            _canFetchMore = canFetchMore;
             q->endInsertRows();
+            _snapshotDirty = true;
+            saveSnapshot();
+        } else if (row == TotalCountUpdate) {
+            if (response->isError())
+                return;
+            setTotalCount(response->data()[EnginioString::count].toDouble());
+        } else if (row == DeltaModelUpdate) {
+            if (response->isError()) {
+                if (_journal.isOpen() && isOfflineError(response))
+                    setOffline(true);
+                else
+                    qWarning() << "EnginioModel: Fetching the changes failed, the rows are not updated:" << response->errorString();
+                return;
+            }
+            QJsonArray data = response->data()[EnginioString::results].toArray();
+            const bool incomplete = data.count() >= DeltaSyncLimit;
+            project(data);
+            const QJsonObject query = requestInfo.second;
+            const QJsonObject time = query[EnginioString::query].toObject()[EnginioString::updatedAt].toObject()[EnginioString::queryGte].toObject();
+            int offset = 0;
+            if (!time.isEmpty()) {
+                // a single fetched object does not move the watermark, other objects may be older
+                updateWatermark(data);
+                // the objects at the watermark are the last ones of the page, the next page skips them
+                if (EnginioTimestamp::fromJson(time[EnginioString::queryValue]) == _watermark)
+                    offset = query[EnginioString::offset].toDouble();
+                for (int i = data.count() - 1; i >= 0 && EnginioTimestamp::fromJson(data.at(i).toObject()[EnginioString::updatedAt]) == _watermark; --i)
+                    ++offset;
+            }
+            overlayJournal(data, false);
+            merge(data);
+            _snapshotDirty = true;
+            saveSnapshot();
+            if (incomplete && !time.isEmpty())
+                fetchDelta(offset); // there are more changes than fit into one response
         } else {
-            QJsonObject newValue(response->data());
-            QJsonObject oldValue = requestInfo.second;
-            QString oldId = oldValue[EnginioString::id].toString();
-
-            AttachedData attachedData = _attachedData.deref(oldId);
-
-            bool removeOperation = newValue.isEmpty();
-            // update the row number
-            row = attachedData.row;
-            if (row == -1 || response->backendStatus() == 404) {
-                // The object was not found on the server, which means that it was deleted already
-                if (removeOperation || row == -1) {
-                    // Nothing to do, updating a removed object, that is not in the cache
-                    // or removing a removed object
-                    return;
-                }
-                // Updating a removed row. Change operation type to remove, so the cache can
-                // be in sync with the server again.
-                // TODO add a signal here so a developer can ask an user for a conflict
-                // resolution.
-                removeOperation = true;
+            const QString id = requestInfo.second[EnginioString::id].toString();
+            finishedUpdateRequest(response, requestInfo.second);
+            dropEditTime(id);
+        }
+    }
+
+    void finishedUpdateRequest(const EnginioReply *response, const QJsonObject &oldValue)
+    {
+        QJsonObject newValue(project(response->data()));
+        QString oldId = oldValue[EnginioString::id].toString();
+        _snapshotDirty = true;
+
+        AttachedData attachedData = _attachedData.deref(oldId);
+
+        bool removeOperation = newValue.isEmpty();
+        // update the row number
+        int row = attachedData.row;
+        if (row == -1 || response->backendStatus() == 404) {
+            // The object was not found on the server, which means that it was deleted already
+            if (removeOperation || row == -1) {
+                // Nothing to do, updating a removed object, that is not in the cache
+                // or removing a removed object
+                return;
             }
-            Q_ASSERT(row >= 0 && row < _data.count());
+            // Updating a removed row, the local changes conflict with the removal
+            resolveConflict(row, QJsonObject(), EnginioTimestamp::Invalid, changedProperties(row, oldValue, QJsonObject()));
+            return;
+        }
+        Q_ASSERT(row >= 0 && row < _data.count());
 
-            if (response->networkError() != QNetworkReply::NoError && response->backendStatus() != 404) {
-                _data.replace(row, oldValue);
-                emit q->dataChanged(q->index(row), q->index(row));
+        if (response->networkError() != QNetworkReply::NoError) {
+            _data.replace(row, oldValue);
+            emit q->dataChanged(q->index(row), q->index(row));
+            return;
+        }
+
+        if (removeOperation) {
+            removeRow(row);
+            adjustTotalCount(-1);
+        } else {
+            const qint64 newUpdatedAt = EnginioTimestamp::fromJson(newValue[EnginioString::updatedAt]);
+            updateClockOffset(newUpdatedAt);
+            if (newUpdatedAt < _data.updatedAt(row)) {
+                // we already have a newer version
                 return;
             }
+            resolveConflict(row, newValue, newUpdatedAt, changedProperties(row, oldValue, newValue));
+        }
+    }
 
-            if (removeOperation) {
-                q->beginRemoveRows(QModelIndex(), row, row);
-                _data.removeAt(row);
-                // we need to updates rows in _attachedData
-                _attachedData.updateAllDataAfterRow(row);
-                q->endRemoveRows();
-            } else {
-                QJsonObject current = _data[row].toObject();
-                QDateTime currentUpdateAt = QDateTime::fromString(current[EnginioString::updatedAt].toString(), Qt::ISODate);
-                QDateTime newUpdateAt = QDateTime::fromString(newValue[EnginioString::updatedAt].toString(), Qt::ISODate);
-                if (newUpdateAt < currentUpdateAt) {
-                    // we already have a newer version
-                    return;
+    QJsonObject project(const QJsonObject &object) const Q_REQUIRED_RESULT
+    {
+        const QJsonArray fields = _query[EnginioString::fields].toArray();
+        if (fields.isEmpty() || object.isEmpty())
+            return object;
+
+        // the properties identifying an object are always kept, the model depends on them
+        QJsonObject result;
+        const QString *const keys[] = {&EnginioString::id, &EnginioString::objectType, &EnginioString::createdAt, &EnginioString::updatedAt};
+        for (unsigned i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+            QJsonObject::const_iterator value = object.constFind(*keys[i]);
+            if (value != object.constEnd())
+                result.insert(*keys[i], value.value());
+        }
+        for (QJsonArray::const_iterator i = fields.constBegin(); i != fields.constEnd(); ++i) {
+            const QString field = (*i).toString();
+            QJsonObject::const_iterator value = object.constFind(field);
+            if (value != object.constEnd())
+                result.insert(field, value.value());
+        }
+        return result;
+    }
+
+    void project(QJsonArray &data) const
+    {
+        // The backend may not support projections, then it sends whole objects
+        // and the rows are trimmed here, so that only the requested properties are kept.
+        if (!_query[EnginioString::fields].isArray())
+            return;
+        for (int i = 0; i < data.count(); ++i)
+            data.replace(i, project(data.at(i).toObject()));
+    }
+
+    QStringList changedProperties(int row, const QJsonObject &base, const QJsonObject &server) const Q_REQUIRED_RESULT
+    {
+        // Properties changed locally, after the request was made, which the server
+        // does not know about; other edits of the object are still in flight.
+        QStringList properties;
+        const QJsonObject local = _data.at(row).toObject();
+        for (QJsonObject::const_iterator i = local.constBegin(); i != local.constEnd(); ++i) {
+            const QString key = i.key();
+            if (key == EnginioString::updatedAt || key == EnginioString::createdAt || key == EnginioString::id)
+                continue;
+            if (i.value() != base[key] && i.value() != server[key])
+                properties.append(key);
+        }
+        return properties;
+    }
+
+    void updateClockOffset(qint64 updatedAt)
+    {
+        // The object was just written by this model, so its updatedAt is the current
+        // backend time, late by the time the response took to arrive.
+        if (updatedAt != EnginioTimestamp::Invalid)
+            _clockOffset = updatedAt - QDateTime::currentMSecsSinceEpoch();
+    }
+
+    qint64 backendTime() const Q_REQUIRED_RESULT
+    {
+        return QDateTime::currentMSecsSinceEpoch() + _clockOffset;
+    }
+
+    void dropEditTime(const QString &id)
+    {
+        // the edit time is needed only until the last change of the object is answered
+        if (!_attachedData.contains(id) && !_journal.isPending(id))
+            _editTimes.remove(id);
+    }
+
+    void pruneEditTimes()
+    {
+        QHash<QString, qint64>::iterator i = _editTimes.begin();
+        while (i != _editTimes.end()) {
+            if (!_attachedData.contains(i.key()) && !_journal.isPending(i.key()))
+                i = _editTimes.erase(i);
+            else
+                ++i;
+        }
+    }
+
+    void resolveConflict(int row, const QJsonObject &server, qint64 serverUpdatedAt, const QStringList &properties)
+    {
+        // All conflicts between the cache and the backend are resolved here. An empty server
+        // object means that the object was removed from the backend.
+        QJsonObject result;
+        if (properties.isEmpty()) {
+            result = server;
+        } else {
+            const QJsonObject local = _data.at(row).toObject();
+            switch (_conflictPolicy) {
+            case EnginioModel::ServerWins:
+                result = server;
+                break;
+            case EnginioModel::LastWriterWins:
+                const QHash<QString, qint64>::const_iterator editTime = _editTimes.constFind(local[EnginioString::id].toString());
+                if (server.isEmpty() || editTime == _editTimes.constEnd() || editTime.value() < serverUpdatedAt) {
+                    result = server;
+                    break;
                 }
-                if (_data.count() == 1) {
-                    q->beginResetModel();
-                    _data.replace(row, newValue);
-                    syncRoles();
-                    q->endResetModel();
+                // fall through, the local edit is newer
+            case EnginioModel::MergeProperties:
+                if (server.isEmpty())
+                    break;
+                result = server;
+                foreach (const QString &property, properties)
+                    result[property] = local[property];
+                break;
+            case EnginioModel::CustomPolicy:
+                result = q->resolveConflict(local, server, properties);
+                if (result.isEmpty())
+                    break;
+                if (server.isEmpty()) {
+                    // the object is kept locally, it stays as old as the local row
+                    result[EnginioString::updatedAt] = local[EnginioString::updatedAt];
+                    serverUpdatedAt = _data.updatedAt(row);
                 } else {
-                    _data.replace(row, newValue);
-                    emit q->dataChanged(q->index(row), q->index(row));
+                    result[EnginioString::updatedAt] = server[EnginioString::updatedAt];
                 }
+                break;
             }
         }
+
+        if (result.isEmpty()) {
+            removeRow(row);
+            if (server.isEmpty())
+                adjustTotalCount(-1);
+        } else if (_data.count() == 1) {
+            q->beginResetModel();
+            _data.replace(row, result, serverUpdatedAt);
+            syncRoles();
+            q->endResetModel();
+        } else {
+            _data.replace(row, result, serverUpdatedAt);
+            emit q->dataChanged(q->index(row), q->index(row));
+        }
+    }
+
+    EnginioModel::ConflictPolicy conflictPolicy() const Q_REQUIRED_RESULT
+    {
+        return _conflictPolicy;
+    }
+
+    void setConflictPolicy(EnginioModel::ConflictPolicy policy)
+    {
+        _conflictPolicy = policy;
+        emit q->conflictPolicyChanged(policy);
     }
 
     struct SwapNetworkReplyForSetData
@@ -527,6 +1049,8 @@ public:
 
         void operator ()(EnginioReply *finishedCreateReply)
         {
+            if (d.isAborted())
+                return;
             if (finishedCreateReply->isError()) {
                 d.markAsError(QByteArrayLiteral("Dependent create query failed, so object coudl not be updated"));
             } else {
@@ -541,8 +1065,11 @@ public:
     EnginioReply *setData(const int row, const QVariant &value, int role)
     {
         if (role > EnginioModel::SyncedRole) {
+            _snapshotDirty = true;
             QJsonObject oldObject = _data.at(row).toObject();
             QString id = oldObject[EnginioString::id].toString();
+            if (_journal.isOpen() && !id.isEmpty())
+                return setDataJournaled(row, value, role, oldObject, id);
             if (id.isEmpty())
                 return setDataDelyed(row, value, role, oldObject);
             return setDataNow(row, value, role, oldObject, id);
@@ -563,7 +1090,7 @@ public:
         *tmpId = _dataChanged.value(*createReply).second[EnginioString::id].toString();
         Q_ASSERT(tmpId->startsWith(QString::fromLatin1("tmp")));
         EnginioClientPrivate *client = EnginioClientPrivate::get(_enginio);
-        EnginioDummyReply *nreply = new EnginioDummyReply(*createReply);
+        EnginioDummyReply *nreply = new EnginioDummyReply(client, *createReply);
         *newReply = new EnginioReply(client, nreply);
     }
 
@@ -593,6 +1120,7 @@ public:
         deltaObject[EnginioString::objectType] = newObject[EnginioString::objectType];
         EnginioReply *ereply = _enginio->update(deltaObject, _operation);
         _dataChanged.insert(ereply, qMakePair(row, oldObject));
+        _editTimes.insert(id, backendTime());
         _attachedData.ref(id, row);
         Q_ASSERT(_attachedData.contains(id) && _attachedData[id].ref > 0);
         _data.replace(row, newObject);
@@ -600,6 +1128,414 @@ public:
         return ereply;
     }
 
+    QString journalFile() const Q_REQUIRED_RESULT
+    {
+        return _journal.fileName();
+    }
+
+    void setJournalFile(const QString &fileName)
+    {
+        abandonJournalReply();
+        _journal.close();
+        if (!fileName.isEmpty())
+            _journal.open(fileName);
+        setOffline(false);
+        emit q->journalFileChanged(fileName);
+    }
+
+    bool isOffline() const Q_REQUIRED_RESULT
+    {
+        return _offline;
+    }
+
+    void setOffline(bool offline)
+    {
+        if (offline)
+            _journalTimer->start();
+        else
+            _journalTimer->stop();
+        if (_offline == offline)
+            return;
+        _offline = offline;
+        emit q->offlineChanged(offline);
+    }
+
+    static bool isOfflineError(const EnginioReply *response)
+    {
+        if (response->errorType() == EnginioReply::TimeoutError)
+            return true;
+        switch (response->networkError()) {
+        case QNetworkReply::ConnectionRefusedError:
+        case QNetworkReply::RemoteHostClosedError:
+        case QNetworkReply::HostNotFoundError:
+        case QNetworkReply::TimeoutError:
+        case QNetworkReply::TemporaryNetworkFailureError:
+        case QNetworkReply::NetworkSessionFailedError:
+        case QNetworkReply::ProxyConnectionRefusedError:
+        case QNetworkReply::ProxyNotFoundError:
+        case QNetworkReply::ProxyTimeoutError:
+        case QNetworkReply::UnknownNetworkError:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    int rowOf(const QString &id) const Q_REQUIRED_RESULT
+    {
+        // TODO optimize it, together with AttachedDataContainer
+        for (int row = 0; row < _data.count(); ++row) {
+            if (_data.at(row).toObject()[EnginioString::id].toString() == id)
+                return row;
+        }
+        return -1;
+    }
+
+    EnginioReply *acceptedReply(const QJsonObject &object)
+    {
+        // The change is in the journal, the reply only confirms that it was accepted locally
+        EnginioClientPrivate *client = EnginioClientPrivate::get(_enginio);
+        QNetworkReply *nreply = new EnginioFakeReply(client, QJsonDocument(object).toJson(QJsonDocument::Compact), 202);
+        return new EnginioReply(client, nreply);
+    }
+
+    EnginioReply *appendJournaled(const QJsonObject &value)
+    {
+        QJsonObject object(value);
+        object[EnginioString::objectType] = _query[EnginioString::objectType];
+        _journal.append(EnginioModelJournal::CreateOperation, QString::fromLatin1("tmp") + QUuid::createUuid().toString(), object);
+        // the temporary id stays in the cache, so later changes can be journaled against it
+        object[EnginioString::id] = _journal.entries().last().id;
+        insertRow(object);
+        adjustTotalCount(1);
+        replayJournal();
+        return acceptedReply(object);
+    }
+
+    EnginioReply *removeJournaled(int row, const QJsonObject &oldObject, const QString &id)
+    {
+        QJsonObject object;
+        object[EnginioString::objectType] = oldObject[EnginioString::objectType];
+        _journal.append(EnginioModelJournal::RemoveOperation, id, object);
+        removeRow(row);
+        adjustTotalCount(-1);
+        replayJournal();
+        return acceptedReply(oldObject);
+    }
+
+    EnginioReply *setDataJournaled(const int row, const QVariant &value, int role, const QJsonObject &oldObject, const QString &id)
+    {
+        Q_ASSERT(role > EnginioModel::SyncedRole);
+        const QString roleName(_roles.value(role));
+        QJsonObject deltaObject;
+        QJsonObject newObject = oldObject;
+        deltaObject[roleName] = newObject[roleName] = QJsonValue::fromVariant(value);
+        deltaObject[EnginioString::objectType] = newObject[EnginioString::objectType];
+        _journal.append(EnginioModelJournal::UpdateOperation, id, deltaObject);
+        _editTimes.insert(id, backendTime());
+        _data.replace(row, newObject);
+        emit q->dataChanged(q->index(row), q->index(row));
+        replayJournal();
+        return acceptedReply(newObject);
+    }
+
+    void insertRow(const QJsonObject &object)
+    {
+        const int row = _data.count();
+        if (!row) { // the first item need to update roles
+            q->beginResetModel();
+            _data.append(object);
+            syncRoles();
+            q->endResetModel();
+        } else {
+            q->beginInsertRows(QModelIndex(), row, row);
+            _data.append(object);
+            q->endInsertRows();
+        }
+    }
+
+    void removeRow(int row)
+    {
+        q->beginRemoveRows(QModelIndex(), row, row);
+        _data.removeAt(row);
+        _attachedData.updateAllDataAfterRow(row);
+        q->endRemoveRows();
+    }
+
+    void replaceRow(int row, const QJsonObject &object)
+    {
+        if (_data.count() == 1) {
+            q->beginResetModel();
+            _data.replace(row, object);
+            syncRoles();
+            q->endResetModel();
+        } else {
+            _data.replace(row, object);
+            emit q->dataChanged(q->index(row), q->index(row));
+        }
+    }
+
+    void overlayJournal(QJsonArray &data, bool appendCreated) const
+    {
+        // Changes which were not acknowledged by the server yet are applied on top of
+        // fetched data, so they do not disappear when the model is reloaded.
+        foreach (const EnginioModelJournal::Entry &entry, _journal.entries()) {
+            if (entry.operation == EnginioModelJournal::CreateOperation) {
+                if (appendCreated) {
+                    QJsonObject object(entry.object);
+                    object[EnginioString::id] = entry.id;
+                    data.append(object);
+                }
+                continue;
+            }
+            for (int i = 0; i < data.count(); ++i) {
+                QJsonObject object = data.at(i).toObject();
+                if (object[EnginioString::id].toString() != entry.id)
+                    continue;
+                if (entry.operation == EnginioModelJournal::RemoveOperation) {
+                    data.removeAt(i);
+                } else {
+                    for (QJsonObject::const_iterator property = entry.object.constBegin(); property != entry.object.constEnd(); ++property)
+                        object[property.key()] = property.value();
+                    data.replace(i, object);
+                }
+                break;
+            }
+        }
+    }
+
+    void abandonJournalReply()
+    {
+        // The response will not be processed, the entry is sent again later
+        if (!_journalReply)
+            return;
+        _journalReply = 0;
+        _journal.headFailed();
+    }
+
+    void replayJournal()
+    {
+        if (_journalReply || _journal.isEmpty())
+            return;
+        if (!_enginio || _enginio->backendId().isEmpty() || _enginio->backendSecret().isEmpty())
+            return;
+
+        const EnginioModelJournal::Entry &entry = _journal.head();
+        QJsonObject object(entry.object);
+        EnginioReply *ereply;
+        switch (entry.operation) {
+        case EnginioModelJournal::CreateOperation:
+            ereply = _enginio->create(object, _operation);
+            break;
+        case EnginioModelJournal::UpdateOperation:
+            object[EnginioString::id] = entry.id;
+            ereply = _enginio->update(object, _operation);
+            break;
+        case EnginioModelJournal::RemoveOperation:
+            object[EnginioString::id] = entry.id;
+            ereply = _enginio->remove(object, _operation);
+            break;
+        default:
+            Q_UNREACHABLE();
+            return;
+        }
+        _journal.headSent();
+        _journalReply = ereply;
+        QObject::connect(ereply, &EnginioReply::finished, ereply, &EnginioReply::deleteLater);
+    }
+
+    void finishedJournalRequest(const EnginioReply *response)
+    {
+        _journalReply = 0;
+        _snapshotDirty = true;
+        if (isOfflineError(response)) {
+            // keep the entry and wait for the connectivity
+            _journal.headFailed();
+            setOffline(true);
+            return;
+        }
+        setOffline(false);
+
+        const EnginioModelJournal::Entry head = _journal.head();
+        const QJsonObject newValue(response->data());
+        const QString newId = newValue[EnginioString::id].toString();
+        const bool created = head.operation == EnginioModelJournal::CreateOperation && !response->isError();
+        _journal.headAcknowledged(created ? newId : QString());
+
+        const int row = rowOf(head.id);
+        if (response->isError()) {
+            if (head.operation == EnginioModelJournal::RemoveOperation) {
+                if (response->backendStatus() != 404)
+                    fetchObject(head.id); // the object is still on the server
+            } else if (head.operation == EnginioModelJournal::CreateOperation) {
+                // not created on the server
+                if (row != -1)
+                    removeRow(row);
+            } else if (response->backendStatus() == 404) {
+                // updating an object removed from the server
+                if (row != -1)
+                    resolveConflict(row, QJsonObject(), EnginioTimestamp::Invalid, head.object.keys());
+            } else {
+                // the change was rejected, fetch the server state
+                fetchObject(head.id);
+            }
+        } else if (row != -1 && head.operation != EnginioModelJournal::RemoveOperation) {
+            updateClockOffset(EnginioTimestamp::fromJson(newValue[EnginioString::updatedAt]));
+            // changes which were not sent yet are applied on top of the server version
+            QJsonArray object;
+            object.append(newValue);
+            overlayJournal(object, false);
+            replaceRow(row, object.first().toObject());
+        }
+        if (created && _editTimes.contains(head.id))
+            _editTimes.insert(newId, _editTimes.take(head.id));
+        dropEditTime(created ? newId : head.id);
+        replayJournal();
+    }
+
+    QString snapshotDirectory() const Q_REQUIRED_RESULT
+    {
+        return _snapshotDirectory;
+    }
+
+    void setSnapshotDirectory(const QString &directory)
+    {
+        saveSnapshot();
+        _snapshotDirectory = directory;
+        _snapshotFile.clear();
+        _keepRows = false;
+        emit q->snapshotDirectoryChanged(directory);
+    }
+
+    QString snapshotFileName() const Q_REQUIRED_RESULT
+    {
+        // a snapshot is specific to a backend, a user and a query
+        const QJsonObject user = EnginioClientPrivate::get(_enginio)->identityToken()[EnginioString::user].toObject();
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(_enginio->serviceUrl().toEncoded());
+        hash.addData(_enginio->backendId());
+        hash.addData(user[EnginioString::id].toString().toUtf8());
+        hash.addData(QByteArray::number(_operation));
+        hash.addData(QJsonDocument(_query).toJson(QJsonDocument::Compact));
+        return _snapshotDirectory + QLatin1Char('/') + QString::fromLatin1(hash.result().toHex()) + QStringLiteral(".snapshot");
+    }
+
+    void identityChanged()
+    {
+        // the snapshot of the previous user is removed, another user must not see its rows
+        if (_snapshotFile.isEmpty() || snapshotFileName() == _snapshotFile)
+            return;
+        QFile::remove(_snapshotFile);
+        _snapshotFile.clear();
+        _snapshotDirty = false;
+        _keepRows = false;
+    }
+
+    bool loadSnapshot()
+    {
+        QFile file(_snapshotFile);
+        if (!file.open(QIODevice::ReadOnly) || file.size() <= SnapshotHeaderSize)
+            return false;
+
+        // The binary JSON format is the same as the in memory representation, so the
+        // snapshot is copied out of the mapped file and validated, but not parsed.
+        const char *mapped = reinterpret_cast<const char*>(file.map(0, file.size()));
+        if (!mapped)
+            return false;
+        QDataStream header(QByteArray::fromRawData(mapped, SnapshotHeaderSize));
+        quint32 magic, version;
+        header >> magic >> version;
+        QJsonDocument document;
+        if (magic == SnapshotMagic && version == SnapshotVersion)
+            document = QJsonDocument::fromBinaryData(QByteArray::fromRawData(mapped + SnapshotHeaderSize, file.size() - SnapshotHeaderSize));
+        file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(mapped)));
+        if (!document.isArray())
+            return false;
+
+        QJsonArray data = document.array();
+        _watermark = EnginioTimestamp::Invalid;
+        updateWatermark(data);
+        overlayJournal(data, true);
+        q->beginResetModel();
+        _attachedData.clear();
+        pruneEditTimes();
+        _data = data;
+        syncRoles();
+        q->endResetModel();
+        return true;
+    }
+
+    void saveSnapshot()
+    {
+        if (_snapshotFile.isEmpty() || !_snapshotDirty)
+            return;
+        _snapshotDirty = false;
+
+        // objects which are not created yet are skipped, the journal keeps them
+        QJsonArray data;
+        for (int row = 0; row < _data.count(); ++row) {
+            const QString id = _data.at(row).toObject()[EnginioString::id].toString();
+            if (!id.isEmpty() && !id.startsWith(QStringLiteral("tmp")))
+                data.append(_data.at(row));
+        }
+
+        QDir().mkpath(_snapshotDirectory);
+        QSaveFile file(_snapshotFile);
+        if (file.open(QIODevice::WriteOnly)) {
+            QDataStream stream(&file);
+            stream << quint32(SnapshotMagic) << quint32(SnapshotVersion);
+            file.write(QJsonDocument(data).toBinaryData());
+            file.commit();
+        }
+        if (file.error() != QFileDevice::NoError)
+            qWarning() << "EnginioModel: can not write snapshot" << _snapshotFile << file.errorString();
+    }
+
+    void reconcile(const QJsonArray &data)
+    {
+        // Fetched objects are merged into the existing rows by id, without a model reset
+        QHash<QString, int> index;
+        index.reserve(data.count());
+        for (int i = 0; i < data.count(); ++i)
+            index.insert(data.at(i).toObject()[EnginioString::id].toString(), i);
+
+        for (int row = _data.count() - 1; row >= 0; --row) {
+            const QString id = _data.at(row).toObject()[EnginioString::id].toString();
+            if (!id.isEmpty() && !index.contains(id))
+                removeRow(row);
+        }
+
+        QSet<QString> present;
+        for (int row = 0; row < _data.count(); ++row) {
+            const QJsonObject current = _data.at(row).toObject();
+            const QString id = current[EnginioString::id].toString();
+            present.insert(id);
+            QHash<QString, int>::const_iterator i = index.constFind(id);
+            if (i == index.constEnd() || _attachedData.contains(id))
+                continue; // the response of a local change resolves conflicts
+            // an object which was not modified has the same updatedAt
+            if (!_journal.isPending(id) && current[EnginioString::updatedAt] == data.at(i.value()).toObject()[EnginioString::updatedAt])
+                continue;
+            const QJsonObject object = data.at(i.value()).toObject();
+            if (object != current) {
+                _data.replace(row, object);
+                emit q->dataChanged(q->index(row), q->index(row));
+            }
+        }
+
+        QJsonArray added;
+        for (int i = 0; i < data.count(); ++i) {
+            if (!present.contains(data.at(i).toObject()[EnginioString::id].toString()))
+                added.append(data.at(i));
+        }
+        if (!added.isEmpty()) {
+            q->beginInsertRows(QModelIndex(), _data.count(), _data.count() + added.count() - 1);
+            for (int i = 0; i < added.count(); ++i)
+                _data.append(added.at(i));
+            q->endInsertRows();
+        }
+    }
+
     void syncRoles()
     {
         QJsonObject firstObject(_data.first().toObject()); // TODO it expects certain data structure in all objects, add way to specify roles
@@ -648,7 +1584,9 @@ public:
     QVariant data(unsigned row, int role) Q_REQUIRED_RESULT
     {
         if (role == EnginioModel::SyncedRole) {
-            return !_attachedData.contains(row);
+            if (_attachedData.contains(row))
+                return false;
+            return !_journal.isPending(_data.at(row).toObject()[EnginioString::id].toString());
         }
 
         if (role == Qt::DisplayRole)
@@ -693,6 +1631,8 @@ public:
 
 const int EnginioModelPrivate::FullModelReset = -1;
 const int EnginioModelPrivate::IncrementalModelUpdate = -2;
+const int EnginioModelPrivate::DeltaModelUpdate = -3;
+const int EnginioModelPrivate::TotalCountUpdate = -4;
 
 
 /*!
@@ -779,6 +1719,10 @@ void EnginioModel::setEnginio(const EnginioClient *enginio)
 
   Sorting preserved until insertion/deletion
 
+  If the query contains a \c fields array, the rows keep only the listed properties
+  besides \c id, \c objectType, \c createdAt and \c updatedAt, also if the backend
+  returns whole objects.
+
   \sa EnginioClient::query()
 */
 QJsonObject EnginioModel::query()
@@ -811,6 +1755,217 @@ void EnginioModel::setOperation(EnginioClient::Operation operation)
     d->setOperation(operation);
 }
 
+/*!
+  \property EnginioModel::journalFile
+  \brief The file used to journal changes made through the model.
+
+  By default the property is empty and every change is sent immediately,
+  if a request fails because the backend can not be reached the change is reverted.
+
+  If the property is set, the model works in offline mode. append(), remove() and
+  setProperty() write the change to the journal before the local cache is updated,
+  and return a reply which is already finished with backend status 202. The journaled
+  changes are sent to the backend one by one in the order they were made. If the backend
+  can not be reached, the changes stay in the journal and in the local cache, and
+  they are sent again when connectivity returns, also after the application is restarted.
+  Multiple changes of the same object, which were not sent yet, are coalesced into one request.
+  A change rejected by the backend is reported by the EnginioClient::error() signal and the
+  affected data is fetched from the backend again.
+
+  Objects appended in offline mode have a temporary id until they are created on the backend.
+  Use the SyncedRole to check if a change of an object is still pending.
+
+  \note The journal belongs to a single model, it should not be shared between models
+  with a different query or operation.
+
+  \sa offline, synchronize()
+*/
+QString EnginioModel::journalFile() const
+{
+    return d->journalFile();
+}
+
+void EnginioModel::setJournalFile(const QString &fileName)
+{
+    if (fileName == d->journalFile())
+        return;
+    d->setJournalFile(fileName);
+}
+
+/*!
+  \property EnginioModel::offline
+  \brief Whether the last request of the model failed because the backend could not be reached.
+
+  While the model is offline, changes are kept in the \l journalFile and sending them is
+  retried periodically, as soon as the network is accessible or when another request
+  of the model succeeds.
+
+  \sa synchronize()
+*/
+bool EnginioModel::isOffline() const
+{
+    return d->isOffline();
+}
+
+/*!
+  \property EnginioModel::snapshotDirectory
+  \brief The directory in which snapshots of the model data are stored.
+
+  By default the property is empty and the model is empty until the \l query
+  is answered by the backend.
+
+  If the property is set, the model stores the fetched objects in a binary snapshot
+  file, one per backend, user and query. When the model is used again with the same backend,
+  user and query, for example after the application is restarted, it is populated from the snapshot
+  immediately. The objects returned by the backend are then merged into the existing rows,
+  only rows of objects which were modified, created or removed in the meantime are changed.
+
+  The snapshot of a user is removed when another user is authenticated or the session is
+  terminated.
+
+  \note Models using pagination are reset when the first page is fetched.
+*/
+QString EnginioModel::snapshotDirectory() const
+{
+    return d->snapshotDirectory();
+}
+
+void EnginioModel::setSnapshotDirectory(const QString &directory)
+{
+    if (directory == d->snapshotDirectory())
+        return;
+    d->setSnapshotDirectory(directory);
+}
+
+/*!
+  \property EnginioModel::deltaSync
+  \brief Whether the model fetches only objects changed since the last fetch.
+
+  By default the property is false and refresh() fetches all objects again
+  and resets the model.
+
+  If the property is true, the model remembers the newest \c updatedAt value
+  it has fetched. refresh() and a model populated from a snapshot then query only
+  the objects updated after that time, and merge them into the existing rows by id
+  without resetting the model.
+
+  \note Objects removed from the backend by another client are not detected by
+  a delta fetch; they stay in the model until a full refresh. Paginated queries
+  and queries filtering by \c updatedAt are always fetched fully.
+
+  \sa refresh(), snapshotDirectory
+*/
+bool EnginioModel::deltaSync() const
+{
+    return d->deltaSync();
+}
+
+void EnginioModel::setDeltaSync(bool deltaSync)
+{
+    if (deltaSync == d->deltaSync())
+        return;
+    d->setDeltaSync(deltaSync);
+}
+
+/*!
+  \enum EnginioModel::ConflictPolicy
+
+  The policy decides which data the model shows when the backend answers
+  a request for an object which was changed again locally in the meantime,
+  or which was removed from the backend while it was changed locally.
+
+  \value ServerWins \c The object from the backend replaces the local one
+  \value LastWriterWins \c The local changes are kept if they were made after
+  the object was updated on the backend. The time of a local change is taken in the
+  backend clock, which the model estimates from the updatedAt of the objects it
+  writes, so it is exact up to the latency of the backend responses
+  \value MergeProperties \c The object from the backend is taken, but the properties
+  changed locally keep their local values
+  \value CustomPolicy \c The conflict is resolved by resolveConflict()
+
+  An object removed from the backend is removed from the model, unless resolveConflict()
+  returns an object for it. Such an object keeps the updatedAt of the local row.
+*/
+
+/*!
+  \property EnginioModel::conflictPolicy
+  \brief The way conflicts between local changes and the backend are resolved.
+
+  The default is ServerWins.
+  \sa resolveConflict()
+*/
+EnginioModel::ConflictPolicy EnginioModel::conflictPolicy() const
+{
+    return d->conflictPolicy();
+}
+
+void EnginioModel::setConflictPolicy(ConflictPolicy policy)
+{
+    if (policy == d->conflictPolicy())
+        return;
+    d->setConflictPolicy(policy);
+}
+
+/*!
+  \property EnginioModel::totalCount
+  \brief The number of objects on the backend matching the \l query.
+
+  If the query uses \c pageSize or \c limit, the count is requested with
+  EnginioClient::count() together with the first page, so views can be sized
+  before all the objects are fetched. Otherwise it is the number of rows.
+  It is -1 until it is known.
+*/
+int EnginioModel::totalCount() const
+{
+    return d->totalCount();
+}
+
+/*!
+  Returns the object which the model shows after a conflict, if the \l conflictPolicy
+  is CustomPolicy. \a local is the object with local changes, \a server is the object
+  returned by the backend, or an empty object if it was removed from the backend, and
+  \a properties lists the locally changed properties which differ from the backend.
+
+  Returning an empty object removes the row. The default implementation returns \a server.
+  In QML, the function set as \c conflictResolver is called instead.
+*/
+QJsonObject EnginioModel::resolveConflict(const QJsonObject &local, const QJsonObject &server, const QStringList &properties)
+{
+    Q_UNUSED(local);
+    Q_UNUSED(properties);
+    return server;
+}
+
+/*!
+  Fetch the \l query again.
+
+  If \l deltaSync is true, only the objects changed since the last fetch are
+  requested and merged into the rows without a model reset. Otherwise the model
+  is reset with the new results, as after setting the \l query.
+
+  If the fetch of the changes fails, the rows are kept as they are and a warning
+  is printed; the failed reply is reported by EnginioClient::error().
+  \sa deltaSync
+*/
+void EnginioModel::refresh()
+{
+    if (Q_UNLIKELY(!d->enginio())) {
+        qWarning("EnginioModel::refresh(): Enginio client is not set");
+        return;
+    }
+    d->refresh();
+}
+
+/*!
+  Send the journaled changes now, for example when the application knows that the
+  connectivity returned. Changes are sent automatically, so usually there is no need to call it.
+  \sa journalFile
+*/
+void EnginioModel::synchronize()
+{
+    d->replayJournal();
+}
+
 /*!
   Append \a value to this model local cache and send a create request
   to enginio backend.
@@ -40,6 +40,7 @@
 
 #include <QAbstractListModel>
 #include <QtCore/qjsonobject.h>
+#include <QtCore/qstringlist.h>
 #include <QtCore/qscopedpointer.h>
 
 #include "enginioclient.h"
@@ -62,9 +63,23 @@ public:
         LastRole // the first fully dynamic role
     };
 
+    enum ConflictPolicy {
+        ServerWins,
+        LastWriterWins,
+        MergeProperties,
+        CustomPolicy
+    };
+    Q_ENUMS(ConflictPolicy)
+
     Q_PROPERTY(EnginioClient *enginio READ enginio WRITE setEnginio NOTIFY enginioChanged)
     Q_PROPERTY(QJsonObject query READ query WRITE setQuery NOTIFY queryChanged)
     Q_PROPERTY(EnginioClient::Operation operation READ operation WRITE setOperation NOTIFY operationChanged)
+    Q_PROPERTY(QString journalFile READ journalFile WRITE setJournalFile NOTIFY journalFileChanged)
+    Q_PROPERTY(bool offline READ isOffline NOTIFY offlineChanged)
+    Q_PROPERTY(QString snapshotDirectory READ snapshotDirectory WRITE setSnapshotDirectory NOTIFY snapshotDirectoryChanged)
+    Q_PROPERTY(bool deltaSync READ deltaSync WRITE setDeltaSync NOTIFY deltaSyncChanged)
+    Q_PROPERTY(ConflictPolicy conflictPolicy READ conflictPolicy WRITE setConflictPolicy NOTIFY conflictPolicyChanged)
+    Q_PROPERTY(int totalCount READ totalCount NOTIFY totalCountChanged)
 
     // TODO: that is a pretty silly name
     EnginioClient *enginio() const Q_REQUIRED_RESULT;
@@ -76,6 +91,18 @@ public:
     EnginioClient::Operation operation() const Q_REQUIRED_RESULT;
     void setOperation(EnginioClient::Operation opertaion);
 
+    QString journalFile() const Q_REQUIRED_RESULT;
+    void setJournalFile(const QString &fileName);
+    bool isOffline() const Q_REQUIRED_RESULT;
+
+    QString snapshotDirectory() const Q_REQUIRED_RESULT;
+    void setSnapshotDirectory(const QString &directory);
+    bool deltaSync() const Q_REQUIRED_RESULT;
+    void setDeltaSync(bool deltaSync);
+    ConflictPolicy conflictPolicy() const Q_REQUIRED_RESULT;
+    void setConflictPolicy(ConflictPolicy policy);
+    int totalCount() const Q_REQUIRED_RESULT;
+
     virtual Qt::ItemFlags flags(const QModelIndex &index) const Q_DECL_OVERRIDE;
     virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
     virtual int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
@@ -87,6 +114,8 @@ public:
     Q_INVOKABLE EnginioReply *append(const QJsonObject &value);
     Q_INVOKABLE EnginioReply *remove(int row);
     Q_INVOKABLE EnginioReply *setProperty(int row, const QString &role, const QVariant &value);
+    Q_INVOKABLE void synchronize();
+    Q_INVOKABLE void refresh();
 
     virtual QHash<int, QByteArray> roleNames() const Q_DECL_OVERRIDE;
 
@@ -94,6 +123,15 @@ Q_SIGNALS:
     void operationChanged(const EnginioClient::Operation operation);
     void queryChanged(const QJsonObject query);
     void enginioChanged(EnginioClient *enginio);
+    void journalFileChanged(const QString &fileName);
+    void offlineChanged(bool offline);
+    void snapshotDirectoryChanged(const QString &directory);
+    void deltaSyncChanged(bool deltaSync);
+    void conflictPolicyChanged(ConflictPolicy policy);
+    void totalCountChanged(int totalCount);
+
+protected:
+    virtual QJsonObject resolveConflict(const QJsonObject &local, const QJsonObject &server, const QStringList &properties);
 
 private:
     Q_DISABLE_COPY(EnginioModel)
@@ -0,0 +1,149 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#ifndef ENGINIOMODELATTACHEDDATA_P_H
+#define ENGINIOMODELATTACHEDDATA_P_H
+
+#include <QtCore/qdebug.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qstring.h>
+
+class EnginioReply;
+
+struct EnginioModelPrivateAttachedData
+{
+    uint ref;
+    int row;
+    EnginioReply *createReply;
+};
+Q_DECLARE_TYPEINFO(EnginioModelPrivateAttachedData, Q_PRIMITIVE_TYPE);
+
+#ifndef QT_NO_DEBUG_STREAM
+inline QDebug operator<<(QDebug dbg, const EnginioModelPrivateAttachedData &a)
+{
+    dbg.nospace() << "EnginioModelPrivateAttachedData(";
+    dbg.nospace() << a.ref << ", "<< a.row;
+    dbg.nospace() << ')';
+    return dbg.space();
+}
+#endif
+
+/*!
+  \brief Bookkeeping of EnginioModel rows, indexed by object id
+
+  \internal
+*/
+class AttachedDataContainer: public QHash<QString /* object id */, EnginioModelPrivateAttachedData>
+{
+    // TODO QHash is not the right structure, we need to index by id, row and we want to make
+    // bulk update of the data.
+    typedef EnginioModelPrivateAttachedData AttachedData;
+    typedef QHash<QString /* object id */, AttachedData> Base;
+public:
+    using Base::contains;
+    using Base::value;
+
+    bool contains(int row) const
+    {
+        // TODO optimize it
+        for (Base::const_iterator i = constBegin();
+             i != constEnd();
+             ++i) {
+            if (i.value().row == row)
+                return true;
+        }
+        return false;
+    }
+
+    AttachedData value(int row) const
+    {
+        // TODO optimize it
+        for (Base::const_iterator i = constBegin();
+             i != constEnd();
+             ++i) {
+            if (i.value().row == row)
+                return i.value();
+        }
+        Q_UNREACHABLE();
+    }
+
+    void updateAllDataAfterRow(const int row) {
+        // TODO optimize it is almost O(n log(n))
+        QList<QString> keys = this->keys();
+        foreach (const QString &key, keys) {
+            AttachedData &data = (*this)[key];
+            if (data.row > row)
+                --data.row;
+            else if (data.row == row)
+                data.row = -1;
+        }
+    }
+
+    AttachedData ref(const QString &id, int row)
+    {
+        AttachedData &data = (*this)[id];
+        ++data.ref;
+        Q_ASSERT(data.ref == 1 || data.row == row);
+        data.row = row;
+        return data;
+    }
+
+    AttachedData ref(int row)
+    {
+        // TODO optimize it
+        Base::iterator i = begin();
+        for (; i != end(); ++i) {
+            if (i.value().row == row)
+                break;
+        }
+        AttachedData &data = *i;
+        ++data.ref;
+        return data;
+    }
+
+    AttachedData deref(const QString &id)
+    {
+        Q_ASSERT(contains(id));
+        AttachedData attachedData = take(id);
+        if (--attachedData.ref)
+            insert(id, attachedData);
+        return attachedData;
+    }
+};
+
+#endif // ENGINIOMODELATTACHEDDATA_P_H
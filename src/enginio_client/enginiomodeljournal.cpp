@@ -0,0 +1,293 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#include "enginiomodeljournal_p.h"
+#include <QtCore/qdatastream.h>
+#include <QtCore/qdebug.h>
+#include <QtCore/qjsondocument.h>
+#include <QtCore/qsavefile.h>
+
+EnginioModelJournal::EnginioModelJournal()
+    : _headSent(false)
+    , _records(0)
+{}
+
+EnginioModelJournal::~EnginioModelJournal()
+{
+    close();
+}
+
+/*!
+  Opens the journal stored in \a fileName, creating it if needed, and loads the
+  mutations which were not acknowledged yet. A record truncated by a crash is
+  dropped. An entry which was in flight is considered as not sent.
+  \internal
+*/
+bool EnginioModelJournal::open(const QString &fileName)
+{
+    close();
+    _file.setFileName(fileName);
+    if (!_file.open(QIODevice::ReadWrite)) {
+        qWarning() << "EnginioModel: can not open journal" << fileName << _file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&_file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0, version = 0;
+    stream >> magic >> version;
+    if (stream.status() == QDataStream::Ok && (magic != Magic || version != Version)) {
+        qWarning() << "EnginioModel: ignoring journal" << fileName << "in an unknown format";
+        _file.close();
+        return false;
+    }
+
+    while (stream.status() == QDataStream::Ok && !stream.atEnd()) {
+        quint8 operation;
+        QString id;
+        QByteArray object;
+        stream >> operation >> id >> object;
+        if (stream.status() != QDataStream::Ok || operation > AcknowledgedRecord)
+            break;
+        apply(Operation(operation), id, QJsonDocument::fromBinaryData(object).object());
+    }
+    _headSent = false;
+
+    // rewrite the file, it drops incomplete records and coalesced entries
+    compact();
+    return _file.isOpen();
+}
+
+void EnginioModelJournal::close()
+{
+    _file.close();
+    _entries.clear();
+    _pending.clear();
+    _headSent = false;
+    _records = 0;
+}
+
+/*!
+  Records \a operation on the object \a id. An update is merged into a pending create or
+  update of the same object, a remove drops pending changes and cancels a pending create.
+  The entry which is in flight is never modified.
+  \internal
+*/
+void EnginioModelJournal::append(Operation operation, const QString &id, const QJsonObject &object)
+{
+    Q_ASSERT(operation <= RemoveOperation);
+    Q_ASSERT(!id.isEmpty());
+    write(operation, id, object);
+    apply(operation, id, object);
+    if (_entries.isEmpty() || _records > 2 * _entries.count() + CompactionThreshold)
+        compact();
+}
+
+void EnginioModelJournal::headSent()
+{
+    Q_ASSERT(!isEmpty() && !_headSent);
+    write(SentRecord);
+    apply(SentRecord, QString(), QJsonObject());
+}
+
+void EnginioModelJournal::headFailed()
+{
+    Q_ASSERT(!isEmpty() && _headSent);
+    write(FailedRecord);
+    apply(FailedRecord, QString(), QJsonObject());
+}
+
+/*!
+  Removes the head entry from the journal. If the head was a create, \a newId is the id
+  assigned by the server and it replaces the temporary id in the remaining entries. An empty
+  \a newId means that the object was not created and the remaining entries for it are dropped.
+  \internal
+*/
+void EnginioModelJournal::headAcknowledged(const QString &newId)
+{
+    Q_ASSERT(!isEmpty() && _headSent);
+    write(AcknowledgedRecord, newId);
+    apply(AcknowledgedRecord, newId, QJsonObject());
+    if (_entries.isEmpty() || _records > 2 * _entries.count() + CompactionThreshold)
+        compact();
+}
+
+void EnginioModelJournal::apply(Operation operation, const QString &id, const QJsonObject &object)
+{
+    switch (operation) {
+    case CreateOperation: {
+        Entry entry = {operation, id, object};
+        _entries.append(entry);
+        ref(id);
+        break;
+    }
+    case UpdateOperation: {
+        int i = lastUnsent(id);
+        if (i != -1) {
+            Entry &entry = _entries[i];
+            if (entry.operation == RemoveOperation)
+                return; // the object is gone, nothing to update
+            for (QJsonObject::const_iterator property = object.constBegin(); property != object.constEnd(); ++property)
+                entry.object[property.key()] = property.value();
+            return;
+        }
+        Entry entry = {operation, id, object};
+        _entries.append(entry);
+        ref(id);
+        break;
+    }
+    case RemoveOperation: {
+        int i = lastUnsent(id);
+        if (i != -1) {
+            if (_entries[i].operation == RemoveOperation)
+                return;
+            const Operation pending = _entries.takeAt(i).operation;
+            deref(id);
+            if (pending == CreateOperation)
+                return; // the object never reached the server
+        }
+        Entry entry = {operation, id, object};
+        _entries.append(entry);
+        ref(id);
+        break;
+    }
+    case SentRecord:
+        if (!_entries.isEmpty())
+            _headSent = true;
+        break;
+    case FailedRecord:
+        _headSent = false;
+        break;
+    case AcknowledgedRecord: {
+        if (_entries.isEmpty())
+            break;
+        const Entry head = _entries.takeFirst();
+        _headSent = false;
+        deref(head.id);
+        if (head.operation != CreateOperation || !_pending.contains(head.id))
+            break;
+        if (id.isEmpty()) {
+            // the object was not created, so changes made to it can not be applied
+            for (int i = _entries.count() - 1; i >= 0; --i) {
+                if (_entries[i].id == head.id)
+                    _entries.removeAt(i);
+            }
+            _pending.remove(head.id);
+        } else {
+            for (int i = 0; i < _entries.count(); ++i) {
+                if (_entries[i].id == head.id)
+                    _entries[i].id = id;
+            }
+            _pending.insert(id, _pending.take(head.id));
+        }
+        break;
+    }
+    }
+}
+
+int EnginioModelJournal::lastUnsent(const QString &id) const
+{
+    if (!_pending.contains(id))
+        return -1;
+    const int first = _headSent ? 1 : 0;
+    for (int i = _entries.count() - 1; i >= first; --i) {
+        if (_entries[i].id == id)
+            return i;
+    }
+    return -1;
+}
+
+void EnginioModelJournal::ref(const QString &id)
+{
+    ++_pending[id];
+}
+
+void EnginioModelJournal::deref(const QString &id)
+{
+    QHash<QString, int>::iterator i = _pending.find(id);
+    Q_ASSERT(i != _pending.end());
+    if (!--i.value())
+        _pending.erase(i);
+}
+
+void EnginioModelJournal::write(Operation operation, const QString &id, const QJsonObject &object)
+{
+    if (!_file.isOpen())
+        return;
+    QDataStream stream(&_file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << quint8(operation) << id << (object.isEmpty() ? QByteArray() : QJsonDocument(object).toBinaryData());
+    _file.flush();
+    ++_records;
+}
+
+bool EnginioModelJournal::writeHeader(QIODevice *device)
+{
+    QDataStream stream(device);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << quint32(Magic) << quint32(Version);
+    return stream.status() == QDataStream::Ok;
+}
+
+/*!
+  Replaces the journal file by the coalesced entries.
+  \internal
+*/
+void EnginioModelJournal::compact()
+{
+    if (!_file.isOpen())
+        return;
+    const QString fileName = _file.fileName();
+    _file.close();
+
+    QSaveFile file(fileName);
+    if (file.open(QIODevice::WriteOnly) && writeHeader(&file)) {
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        foreach (const Entry &entry, _entries)
+            stream << quint8(entry.operation) << entry.id << QJsonDocument(entry.object).toBinaryData();
+        if (_headSent)
+            stream << quint8(SentRecord) << QString() << QByteArray();
+        if (file.commit())
+            _records = _entries.count() + (_headSent ? 1 : 0);
+    }
+    if (file.error() != QFileDevice::NoError)
+        qWarning() << "EnginioModel: can not compact journal" << fileName << file.errorString();
+
+    if (_file.open(QIODevice::ReadWrite))
+        _file.seek(_file.size());
+}
@@ -0,0 +1,126 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#ifndef ENGINIOMODELJOURNAL_P_H
+#define ENGINIOMODELJOURNAL_P_H
+
+#include "enginioclient_global.h"
+#include <QtCore/qfile.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qstring.h>
+
+/*!
+  \brief The EnginioModelJournal class is a write-ahead log of EnginioModel mutations
+
+  Every mutation is appended to the journal file before it is sent, so that changes
+  made without connectivity survive until they can be replayed. In memory the journal
+  keeps at most one pending entry per object id; later edits are merged into it.
+
+  The file is a sequence of records written with QDataStream. Besides the mutations
+  it records when the head entry was sent and acknowledged, so that loading the file
+  reproduces the coalesced in memory state. It is compacted once it grows too much.
+
+  \internal
+*/
+class ENGINIOCLIENT_EXPORT EnginioModelJournal
+{
+public:
+    enum Operation {
+        CreateOperation,
+        UpdateOperation,
+        RemoveOperation,
+        // file only records
+        SentRecord,
+        FailedRecord,
+        AcknowledgedRecord
+    };
+
+    struct Entry
+    {
+        Operation operation;
+        QString id;
+        QJsonObject object;
+    };
+
+    EnginioModelJournal();
+    ~EnginioModelJournal();
+
+    bool open(const QString &fileName);
+    void close();
+    QString fileName() const Q_REQUIRED_RESULT { return _file.fileName(); }
+    bool isOpen() const Q_REQUIRED_RESULT { return _file.isOpen(); }
+
+    bool isEmpty() const Q_REQUIRED_RESULT { return _entries.isEmpty(); }
+    int count() const Q_REQUIRED_RESULT { return _entries.count(); }
+    const QList<Entry> &entries() const Q_REQUIRED_RESULT { return _entries; }
+    bool isPending(const QString &id) const Q_REQUIRED_RESULT { return _pending.contains(id); }
+
+    void append(Operation operation, const QString &id, const QJsonObject &object);
+
+    bool isHeadSent() const Q_REQUIRED_RESULT { return _headSent; }
+    const Entry &head() const Q_REQUIRED_RESULT { Q_ASSERT(!isEmpty()); return _entries.first(); }
+    void headSent();
+    void headFailed();
+    void headAcknowledged(const QString &newId = QString());
+
+private:
+    Q_DISABLE_COPY(EnginioModelJournal)
+
+    enum {
+        Magic = 0x454a4e4c, // "EJNL"
+        Version = 1,
+        CompactionThreshold = 64
+    };
+
+    void apply(Operation operation, const QString &id, const QJsonObject &object);
+    void write(Operation operation, const QString &id = QString(), const QJsonObject &object = QJsonObject());
+    bool writeHeader(QIODevice *device);
+    void compact();
+    int lastUnsent(const QString &id) const Q_REQUIRED_RESULT;
+    void ref(const QString &id);
+    void deref(const QString &id);
+
+    QFile _file;
+    QList<Entry> _entries;
+    QHash<QString, int> _pending;
+    bool _headSent;
+    int _records;
+};
+
+#endif // ENGINIOMODELJOURNAL_P_H
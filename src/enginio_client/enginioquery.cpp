@@ -0,0 +1,343 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#include "enginioquery_p.h"
+#include "enginiostring_p.h"
+
+#include <QtCore/qjsonarray.h>
+
+/*!
+  \class EnginioQuery
+  \inmodule enginio-qt
+  \ingroup enginio-client
+  \brief EnginioQuery describes a query with typed parameters.
+
+  The query is compiled directly to the request url, unlike the JSON object passed to
+  EnginioClient::query(const QJsonObject &, const Operation), whose properties have to be
+  looked up and serialized for every request. The setters return the query, so that
+  they can be chained:
+
+  \code
+    EnginioQuery query(QStringLiteral("objects.todos"));
+    query.setLimit(10).addSort(QStringLiteral("createdAt"), Qt::DescendingOrder).addField(QStringLiteral("title"));
+    EnginioReply *reply = client->query(query);
+  \endcode
+
+  Queries of objects, users and usergroups are supported.
+
+  \sa EnginioClient::query()
+*/
+
+void EnginioQueryPrivate::encode(EnginioQueryEncoder *encoder) const
+{
+    // the same order as the JSON based queries
+    if (limit)
+        encoder->addItem(QLatin1String("limit"), limit);
+    if (offset)
+        encoder->addItem(QLatin1String("offset"), offset);
+
+    if (!include.isEmpty()) {
+        encoder->beginItem(QLatin1String("include"));
+        encoder->write("{");
+        for (int i = 0; i < include.count(); ++i) {
+            if (i)
+                encoder->write(",");
+            encoder->writeJsonString(include[i]);
+            encoder->write(":{}");
+        }
+        encoder->write("}");
+    }
+
+    if (!sort.isEmpty()) {
+        encoder->beginItem(QLatin1String("sort"));
+        encoder->write("[");
+        for (int i = 0; i < sort.count(); ++i) {
+            if (i)
+                encoder->write(",");
+            encoder->write("{\"sortBy\":");
+            encoder->writeJsonString(sort[i].first);
+            encoder->write(sort[i].second == Qt::AscendingOrder ? ",\"direction\":\"asc\"}" : ",\"direction\":\"desc\"}");
+        }
+        encoder->write("]");
+    }
+
+    if (!fields.isEmpty()) {
+        encoder->beginItem(QLatin1String("fields"));
+        encoder->write("[");
+        for (int i = 0; i < fields.count(); ++i) {
+            if (i)
+                encoder->write(",");
+            encoder->writeJsonString(fields[i]);
+        }
+        encoder->write("]");
+    }
+
+    if (!filter.isEmpty())
+        encoder->addItem(QLatin1String("q"), QJsonValue(filter));
+}
+
+/*!
+  Constructs an empty object query.
+*/
+EnginioQuery::EnginioQuery()
+    : d(new EnginioQueryPrivate)
+{}
+
+/*!
+  Constructs a query of the objects of type \a objectType, for example "objects.todos".
+*/
+EnginioQuery::EnginioQuery(const QString &objectType)
+    : d(new EnginioQueryPrivate)
+{
+    d->objectType = objectType;
+}
+
+/*!
+  Constructs a query of the \a operation area, for example EnginioClient::UserOperation.
+*/
+EnginioQuery::EnginioQuery(EnginioClient::Operation operation)
+    : d(new EnginioQueryPrivate)
+{
+    d->operation = operation;
+}
+
+/*!
+  Constructs a copy of \a other.
+*/
+EnginioQuery::EnginioQuery(const EnginioQuery &other)
+    : d(other.d)
+{}
+
+/*!
+  Destroys the query.
+*/
+EnginioQuery::~EnginioQuery()
+{}
+
+/*!
+  Assigns \a other to this query.
+*/
+EnginioQuery &EnginioQuery::operator=(const EnginioQuery &other)
+{
+    d = other.d;
+    return *this;
+}
+
+/*!
+  Returns the area of the backend which is queried, EnginioClient::ObjectOperation by default.
+  \sa setOperation()
+*/
+EnginioClient::Operation EnginioQuery::operation() const
+{
+    return d->operation;
+}
+
+/*!
+  Sets the queried area of the backend to \a operation.
+*/
+EnginioQuery &EnginioQuery::setOperation(EnginioClient::Operation operation)
+{
+    d->operation = operation;
+    return *this;
+}
+
+/*!
+  Returns the type of the queried objects.
+  \sa setObjectType()
+*/
+QString EnginioQuery::objectType() const
+{
+    return d->objectType;
+}
+
+/*!
+  Sets the type of the queried objects to \a objectType, it is required by object queries.
+*/
+EnginioQuery &EnginioQuery::setObjectType(const QString &objectType)
+{
+    d->objectType = objectType;
+    return *this;
+}
+
+/*!
+  Returns the condition the objects have to match.
+  \sa setFilter()
+*/
+QJsonObject EnginioQuery::filter() const
+{
+    return d->filter;
+}
+
+/*!
+  Sets the condition the objects have to match to \a filter, in the format of the
+  \c query property of the JSON queries, for example \c{{"completed": false}}.
+*/
+EnginioQuery &EnginioQuery::setFilter(const QJsonObject &filter)
+{
+    d->filter = filter;
+    return *this;
+}
+
+/*!
+  Returns the properties the results are sorted by, in the order of their importance.
+  \sa addSort()
+*/
+QList<QPair<QString, Qt::SortOrder> > EnginioQuery::sort() const
+{
+    return d->sort;
+}
+
+/*!
+  Sorts the results by \a property in the \a order, after the properties added before.
+*/
+EnginioQuery &EnginioQuery::addSort(const QString &property, Qt::SortOrder order)
+{
+    d->sort.append(qMakePair(property, order));
+    return *this;
+}
+
+/*!
+  Returns the maximal number of results, 0 means the backend default.
+  \sa setLimit()
+*/
+int EnginioQuery::limit() const
+{
+    return d->limit;
+}
+
+/*!
+  Sets the maximal number of results to \a limit.
+*/
+EnginioQuery &EnginioQuery::setLimit(int limit)
+{
+    d->limit = qMax(0, limit);
+    return *this;
+}
+
+/*!
+  Returns the number of results which are skipped.
+  \sa setOffset()
+*/
+int EnginioQuery::offset() const
+{
+    return d->offset;
+}
+
+/*!
+  Skips the first \a offset results.
+*/
+EnginioQuery &EnginioQuery::setOffset(int offset)
+{
+    d->offset = qMax(0, offset);
+    return *this;
+}
+
+/*!
+  Returns the reference properties whose objects are included in the results.
+  \sa addInclude()
+*/
+QStringList EnginioQuery::include() const
+{
+    return d->include;
+}
+
+/*!
+  Includes the objects referenced by \a property in the results, for example "creator".
+*/
+EnginioQuery &EnginioQuery::addInclude(const QString &property)
+{
+    d->include.append(property);
+    return *this;
+}
+
+/*!
+  Returns the properties the results are limited to, all properties are returned if it is empty.
+  \sa addField()
+*/
+QStringList EnginioQuery::fields() const
+{
+    return d->fields;
+}
+
+/*!
+  Adds \a property to the properties the results are limited to. A backend without
+  projection support returns whole objects.
+*/
+EnginioQuery &EnginioQuery::addField(const QString &property)
+{
+    d->fields.append(property);
+    return *this;
+}
+
+/*!
+  Returns the query in the JSON format accepted by EnginioClient::query(const QJsonObject &, const Operation)
+  and EnginioModel::query.
+*/
+QJsonObject EnginioQuery::toJson() const
+{
+    QJsonObject result;
+    if (d->operation == EnginioClient::ObjectOperation)
+        result[EnginioString::objectType] = d->objectType;
+    if (!d->filter.isEmpty())
+        result[EnginioString::query] = d->filter;
+    if (d->limit)
+        result[EnginioString::limit] = d->limit;
+    if (d->offset)
+        result[EnginioString::offset] = d->offset;
+
+    if (!d->sort.isEmpty()) {
+        QJsonArray sort;
+        for (int i = 0; i < d->sort.count(); ++i) {
+            QJsonObject property;
+            property[EnginioString::sortBy] = d->sort[i].first;
+            property[EnginioString::direction] = d->sort[i].second == Qt::AscendingOrder ? QStringLiteral("asc") : QStringLiteral("desc");
+            sort.append(property);
+        }
+        result[EnginioString::sort] = sort;
+    }
+
+    if (!d->include.isEmpty()) {
+        QJsonObject include;
+        foreach (const QString &property, d->include)
+            include[property] = QJsonObject();
+        result[EnginioString::include] = include;
+    }
+
+    if (!d->fields.isEmpty())
+        result[EnginioString::fields] = QJsonArray::fromStringList(d->fields);
+    return result;
+}
@@ -0,0 +1,87 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#ifndef ENGINIOQUERY_H
+#define ENGINIOQUERY_H
+
+#include "enginioclient.h"
+
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qpair.h>
+#include <QtCore/qshareddata.h>
+#include <QtCore/qstringlist.h>
+
+class EnginioQueryPrivate;
+class ENGINIOCLIENT_EXPORT EnginioQuery
+{
+public:
+    EnginioQuery();
+    explicit EnginioQuery(const QString &objectType);
+    explicit EnginioQuery(EnginioClient::Operation operation);
+    EnginioQuery(const EnginioQuery &other);
+    ~EnginioQuery();
+    EnginioQuery &operator=(const EnginioQuery &other);
+
+    EnginioClient::Operation operation() const Q_REQUIRED_RESULT;
+    EnginioQuery &setOperation(EnginioClient::Operation operation);
+    QString objectType() const Q_REQUIRED_RESULT;
+    EnginioQuery &setObjectType(const QString &objectType);
+    QJsonObject filter() const Q_REQUIRED_RESULT;
+    EnginioQuery &setFilter(const QJsonObject &filter);
+    QList<QPair<QString, Qt::SortOrder> > sort() const Q_REQUIRED_RESULT;
+    EnginioQuery &addSort(const QString &property, Qt::SortOrder order = Qt::AscendingOrder);
+    int limit() const Q_REQUIRED_RESULT;
+    EnginioQuery &setLimit(int limit);
+    int offset() const Q_REQUIRED_RESULT;
+    EnginioQuery &setOffset(int offset);
+    QStringList include() const Q_REQUIRED_RESULT;
+    EnginioQuery &addInclude(const QString &property);
+    QStringList fields() const Q_REQUIRED_RESULT;
+    EnginioQuery &addField(const QString &property);
+
+    QJsonObject toJson() const Q_REQUIRED_RESULT;
+
+private:
+    QSharedDataPointer<EnginioQueryPrivate> d;
+    friend class EnginioQueryPrivate;
+};
+
+Q_DECLARE_TYPEINFO(EnginioQuery, Q_MOVABLE_TYPE);
+Q_DECLARE_METATYPE(EnginioQuery);
+
+#endif // ENGINIOQUERY_H
@@ -0,0 +1,303 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#ifndef ENGINIOQUERYENCODER_P_H
+#define ENGINIOQUERYENCODER_P_H
+
+#include "enginioclient_global.h"
+#include "enginioobjectadaptor_p.h"
+#include <QtCore/qbytearray.h>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qjsonvalue.h>
+#include <QtCore/qnumeric.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qurl.h>
+
+/*!
+  \brief Writes the percent encoded query string of a request url
+
+  Both the typed EnginioQuery and the JSON based queries are compiled to the url with
+  this class. The item names are constants, the values are percent encoded as they are
+  written. JSON values are serialized directly into the encoded buffer, in one pass and
+  without a QJsonDocument, which matters for filters listing hundreds of ids.
+
+  A query too long for the url is written as a JSON object body instead, see
+  EnginioClientPrivate::sendQuery().
+
+  \internal
+*/
+class EnginioQueryEncoder
+{
+public:
+    enum Format {
+        UrlQuery, // name=value&name=value
+        JsonBody // {"name":value,"name":value}
+    };
+
+private:
+    QByteArray _encoded;
+    Format _format;
+
+    static bool isUnreserved(uint c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+                || c == '-' || c == '.' || c == '_' || c == '~';
+    }
+
+    void writeByte(uchar c)
+    {
+        static const char hex[] = "0123456789ABCDEF";
+        if (_format == JsonBody || isUnreserved(c)) {
+            _encoded.append(char(c));
+        } else {
+            const char escaped[3] = { '%', hex[c >> 4], hex[c & 0xf] };
+            _encoded.append(escaped, 3);
+        }
+    }
+
+    void writeCodePoint(uint c)
+    {
+        if (c < 0x80) {
+            writeByte(c);
+        } else if (c < 0x800) {
+            writeByte(0xc0 | (c >> 6));
+            writeByte(0x80 | (c & 0x3f));
+        } else if (c < 0x10000) {
+            writeByte(0xe0 | (c >> 12));
+            writeByte(0x80 | ((c >> 6) & 0x3f));
+            writeByte(0x80 | (c & 0x3f));
+        } else {
+            writeByte(0xf0 | (c >> 18));
+            writeByte(0x80 | ((c >> 12) & 0x3f));
+            writeByte(0x80 | ((c >> 6) & 0x3f));
+            writeByte(0x80 | (c & 0x3f));
+        }
+    }
+
+public:
+    explicit EnginioQueryEncoder(Format format = UrlQuery)
+        : _format(format)
+    {
+        _encoded.reserve(128);
+        if (format == JsonBody)
+            _encoded.append('{');
+    }
+
+    // starts a new item, the value is written by the write functions
+    void beginItem(QLatin1String name)
+    {
+        if (_format == UrlQuery) {
+            if (!_encoded.isEmpty())
+                _encoded.append('&');
+            _encoded.append(name.latin1(), name.size());
+            _encoded.append('=');
+        } else {
+            if (_encoded.size() > 1)
+                _encoded.append(',');
+            _encoded.append('"');
+            _encoded.append(name.latin1(), name.size());
+            _encoded.append("\":", 2);
+        }
+    }
+
+    void write(const char *data, int size)
+    {
+        for (int i = 0; i < size; ++i)
+            writeByte(data[i]);
+    }
+
+    void write(const char *data)
+    {
+        for (; *data; ++data)
+            writeByte(*data);
+    }
+
+    void writeJsonString(const QString &string)
+    {
+        writeByte('"');
+        const QChar *end = string.constData() + string.size();
+        for (const QChar *c = string.constData(); c != end; ++c) {
+            const ushort u = c->unicode();
+            if (isUnreserved(u)) { // the common case
+                _encoded.append(char(u));
+                continue;
+            }
+            switch (u) {
+            case '"': write("\\\"", 2); break;
+            case '\\': write("\\\\", 2); break;
+            case '\b': write("\\b", 2); break;
+            case '\f': write("\\f", 2); break;
+            case '\n': write("\\n", 2); break;
+            case '\r': write("\\r", 2); break;
+            case '\t': write("\\t", 2); break;
+            default:
+                if (u < 0x20) {
+                    static const char hex[] = "0123456789abcdef";
+                    const char escaped[6] = { '\\', 'u', '0', '0', hex[u >> 4], hex[u & 0xf] };
+                    write(escaped, 6);
+                } else if (c->isHighSurrogate() && c + 1 != end && c[1].isLowSurrogate()) {
+                    writeCodePoint(QChar::surrogateToUcs4(u, c[1].unicode()));
+                    ++c;
+                } else if (c->isSurrogate()) {
+                    writeCodePoint(QChar::ReplacementCharacter);
+                } else {
+                    writeCodePoint(u);
+                }
+            }
+        }
+        writeByte('"');
+    }
+
+    // the same format as QJsonDocument::Compact, object keys are sorted by QJsonObject
+    void writeJson(const QJsonValue &value)
+    {
+        switch (value.type()) {
+        case QJsonValue::Null:
+        case QJsonValue::Undefined:
+            _encoded.append("null", 4);
+            break;
+        case QJsonValue::Bool:
+            if (value.toBool())
+                _encoded.append("true", 4);
+            else
+                _encoded.append("false", 5);
+            break;
+        case QJsonValue::Double: {
+            const double d = value.toDouble();
+            if (qIsFinite(d)) {
+                const qint64 integer = qint64(d);
+                if (d == double(integer) && qAbs(integer) < (Q_INT64_C(1) << 53))
+                    _encoded.append(QByteArray::number(integer));
+                else
+                    write(QByteArray::number(d, 'g', 17).constData());
+            } else {
+                _encoded.append("null", 4);
+            }
+            break;
+        }
+        case QJsonValue::String:
+            writeJsonString(value.toString());
+            break;
+        case QJsonValue::Array: {
+            const QJsonArray array = value.toArray();
+            writeByte('[');
+            for (QJsonArray::const_iterator i = array.constBegin(); i != array.constEnd(); ++i) {
+                if (i != array.constBegin())
+                    writeByte(',');
+                writeJson(*i);
+            }
+            writeByte(']');
+            break;
+        }
+        case QJsonValue::Object: {
+            const QJsonObject object = value.toObject();
+            writeByte('{');
+            for (QJsonObject::const_iterator i = object.constBegin(); i != object.constEnd(); ++i) {
+                if (i != object.constBegin())
+                    writeByte(',');
+                writeJsonString(i.key());
+                writeByte(':');
+                writeJson(i.value());
+            }
+            writeByte('}');
+            break;
+        }
+        }
+    }
+
+    // a value serialized to JSON already
+    void addJsonItem(QLatin1String name, const QByteArray &json)
+    {
+        beginItem(name);
+        write(json.constData(), json.size());
+    }
+
+    void addItem(QLatin1String name, const QString &value)
+    {
+        beginItem(name);
+        if (_format == JsonBody) {
+            writeJsonString(value);
+        } else {
+            const QByteArray utf8 = value.toUtf8();
+            write(utf8.constData(), utf8.size());
+        }
+    }
+
+    void addItem(QLatin1String name, int value)
+    {
+        beginItem(name);
+        _encoded.append(QByteArray::number(value));
+    }
+
+    void addItem(QLatin1String name, const QJsonValue &value)
+    {
+        beginItem(name);
+        writeJson(value);
+    }
+
+    // JSON values of other adaptors are serialized first
+    template<class T>
+    void addItem(QLatin1String name, const ValueAdaptor<T> &value)
+    {
+        addJsonItem(name, value.toJson());
+    }
+
+    void addItem(QLatin1String name, const ValueAdaptor<QJsonObject> &value)
+    {
+        addItem(name, value._value);
+    }
+
+    Format format() const Q_REQUIRED_RESULT { return _format; }
+    QByteArray encoded() const Q_REQUIRED_RESULT { return _encoded; }
+    int size() const Q_REQUIRED_RESULT { return _encoded.size(); }
+    bool isEmpty() const Q_REQUIRED_RESULT { return _encoded.size() == (_format == JsonBody ? 1 : 0); }
+
+    void applyTo(QUrl *url) const
+    {
+        Q_ASSERT(_format == UrlQuery);
+        url->setQuery(QString::fromLatin1(_encoded.constData(), _encoded.size()));
+    }
+
+    QByteArray body() const Q_REQUIRED_RESULT
+    {
+        Q_ASSERT(_format == JsonBody);
+        return _encoded + '}';
+    }
+};
+
+#endif // ENGINIOQUERYENCODER_P_H
@@ -38,6 +38,7 @@
 #include <QtCore/qstring.h>
 #include <QtCore/qjsonobject.h>
 #include <QtCore/qjsondocument.h>
+#include <QtCore/qdatetime.h>
 #include <QtNetwork/qnetworkreply.h>
 
 #include "enginioreply.h"
@@ -63,6 +64,7 @@
   \value NoError The reply returned without errors
   \value NetworkError The error was a networking problem
   \value BackendError The backend did not accept the query
+  \value TimeoutError The request was aborted because it did not finish in time
 */
 
 /*!
@@ -86,6 +88,8 @@ EnginioReply::EnginioReply(EnginioClientPrivate *p, QNetworkReply *reply)
     , d(new EnginioReplyPrivate(p, reply))
 {
     p->registerReply(reply, this);
+    if (p->_requestTimeout)
+        p->setDeadline(this, QDateTime::currentMSecsSinceEpoch() + p->_requestTimeout);
 }
 
 /*!
@@ -97,6 +101,8 @@ EnginioReply::EnginioReply(EnginioClientPrivate *parent, QNetworkReply *reply, E
 {
     parent->registerReply(reply, this);
     reply->setParent(this);
+    if (parent->_requestTimeout)
+        parent->setDeadline(this, QDateTime::currentMSecsSinceEpoch() + parent->_requestTimeout);
 }
 
 
@@ -155,7 +161,7 @@ void EnginioReply::setNetworkReply(QNetworkReply *reply)
 {
     d->_client->_replyReplyMap.remove(d->_nreply);
 
-    if (gEnableEnginioDebugInfo)
+    if (Q_UNLIKELY(gEnableEnginioDebugInfo))
         d->_client->_requestData.remove(d->_nreply);
 
     d->_nreply->deleteLater();
@@ -226,6 +232,39 @@ bool EnginioReply::isFinished() const
     return d->isFinished();
 }
 
+/*!
+  \brief Aborts the request.
+
+  The reply finishes with the QNetworkReply::OperationCanceledError network error.
+  All work belonging to the request is stopped, like the remaining chunks of a file
+  upload or download, and a delayed EnginioModel operation waiting for the object
+  to be created is not sent anymore.
+
+  Calling the function for a finished reply has no effect.
+*/
+void EnginioReply::abort()
+{
+    // a reply which is not tracked by the client has finished already
+    if (!d->_client->_replyReplyMap.contains(d->_nreply))
+        return;
+    d->_nreply->abort();
+}
+
+/*!
+  \brief Aborts the request if it is not finished within \a msecs milliseconds.
+
+  The time is counted from this call and covers the whole operation, including
+  all chunks of a file upload or download that are still waiting to be sent.
+  A request aborted this way finishes with the TimeoutError error type.
+  Passing 0 removes the timeout.
+
+  \sa EnginioClient::requestTimeout
+*/
+void EnginioReply::setTimeout(int msecs)
+{
+    d->_client->setDeadline(this, msecs > 0 ? QDateTime::currentMSecsSinceEpoch() + msecs : 0);
+}
+
 /*!
   \property EnginioReply::backendStatus
   \return the backend return status for this reply.
@@ -59,7 +59,8 @@ public:
     enum ErrorTypes {
         NoError,
         NetworkError,
-        BackendError
+        BackendError,
+        TimeoutError
     };
     Q_ENUMS(ErrorTypes)
 
@@ -81,6 +82,9 @@ public:
     bool isError() const Q_REQUIRED_RESULT;
     bool isFinished() const Q_REQUIRED_RESULT;
 
+    Q_INVOKABLE void setTimeout(int msecs);
+    Q_INVOKABLE void abort();
+
     Q_SLOT void dumpDebugInfo() const;
 
     void setDelayFinishedSignal(bool delay);
@@ -53,10 +53,14 @@ public:
     QNetworkReply *_nreply;
     mutable QJsonObject _data;
     bool _delay;
+    bool _timedOut;
+    qint64 _deadline; // ms since epoch, 0 if there is none
     EnginioReplyPrivate(EnginioClientPrivate *p, QNetworkReply *reply)
         : _client(p)
         , _nreply(reply)
         , _delay(false)
+        , _timedOut(false)
+        , _deadline(0)
     {
         Q_ASSERT(reply);
     }
@@ -85,6 +89,8 @@ public:
     {
         if (errorCode() == QNetworkReply::NoError)
             return EnginioReply::NoError;
+        if (_timedOut)
+            return EnginioReply::TimeoutError;
         if (data().isEmpty())
             return EnginioReply::NetworkError;
         return EnginioReply::BackendError;
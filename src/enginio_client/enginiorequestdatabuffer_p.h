@@ -0,0 +1,163 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#ifndef ENGINIOREQUESTDATABUFFER_P_H
+#define ENGINIOREQUESTDATABUFFER_P_H
+
+#include "enginioclient_global.h"
+#include <QtCore/qbytearray.h>
+#include <QtCore/qvector.h>
+
+class QNetworkReply;
+
+/*!
+  \brief Keeps the payloads of the latest requests for EnginioReply::dumpDebugInfo()
+
+  The buffer is used only if the ENGINIO_DEBUG_INFO environment variable is set. It is
+  a ring of a fixed number of entries, each payload is truncated to maxEntrySize and the
+  oldest entries are dropped when the payloads take more than maxTotalSize bytes, so the
+  memory used does not depend on the size or the number of the requests. With a sample
+  rate of n only every n-th request is captured.
+
+  \internal
+*/
+class EnginioRequestDataBuffer
+{
+    struct Entry
+    {
+        Entry() : reply() {}
+        QNetworkReply *reply;
+        QByteArray data;
+    };
+
+    QVector<Entry> _entries; // allocated by the first insert
+    int _capacity;
+    int _next; // the slot written next, it holds the oldest entry
+    int _totalSize;
+    int _maxEntrySize;
+    int _maxTotalSize;
+    int _sampleRate;
+    int _skipped;
+
+public:
+    EnginioRequestDataBuffer()
+        : _next(0)
+        , _totalSize(0)
+    {
+        setLimits(32, 4 * 1024, 64 * 1024, 1);
+    }
+
+    void setLimits(int capacity, int maxEntrySize, int maxTotalSize, int sampleRate)
+    {
+        Q_ASSERT(capacity > 0);
+        _entries.clear();
+        _capacity = capacity;
+        _next = 0;
+        _totalSize = 0;
+        _maxEntrySize = maxEntrySize;
+        _maxTotalSize = maxTotalSize;
+        _sampleRate = qMax(1, sampleRate);
+        _skipped = 0;
+    }
+
+    void insert(QNetworkReply *reply, const QByteArray &data)
+    {
+        if (++_skipped < _sampleRate)
+            return;
+        _skipped = 0;
+
+        if (_entries.isEmpty())
+            _entries.resize(_capacity);
+        remove(reply); // the reply may be captured already, e.g. by a create with a file
+        Entry &entry = _entries[_next];
+        _totalSize -= entry.data.size();
+        entry.reply = reply;
+        entry.data = data.size() > _maxEntrySize ? data.left(_maxEntrySize) + QByteArrayLiteral("...") : data;
+        _totalSize += entry.data.size();
+        _next = (_next + 1) % _entries.size();
+
+        // drop the oldest entries, the new one is always kept
+        const int newest = (_next + _entries.size() - 1) % _entries.size();
+        for (int i = _next; _totalSize > _maxTotalSize && i != newest; i = (i + 1) % _entries.size())
+            drop(_entries[i]);
+    }
+
+    QByteArray value(QNetworkReply *reply) const
+    {
+        for (int i = 0; i < _entries.size(); ++i) {
+            if (_entries[i].reply == reply)
+                return _entries[i].data;
+        }
+        return QByteArray();
+    }
+
+    void remove(QNetworkReply *reply)
+    {
+        for (int i = 0; i < _entries.size(); ++i) {
+            if (_entries[i].reply == reply)
+                drop(_entries[i]);
+        }
+    }
+
+    void clear()
+    {
+        for (int i = 0; i < _entries.size(); ++i)
+            drop(_entries[i]);
+    }
+
+    int count() const Q_REQUIRED_RESULT
+    {
+        int result = 0;
+        for (int i = 0; i < _entries.size(); ++i) {
+            if (_entries[i].reply)
+                ++result;
+        }
+        return result;
+    }
+
+    int totalSize() const Q_REQUIRED_RESULT { return _totalSize; }
+
+private:
+    void drop(Entry &entry)
+    {
+        _totalSize -= entry.data.size();
+        entry.reply = 0;
+        entry.data = QByteArray();
+    }
+};
+
+#endif // ENGINIOREQUESTDATABUFFER_P_H
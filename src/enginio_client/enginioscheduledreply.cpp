@@ -0,0 +1,250 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#include "enginioscheduledreply_p.h"
+#include "enginioclient_p.h"
+
+#include <QtCore/qcoreevent.h>
+
+EnginioScheduledReply::EnginioScheduledReply(EnginioClientPrivate *client, QNetworkAccessManager::Operation operation, const QNetworkRequest &request,
+                                             const QByteArray &data, QIODevice *body, QHttpMultiPart *multiPart, int requestClass, qint64 transferSize)
+    : QNetworkReply(client->q_ptr)
+    , _client(client)
+    , _reply()
+    , _data(data)
+    , _body(body)
+    , _multiPart(multiPart)
+    , _requestClass(requestClass)
+    , _transferSize(transferSize)
+    , _attempts(0)
+    , _retryTimer(0)
+    , _retryable(false)
+    , _retrying(false)
+    , _dataForwarded(false)
+{
+    QIODevice::open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    setOperation(operation);
+    setRequest(request);
+    setUrl(request.url());
+}
+
+void EnginioScheduledReply::setNetworkReply(QNetworkReply *reply)
+{
+    Q_ASSERT(!_reply);
+    _reply = reply;
+    ++_attempts;
+    reply->setParent(this);
+
+    QObject::connect(reply, &QNetworkReply::metaDataChanged, this, &EnginioScheduledReply::networkMetaDataChanged);
+    QObject::connect(reply, &QNetworkReply::readyRead, this, &EnginioScheduledReply::networkReadyRead);
+    QObject::connect(reply, &QNetworkReply::downloadProgress, this, &EnginioScheduledReply::networkDownloadProgress);
+    QObject::connect(reply, &QNetworkReply::uploadProgress, this, &EnginioScheduledReply::uploadProgress);
+    QObject::connect(reply, static_cast<void (QNetworkReply::*)(QNetworkReply::NetworkError)>(&QNetworkReply::error),
+                     this, &EnginioScheduledReply::networkError);
+    QObject::connect(reply, &QNetworkReply::finished, this, &EnginioScheduledReply::networkFinished);
+}
+
+bool EnginioScheduledReply::canRetry() const
+{
+    return _retryable && !_dataForwarded && _attempts < _client->_maxAttempts;
+}
+
+static bool isTransientStatus(int status)
+{
+    return status == 500 || status == 502 || status == 503 || status == 504;
+}
+
+static bool isTransientError(QNetworkReply::NetworkError code)
+{
+    switch (code) {
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::UnknownNetworkError:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void EnginioScheduledReply::retry()
+{
+    QNetworkReply *reply = _reply;
+    _reply = 0;
+    _retrying = false;
+    reply->disconnect(this);
+    reply->deleteLater();
+    if (Q_UNLIKELY(_client->_metrics->isEnabled()))
+        _client->_metrics->requestRetried();
+
+    // exponential backoff up to ten minutes, with a random jitter of up to a half of the delay
+    const int delay = qMin<qint64>(qint64(_client->_retryDelay) << qMin(_attempts - 1, 10), MaxRetryDelay);
+    _retryTimer = startTimer(delay / 2 + qrand() % (delay / 2 + 1));
+}
+
+void EnginioScheduledReply::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() != _retryTimer) {
+        QNetworkReply::timerEvent(event);
+        return;
+    }
+    killTimer(_retryTimer);
+    _retryTimer = 0;
+    if (_body)
+        _body->reset();
+    _client->scheduleRequest(this);
+}
+
+void EnginioScheduledReply::copyMetaData()
+{
+    static const QNetworkRequest::Attribute attributes[] = {
+        QNetworkRequest::HttpStatusCodeAttribute,
+        QNetworkRequest::HttpReasonPhraseAttribute,
+        QNetworkRequest::RedirectionTargetAttribute,
+        QNetworkRequest::ConnectionEncryptedAttribute,
+        QNetworkRequest::SourceIsFromCacheAttribute
+    };
+
+    setUrl(_reply->url());
+    foreach (const RawHeaderPair &header, _reply->rawHeaderPairs())
+        setRawHeader(header.first, header.second);
+    for (uint i = 0; i < sizeof(attributes) / sizeof(attributes[0]); ++i)
+        setAttribute(attributes[i], _reply->attribute(attributes[i]));
+}
+
+void EnginioScheduledReply::networkMetaDataChanged()
+{
+    if (!_retrying && canRetry())
+        _retrying = isTransientStatus(_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt());
+    if (_retrying)
+        return;
+    copyMetaData();
+    emit metaDataChanged();
+}
+
+void EnginioScheduledReply::networkReadyRead()
+{
+    if (_retrying)
+        return;
+    _dataForwarded = true;
+    emit readyRead();
+}
+
+void EnginioScheduledReply::networkDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
+{
+    if (_retrying)
+        return;
+    emit downloadProgress(bytesReceived, bytesTotal);
+}
+
+void EnginioScheduledReply::networkError(QNetworkReply::NetworkError code)
+{
+    if (!_retrying && canRetry())
+        _retrying = isTransientError(code);
+    if (_retrying)
+        return;
+    setError(code, _reply->errorString());
+    emit error(code);
+}
+
+void EnginioScheduledReply::networkFinished()
+{
+    if (_retrying) {
+        retry();
+        return;
+    }
+    copyMetaData();
+    finish();
+}
+
+void EnginioScheduledReply::finish()
+{
+    setFinished(true);
+    emit finished();
+    // the shared network manager did not create this reply, so it is completed directly
+    _client->replyFinished(this);
+}
+
+void EnginioScheduledReply::abort()
+{
+    if (_reply) {
+        // an aborted attempt is not repeated
+        _retryable = false;
+        _retrying = false;
+        _reply->abort();
+        return;
+    }
+    if (isFinished())
+        return;
+    if (_retryTimer) {
+        killTimer(_retryTimer);
+        _retryTimer = 0;
+    }
+
+    // the request was never sent, the request queue drops finished replies
+    setError(OperationCanceledError, QStringLiteral("Operation canceled"));
+    emit error(OperationCanceledError);
+    finish();
+}
+
+bool EnginioScheduledReply::isSequential() const
+{
+    return true;
+}
+
+qint64 EnginioScheduledReply::bytesAvailable() const
+{
+    return QNetworkReply::bytesAvailable() + (_reply ? _reply->bytesAvailable() : 0);
+}
+
+qint64 EnginioScheduledReply::readData(char *dest, qint64 n)
+{
+    if (!_reply)
+        return isFinished() ? -1 : 0;
+    return _reply->read(dest, n);
+}
+
+qint64 EnginioScheduledReply::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
@@ -0,0 +1,109 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+
+#ifndef ENGINIOSCHEDULEDREPLY_P_H
+#define ENGINIOSCHEDULEDREPLY_P_H
+
+#include "enginioclient_global.h"
+
+#include <QtNetwork/qnetworkaccessmanager.h>
+#include <QtNetwork/qnetworkreply.h>
+#include <QtNetwork/qnetworkrequest.h>
+#include <QtCore/qbytearray.h>
+
+class EnginioClientPrivate;
+class QHttpMultiPart;
+
+/*
+ * Stands in for a request which is waiting in the EnginioClientPrivate request queue.
+ * Once the request is sent, the state of the real reply is forwarded, so the scheduled
+ * reply can be used everywhere a QNetworkReply is expected. A retryable request is sent
+ * again after a transient failure and the failed attempt is never forwarded.
+ */
+class ENGINIOCLIENT_EXPORT EnginioScheduledReply : public QNetworkReply
+{
+    Q_OBJECT
+    enum { MaxRetryDelay = 10 * 60 * 1000 };
+    EnginioClientPrivate *_client;
+    QNetworkReply *_reply; // 0 until the request is sent
+    QByteArray _data;
+    QIODevice *_body;
+    QHttpMultiPart *_multiPart;
+    int _requestClass;
+    qint64 _transferSize;
+    int _attempts;
+    int _retryTimer;
+    bool _retryable;
+    bool _retrying; // the running attempt failed, nothing more is forwarded from it
+    bool _dataForwarded;
+
+public:
+    EnginioScheduledReply(EnginioClientPrivate *client, QNetworkAccessManager::Operation operation, const QNetworkRequest &request,
+                          const QByteArray &data, QIODevice *body, QHttpMultiPart *multiPart, int requestClass, qint64 transferSize);
+
+    QByteArray data() const Q_REQUIRED_RESULT { return _data; }
+    QIODevice *body() const Q_REQUIRED_RESULT { return _body; }
+    QHttpMultiPart *multiPart() const Q_REQUIRED_RESULT { return _multiPart; }
+    int requestClass() const Q_REQUIRED_RESULT { return _requestClass; }
+    qint64 transferSize() const Q_REQUIRED_RESULT { return _transferSize; }
+    QNetworkReply *networkReply() const Q_REQUIRED_RESULT { return _reply; }
+    void setNetworkReply(QNetworkReply *reply);
+    void setRetryable(bool retryable) { _retryable = retryable; }
+
+    virtual void abort() Q_DECL_OVERRIDE;
+    virtual bool isSequential() const Q_DECL_OVERRIDE;
+    virtual qint64 bytesAvailable() const Q_DECL_OVERRIDE;
+    virtual qint64 readData(char *dest, qint64 n) Q_DECL_OVERRIDE;
+    virtual qint64 writeData(const char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+
+protected:
+    virtual void timerEvent(QTimerEvent *event) Q_DECL_OVERRIDE;
+
+private:
+    bool canRetry() const Q_REQUIRED_RESULT;
+    void retry();
+    void copyMetaData();
+    void networkMetaDataChanged();
+    void networkReadyRead();
+    void networkDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void networkError(QNetworkReply::NetworkError code);
+    void networkFinished();
+    void finish();
+};
+
+#endif // ENGINIOSCHEDULEDREPLY_P_H
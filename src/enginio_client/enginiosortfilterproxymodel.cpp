@@ -0,0 +1,520 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#include "enginiosortfilterproxymodel.h"
+
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qjsonvalue.h>
+#include <QtCore/qvector.h>
+
+/*!
+  \brief Keeps the sort keys of the source rows of EnginioSortFilterProxyModel.
+
+  The keys are extracted once and updated incrementally from the signals of the source
+  model, so that placing an inserted or changed row is a binary search over cached
+  values and re-sorting does not touch the source model at all.
+
+  The connections to the source model are made before QSortFilterProxyModel makes its
+  own, so the keys are always up to date when the proxy compares rows.
+  \internal
+*/
+class EnginioSortFilterProxyModelPrivate {
+    EnginioSortFilterProxyModel *q;
+    QAbstractItemModel *_source;
+    QVector<QMetaObject::Connection> _connections;
+
+    QString _sortProperty;
+    QVector<QJsonValue> _keys; // indexed by source row, empty if there is no sortProperty
+
+    QString _filterProperty;
+    QVariant _filterValue;
+
+    class SourceRowsInserted
+    {
+        EnginioSortFilterProxyModelPrivate *model;
+    public:
+        SourceRowsInserted(EnginioSortFilterProxyModelPrivate *m)
+            : model(m)
+        {
+            Q_ASSERT(m);
+        }
+
+        void operator ()(const QModelIndex &parent, int first, int last)
+        {
+            if (parent.isValid() || !model->isSorting())
+                return;
+            model->_keys.insert(first, last - first + 1, QJsonValue());
+            model->updateKeys(first, last);
+        }
+    };
+
+    class SourceRowsRemoved
+    {
+        EnginioSortFilterProxyModelPrivate *model;
+    public:
+        SourceRowsRemoved(EnginioSortFilterProxyModelPrivate *m)
+            : model(m)
+        {
+            Q_ASSERT(m);
+        }
+
+        void operator ()(const QModelIndex &parent, int first, int last)
+        {
+            if (parent.isValid() || !model->isSorting())
+                return;
+            model->_keys.remove(first, last - first + 1);
+        }
+    };
+
+    class SourceDataChanged
+    {
+        EnginioSortFilterProxyModelPrivate *model;
+    public:
+        SourceDataChanged(EnginioSortFilterProxyModelPrivate *m)
+            : model(m)
+        {
+            Q_ASSERT(m);
+        }
+
+        void operator ()(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &)
+        {
+            if (topLeft.parent().isValid() || !model->isSorting())
+                return;
+            model->updateKeys(topLeft.row(), bottomRight.row());
+        }
+    };
+
+    class SourceReset
+    {
+        EnginioSortFilterProxyModelPrivate *model;
+    public:
+        SourceReset(EnginioSortFilterProxyModelPrivate *m)
+            : model(m)
+        {
+            Q_ASSERT(m);
+        }
+
+        void operator ()()
+        {
+            model->rebuildKeys();
+        }
+
+        void operator ()(const QList<QPersistentModelIndex> &, QAbstractItemModel::LayoutChangeHint)
+        {
+            model->rebuildKeys();
+        }
+
+        void operator ()(const QModelIndex &, int, int, const QModelIndex &, int)
+        {
+            model->rebuildKeys();
+        }
+    };
+
+    class SourceDestroyed
+    {
+        EnginioSortFilterProxyModelPrivate *model;
+    public:
+        SourceDestroyed(EnginioSortFilterProxyModelPrivate *m)
+            : model(m)
+        {
+            Q_ASSERT(m);
+        }
+
+        void operator ()()
+        {
+            model->_source = 0;
+            model->_connections.clear();
+            model->_keys.clear();
+        }
+    };
+
+    static int typeRank(QJsonValue::Type type) Q_REQUIRED_RESULT
+    {
+        switch (type) {
+        case QJsonValue::Bool: return 1;
+        case QJsonValue::Double: return 2;
+        case QJsonValue::String: return 3;
+        case QJsonValue::Array: return 4;
+        case QJsonValue::Object: return 5;
+        default: return 0; // Null and Undefined, a missing property sorts first
+        }
+    }
+
+public:
+    EnginioSortFilterProxyModelPrivate(EnginioSortFilterProxyModel *q_ptr)
+        : q(q_ptr)
+        , _source()
+    {}
+
+    ~EnginioSortFilterProxyModelPrivate()
+    {
+        foreach (const QMetaObject::Connection &connection, _connections)
+            QObject::disconnect(connection);
+    }
+
+    void setSourceModel(QAbstractItemModel *source)
+    {
+        foreach (const QMetaObject::Connection &connection, _connections)
+            QObject::disconnect(connection);
+        _connections.clear();
+        _source = source;
+        if (_source) {
+            _connections.append(QObject::connect(_source, &QAbstractItemModel::rowsInserted, SourceRowsInserted(this)));
+            _connections.append(QObject::connect(_source, &QAbstractItemModel::rowsRemoved, SourceRowsRemoved(this)));
+            _connections.append(QObject::connect(_source, &QAbstractItemModel::dataChanged, SourceDataChanged(this)));
+            _connections.append(QObject::connect(_source, &QAbstractItemModel::modelReset, SourceReset(this)));
+            _connections.append(QObject::connect(_source, &QAbstractItemModel::layoutChanged, SourceReset(this)));
+            _connections.append(QObject::connect(_source, &QAbstractItemModel::rowsMoved, SourceReset(this)));
+            _connections.append(QObject::connect(_source, &QObject::destroyed, SourceDestroyed(this)));
+        }
+        rebuildKeys();
+    }
+
+    bool isSorting() const Q_REQUIRED_RESULT
+    {
+        return _source && !_sortProperty.isEmpty();
+    }
+
+    QString sortProperty() const Q_REQUIRED_RESULT
+    {
+        return _sortProperty;
+    }
+
+    void setSortProperty(const QString &property)
+    {
+        _sortProperty = property;
+        rebuildKeys();
+    }
+
+    QString filterProperty() const Q_REQUIRED_RESULT
+    {
+        return _filterProperty;
+    }
+
+    void setFilterProperty(const QString &property)
+    {
+        _filterProperty = property;
+    }
+
+    QVariant filterValue() const Q_REQUIRED_RESULT
+    {
+        return _filterValue;
+    }
+
+    void setFilterValue(const QVariant &value)
+    {
+        _filterValue = value;
+    }
+
+    QJsonValue value(int row, const QString &property) const Q_REQUIRED_RESULT
+    {
+        Q_ASSERT(_source);
+        const QJsonObject object = _source->index(row, 0).data(Qt::DisplayRole).toJsonValue().toObject();
+        return object[property];
+    }
+
+    void rebuildKeys()
+    {
+        _keys.clear();
+        if (!isSorting())
+            return;
+        _keys.resize(_source->rowCount());
+        updateKeys(0, _keys.count() - 1);
+    }
+
+    void updateKeys(int first, int last)
+    {
+        Q_ASSERT(last < _keys.count());
+        for (int row = first; row <= last; ++row)
+            _keys[row] = value(row, _sortProperty);
+    }
+
+    int compare(int leftRow, int rightRow) const Q_REQUIRED_RESULT
+    {
+        Q_ASSERT(leftRow < _keys.count() && rightRow < _keys.count());
+        const QJsonValue &left = _keys.at(leftRow);
+        const QJsonValue &right = _keys.at(rightRow);
+        if (left.type() != right.type())
+            return typeRank(left.type()) - typeRank(right.type());
+
+        switch (left.type()) {
+        case QJsonValue::Bool:
+            return int(left.toBool()) - int(right.toBool());
+        case QJsonValue::Double: {
+            const double l = left.toDouble();
+            const double r = right.toDouble();
+            return l < r ? -1 : (r < l ? 1 : 0);
+        }
+        case QJsonValue::String:
+            if (q->isSortLocaleAware())
+                return QString::localeAwareCompare(left.toString(), right.toString());
+            return QString::compare(left.toString(), right.toString(), q->sortCaseSensitivity());
+        default:
+            return 0;
+        }
+    }
+
+    bool filterAcceptsRow(int row) const Q_REQUIRED_RESULT
+    {
+        const QJsonValue property = value(row, _filterProperty);
+        if (_filterValue.isValid())
+            return property == QJsonValue::fromVariant(_filterValue);
+        return property.toVariant().toString().contains(q->filterRegExp());
+    }
+};
+
+
+/*!
+  \class EnginioSortFilterProxyModel
+  \inmodule enginio-qt
+  \ingroup enginio-client
+  \target EnginioSortFilterProxyModelCpp
+  \brief EnginioSortFilterProxyModel sorts and filters an EnginioModel on the client side.
+
+  The proxy compares the properties of the objects directly, so there is no need to
+  re-run the query to get the data in a different order:
+
+  \code
+    EnginioSortFilterProxyModel *proxy = new EnginioSortFilterProxyModel(this);
+    proxy->setSourceModel(model);
+    proxy->setSortProperty("population");
+    proxy->setSortOrder(Qt::DescendingOrder);
+  \endcode
+
+  The sort keys are cached and kept up to date when the source model changes, an object
+  appended to or updated in the source model is placed by a binary search, without
+  sorting the whole model again.
+
+  Any model that returns the objects as QJsonObject for Qt::DisplayRole, as EnginioModel
+  does, can be used as the source model.
+
+  For the QML version of this class see \l {Enginio1::EnginioSortFilterProxyModel}{EnginioSortFilterProxyModel (QML)}
+*/
+
+/*!
+  \qmltype EnginioSortFilterProxyModel
+  \instantiates EnginioSortFilterProxyModel
+  \inqmlmodule Enginio 1
+  \ingroup engino-qml
+
+  \brief Sorts and filters an EnginioModel without querying the backend again
+
+  \code
+    EnginioSortFilterProxyModel {
+        model: enginioModel
+        sortProperty: "name"
+        filterProperty: "country"
+        filterValue: "Finland"
+    }
+  \endcode
+
+  The QML version of EnginioSortFilterProxyModel supports the same functionality as the C++ version.
+  \l {EnginioSortFilterProxyModelCpp}{EnginioSortFilterProxyModel C++}
+*/
+
+/*!
+  \qmlproperty QAbstractItemModel Enginio1::EnginioSortFilterProxyModel::model
+  The model which is sorted and filtered, usually an EnginioModel.
+*/
+
+/*!
+  \qmlproperty string Enginio1::EnginioSortFilterProxyModel::sortProperty
+  The property of the objects by which the model is sorted, the source order is kept if it is empty.
+*/
+
+/*!
+  \qmlproperty enumeration Enginio1::EnginioSortFilterProxyModel::sortOrder
+  Qt.AscendingOrder or Qt.DescendingOrder.
+*/
+
+/*!
+  \qmlproperty string Enginio1::EnginioSortFilterProxyModel::filterProperty
+  The property of the objects which is matched against \l filterValue.
+*/
+
+/*!
+  \qmlproperty variant Enginio1::EnginioSortFilterProxyModel::filterValue
+  Only the objects which have this value in \l filterProperty are accepted.
+*/
+
+/*!
+    Constructs a new proxy model with \a parent as QObject parent.
+*/
+EnginioSortFilterProxyModel::EnginioSortFilterProxyModel(QObject *parent)
+    : QSortFilterProxyModel(parent)
+    , d(new EnginioSortFilterProxyModelPrivate(this))
+{
+    setDynamicSortFilter(true);
+}
+
+/*!
+    Destroys the proxy model.
+*/
+EnginioSortFilterProxyModel::~EnginioSortFilterProxyModel()
+{}
+
+/*!
+  \property EnginioSortFilterProxyModel::model
+  \brief The model which is sorted and filtered.
+  \sa QSortFilterProxyModel::setSourceModel()
+*/
+
+/*!
+    \overload
+    Sets \a sourceModel as the model which is sorted and filtered.
+*/
+void EnginioSortFilterProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    if (sourceModel == this->sourceModel())
+        return;
+    // The keys have to be updated before QSortFilterProxyModel reacts
+    // to a change, so we connect to the source model first.
+    d->setSourceModel(sourceModel);
+    QSortFilterProxyModel::setSourceModel(sourceModel);
+    emit modelChanged(sourceModel);
+}
+
+/*!
+  \property EnginioSortFilterProxyModel::sortProperty
+  \brief The property of the objects by which the model is sorted.
+
+  If it is empty the rows are in the order of the source model.
+*/
+QString EnginioSortFilterProxyModel::sortProperty() const
+{
+    return d->sortProperty();
+}
+
+void EnginioSortFilterProxyModel::setSortProperty(const QString &property)
+{
+    if (property == d->sortProperty())
+        return;
+    d->setSortProperty(property);
+    if (property.isEmpty())
+        QSortFilterProxyModel::sort(-1, sortOrder());
+    else if (sortColumn() == 0)
+        invalidate();
+    else
+        QSortFilterProxyModel::sort(0, sortOrder());
+    emit sortPropertyChanged(property);
+}
+
+/*!
+  \property EnginioSortFilterProxyModel::sortOrder
+  \brief The order in which the objects are sorted by \l sortProperty.
+*/
+void EnginioSortFilterProxyModel::setSortOrder(Qt::SortOrder order)
+{
+    if (order == sortOrder())
+        return;
+    sort(d->sortProperty().isEmpty() ? -1 : 0, order);
+}
+
+/*!
+  \property EnginioSortFilterProxyModel::filterProperty
+  \brief The property of the objects which is used for filtering.
+
+  If \l filterValue is set only the objects that have that value are accepted,
+  otherwise the property is matched against QSortFilterProxyModel::filterRegExp.
+  If it is empty the default filtering of QSortFilterProxyModel is used.
+*/
+QString EnginioSortFilterProxyModel::filterProperty() const
+{
+    return d->filterProperty();
+}
+
+void EnginioSortFilterProxyModel::setFilterProperty(const QString &property)
+{
+    if (property == d->filterProperty())
+        return;
+    d->setFilterProperty(property);
+    invalidateFilter();
+    emit filterPropertyChanged(property);
+}
+
+/*!
+  \property EnginioSortFilterProxyModel::filterValue
+  \brief The value of \l filterProperty that the accepted objects have.
+*/
+QVariant EnginioSortFilterProxyModel::filterValue() const
+{
+    return d->filterValue();
+}
+
+void EnginioSortFilterProxyModel::setFilterValue(const QVariant &value)
+{
+    if (value == d->filterValue())
+        return;
+    d->setFilterValue(value);
+    invalidateFilter();
+    emit filterValueChanged(value);
+}
+
+/*!
+    \overload
+    Sorts the model by \l sortProperty in the given \a order, \a column
+    is the first column or -1 to restore the order of the source model.
+*/
+void EnginioSortFilterProxyModel::sort(int column, Qt::SortOrder order)
+{
+    const Qt::SortOrder previousOrder = sortOrder();
+    QSortFilterProxyModel::sort(column, order);
+    if (order != previousOrder)
+        emit sortOrderChanged(order);
+}
+
+/*!
+    \overload
+    \internal
+*/
+bool EnginioSortFilterProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
+{
+    if (!d->isSorting())
+        return QSortFilterProxyModel::lessThan(left, right);
+    return d->compare(left.row(), right.row()) < 0;
+}
+
+/*!
+    \overload
+    \internal
+*/
+bool EnginioSortFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    if (d->filterProperty().isEmpty() || sourceParent.isValid())
+        return QSortFilterProxyModel::filterAcceptsRow(sourceRow, sourceParent);
+    return d->filterAcceptsRow(sourceRow);
+}
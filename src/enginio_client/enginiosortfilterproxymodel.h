@@ -0,0 +1,92 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#ifndef ENGINIOSORTFILTERPROXYMODEL_H
+#define ENGINIOSORTFILTERPROXYMODEL_H
+
+#include <QtCore/qsortfilterproxymodel.h>
+#include <QtCore/qscopedpointer.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qvariant.h>
+
+#include "enginioclient_global.h"
+
+class EnginioSortFilterProxyModelPrivate;
+class ENGINIOCLIENT_EXPORT EnginioSortFilterProxyModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+public:
+    explicit EnginioSortFilterProxyModel(QObject *parent = 0);
+    ~EnginioSortFilterProxyModel();
+
+    Q_PROPERTY(QAbstractItemModel *model READ sourceModel WRITE setSourceModel NOTIFY modelChanged)
+    Q_PROPERTY(QString sortProperty READ sortProperty WRITE setSortProperty NOTIFY sortPropertyChanged)
+    Q_PROPERTY(Qt::SortOrder sortOrder READ sortOrder WRITE setSortOrder NOTIFY sortOrderChanged)
+    Q_PROPERTY(QString filterProperty READ filterProperty WRITE setFilterProperty NOTIFY filterPropertyChanged)
+    Q_PROPERTY(QVariant filterValue READ filterValue WRITE setFilterValue NOTIFY filterValueChanged)
+
+    virtual void setSourceModel(QAbstractItemModel *sourceModel) Q_DECL_OVERRIDE;
+
+    QString sortProperty() const Q_REQUIRED_RESULT;
+    void setSortProperty(const QString &property);
+    void setSortOrder(Qt::SortOrder order);
+
+    QString filterProperty() const Q_REQUIRED_RESULT;
+    void setFilterProperty(const QString &property);
+    QVariant filterValue() const Q_REQUIRED_RESULT;
+    void setFilterValue(const QVariant &value);
+
+    virtual void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) Q_DECL_OVERRIDE;
+
+Q_SIGNALS:
+    void modelChanged(QAbstractItemModel *model);
+    void sortPropertyChanged(const QString &property);
+    void sortOrderChanged(Qt::SortOrder order);
+    void filterPropertyChanged(const QString &property);
+    void filterValueChanged(const QVariant &value);
+
+protected:
+    virtual bool lessThan(const QModelIndex &left, const QModelIndex &right) const Q_DECL_OVERRIDE;
+    virtual bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const Q_DECL_OVERRIDE;
+
+private:
+    Q_DISABLE_COPY(EnginioSortFilterProxyModel)
+    QScopedPointer<EnginioSortFilterProxyModelPrivate> d;
+    friend class EnginioSortFilterProxyModelPrivate;
+};
+
+#endif // ENGINIOSORTFILTERPROXYMODEL_H
@@ -45,13 +45,17 @@
     F(_synced, "_synced")\
     F(access, "access")\
     F(apiEnginIo, "https://api.engin.io")\
+    F(asc, "asc")\
     F(authIdentity, "auth/identity")\
     F(complete, "complete")\
     F(count, "count")\
     F(createdAt, "createdAt")\
+    F(direction, "direction")\
     F(empty, "empty")\
     F(event, "event")\
+    F(expiresAt, "expiresAt")\
     F(expiringUrl, "expiringUrl")\
+    F(fields, "fields")\
     F(file, "file")\
     F(fileName, "fileName")\
     F(files, "files")\
@@ -72,15 +76,22 @@
     F(payload, "payload")\
     F(propertyName, "propertyName")\
     F(query, "query")\
+    F(queryGte, "$gte")\
+    F(queryType, "$type")\
+    F(queryValue, "$value")\
     F(results, "results")\
     F(search, "search")\
     F(session, "session")\
     F(sessionToken, "sessionToken")\
+    F(size, "size")\
     F(sort, "sort")\
+    F(sortBy, "sortBy")\
     F(status, "status")\
     F(targetFileProperty, "targetFileProperty")\
+    F(time, "time")\
     F(updatedAt, "updatedAt")\
     F(url, "url")\
+    F(user, "user")\
     F(usergroups, "usergroups")\
     F(username, "username")\
     F(users, "users")\
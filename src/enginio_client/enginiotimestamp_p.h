@@ -0,0 +1,133 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#ifndef ENGINIOTIMESTAMP_P_H
+#define ENGINIOTIMESTAMP_P_H
+
+#include "enginioclient_global.h"
+#include <QtCore/qdatetime.h>
+#include <QtCore/qjsonvalue.h>
+#include <QtCore/qstring.h>
+
+/*!
+  \brief The EnginioTimestamp class converts backend timestamps to milliseconds since the epoch
+
+  The backend formats createdAt and updatedAt as "2013-05-29T11:51:04.123Z". The format is
+  parsed directly, which is much cheaper than QDateTime::fromString, so that timestamps can be
+  converted once when objects are received and then compared as integers. Other ISO 8601
+  strings are parsed by QDateTime.
+
+  \internal
+*/
+class ENGINIOCLIENT_EXPORT EnginioTimestamp
+{
+public:
+    static const qint64 Invalid = Q_INT64_C(-9223372036854775807) - 1;
+
+    static qint64 fromJson(const QJsonValue &value)
+    {
+        return fromString(value.toString());
+    }
+
+    static qint64 fromString(const QString &string)
+    {
+        const int size = string.size();
+        const QChar *s = string.constData();
+        if (size < 20 || s[4] != QLatin1Char('-') || s[7] != QLatin1Char('-') || s[10] != QLatin1Char('T')
+                || s[13] != QLatin1Char(':') || s[16] != QLatin1Char(':') || s[size - 1] != QLatin1Char('Z'))
+            return fromIsoDate(string);
+
+        bool ok = true;
+        const int year = digits(s, 4, &ok);
+        const int month = digits(s + 5, 2, &ok);
+        const int day = digits(s + 8, 2, &ok);
+        const int hour = digits(s + 11, 2, &ok);
+        const int minute = digits(s + 14, 2, &ok);
+        const int second = digits(s + 17, 2, &ok);
+        int msecs = 0;
+        int i = 19;
+        if (s[i] == QLatin1Char('.')) {
+            for (int scale = 100; ++i < size - 1; scale /= 10) {
+                const int digit = s[i].unicode() - '0';
+                if (digit < 0 || digit > 9)
+                    return fromIsoDate(string);
+                msecs += digit * scale;
+            }
+        }
+        if (!ok || i != size - 1 || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+            return fromIsoDate(string);
+
+        return ((daysSinceEpoch(year, month, day) * 24 + hour) * 60 + minute) * Q_INT64_C(60000) + second * 1000 + msecs;
+    }
+
+    static QString toString(qint64 msecs)
+    {
+        return QDateTime::fromMSecsSinceEpoch(msecs).toUTC().toString(QStringLiteral("yyyy-MM-dd'T'HH:mm:ss.zzz'Z'"));
+    }
+
+private:
+    static int digits(const QChar *s, int count, bool *ok)
+    {
+        int value = 0;
+        for (int i = 0; i < count; ++i) {
+            const int digit = s[i].unicode() - '0';
+            if (digit < 0 || digit > 9)
+                *ok = false;
+            value = value * 10 + digit;
+        }
+        return value;
+    }
+
+    static qint64 daysSinceEpoch(int year, int month, int day)
+    {
+        // days from the civil calendar date, counted from 1970-01-01
+        year -= month <= 2;
+        const int era = (year >= 0 ? year : year - 399) / 400;
+        const int yearOfEra = year - era * 400;
+        const int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return qint64(era) * 146097 + dayOfEra - 719468;
+    }
+
+    static qint64 fromIsoDate(const QString &string)
+    {
+        const QDateTime dateTime = QDateTime::fromString(string, Qt::ISODate);
+        return dateTime.isValid() ? dateTime.toMSecsSinceEpoch() : Invalid;
+    }
+};
+
+#endif // ENGINIOTIMESTAMP_P_H
@@ -39,9 +39,11 @@
 #include "enginioqmlclient.h"
 #include "enginioqmlmodel.h"
 #include "enginiomodel.h"
+#include "enginiosortfilterproxymodel.h"
 #include "enginioreply.h"
 #include "enginioqmlreply.h"
 #include "enginioidentity.h"
+#include "enginiometrics.h"
 #include <Enginio/private/enginioclient_p.h>
 
 #include <qqml.h>
@@ -86,8 +88,10 @@ void EnginioPlugin::registerTypes(const char *uri)
     qmlRegisterType<EnginioQmlClient>(uri, 1, 0, "Enginio");
     qmlRegisterUncreatableType<EnginioClient>(uri, 1, 0, "__Enginio", "__Enginio should not be instantiated from QML directly.");
     qmlRegisterType<EnginioQmlModel>(uri, 1, 0, "EnginioModel");
+    qmlRegisterType<EnginioSortFilterProxyModel>(uri, 1, 0, "EnginioSortFilterProxyModel");
     qmlRegisterUncreatableType<EnginioReply>(uri, 1, 0, "__EnginioReply", "__EnginioReply cannot be instantiated.");
     qmlRegisterUncreatableType<EnginioQmlReply>(uri, 1, 0, "EnginioReply", "EnginioReply cannot be instantiated.");
     qmlRegisterUncreatableType<EnginioIdentity>(uri, 1, 0, "EnginioIdentity", "EnginioIdentity can not be instantiated directly");
     qmlRegisterType<EnginioBasicAuthentication>(uri, 1, 0, "EnginioBasicAuthentication");
+    qmlRegisterUncreatableType<EnginioMetrics>(uri, 1, 0, "EnginioMetrics", "EnginioMetrics is a part of the Enginio client.");
 }
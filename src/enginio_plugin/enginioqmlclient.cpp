@@ -86,6 +86,87 @@
   Usually there is no need to change the default URL.
 */
 
+/*!
+  \qmlproperty int Enginio1::Enginio::maxAttempts
+  How many times a request is sent before its failure is reported.
+  Only transient failures, like a lost connection, cause another attempt.
+  The default value is 1.
+*/
+
+/*!
+  \qmlproperty int Enginio1::Enginio::retryDelay
+  The delay in milliseconds before a failed request is sent again. It is doubled
+  for every next attempt.
+*/
+
+/*!
+  \qmlproperty EnginioClient::RetryPolicy Enginio1::Enginio::retryPolicy
+  Which requests are sent again after a transient failure.
+  By default only queries, updates, removals and downloads are repeated.
+*/
+
+/*!
+  \qmlproperty int Enginio1::Enginio::requestTimeout
+  The time in milliseconds a request may take before it is aborted with
+  the TimeoutError error type. The default value 0 means no timeout.
+*/
+
+/*!
+  \qmlproperty int Enginio1::Enginio::maxQueryUrlSize
+  The url length in bytes above which a query is sent as a POST with its parameters
+  in the body and the \c{X-HTTP-Method-Override: GET} header. The backend must support
+  the method override. The default value 0 means that queries are always sent in the url.
+*/
+
+/*!
+  \qmlproperty int Enginio1::Enginio::compressionThreshold
+  The size in bytes from which the JSON request bodies are sent gzip compressed.
+  The default value 0 means no compression.
+*/
+
+/*!
+  \qmlproperty int Enginio1::Enginio::downloadSegmentSize
+  The size in bytes of the ranges in which the content of a downloaded file
+  is requested. The default value is 4 MiB.
+*/
+
+/*!
+  \qmlproperty int Enginio1::Enginio::downloadSegmentCount
+  How many ranges of a downloaded file are requested at the same time.
+  The default value is 4.
+*/
+
+/*!
+  \qmlproperty EnginioMetrics Enginio1::Enginio::metrics
+  The request counters, latencies and traces of this client, collected
+  once \c{metrics.enabled} is set.
+*/
+
+/*!
+  \qmlmethod void Enginio1::Enginio::setMaxRunningRequests(RequestClass requestClass, int count)
+  Limits the requests of the \a requestClass running at the same time to \a count.
+  The value 0 means no limit. By default up to two \c{Enginio.BackgroundRequests}
+  and three \c{Enginio.BulkRequests}, the file upload chunks and download segments,
+  run at the same time, while \c{Enginio.InteractiveRequests} are not limited.
+  A request is sent only when no request of a more important class is waiting.
+*/
+
+/*!
+  \qmlmethod int Enginio1::Enginio::maxRunningRequests(RequestClass requestClass)
+  Returns how many requests of the \a requestClass may run at the same time.
+*/
+
+/*!
+  \qmlmethod void Enginio1::Enginio::setMaxBytesPerSecond(RequestClass requestClass, int bytes)
+  Limits the data transferred by the requests of the \a requestClass to \a bytes
+  per second by delaying their start. The default value 0 means no limit.
+*/
+
+/*!
+  \qmlmethod int Enginio1::Enginio::maxBytesPerSecond(RequestClass requestClass)
+  Returns the byte rate the requests of the \a requestClass are limited to.
+*/
+
 /*!
   \qmlmethod EnginioReply Enginio1::Enginio::search(QJsonObject query)
   \brief Perform a full text search on the database
@@ -95,6 +176,12 @@
   \qmlmethod EnginioReply Enginio1::Enginio::query(QJsonObject query, Operation operation)
   \brief Query the database.
 */
+/*!
+  \qmlmethod EnginioReply Enginio1::Enginio::count(QJsonObject query, Operation operation)
+  \brief Count the objects matching the query, without fetching them.
+
+  The number is the \c count property of the reply data.
+*/
 /*!
   \qmlmethod EnginioReply Enginio1::Enginio::create(QJsonObject query, Operation operation)
   \brief Create an object in the database.
@@ -129,6 +216,17 @@
   \sa downloadFile()
 */
 
+/*!
+  \qmlmethod EnginioReply Enginio1::Enginio::createWithFile(QJsonObject object, string propertyName, QUrl file, Operation operation)
+  \brief Creates an \a object and stores a \a file attached to it in Enginio
+
+  The upload starts as soon as the object is created. When the reply
+  finishes, its data contains the created object with \a propertyName
+  set to the uploaded file.
+
+  \sa uploadFile()
+*/
+
 /*!
   \qmlmethod EnginioReply Enginio1::Enginio::downloadFile(QJsonObject object)
   \brief Get the download URL for a file
@@ -182,6 +280,17 @@ EnginioQmlReply *EnginioQmlClient::query(const QJSValue &query, const Operation
     return ereply;
 }
 
+EnginioQmlReply *EnginioQmlClient::count(const QJSValue &query, const Operation operation)
+{
+    Q_D(EnginioQmlClient);
+
+    d->setEngine(query);
+    ObjectAdaptor<QJSValue> o(query, d);
+    QNetworkReply *nreply = d_ptr->count<QJSValue>(o, static_cast<EnginioClientPrivate::Operation>(operation));
+    EnginioQmlReply *ereply = new EnginioQmlReply(d, nreply);
+    return ereply;
+}
+
 EnginioQmlReply *EnginioQmlClient::create(const QJSValue &object, const Operation operation)
 {
     Q_D(EnginioQmlClient);
@@ -257,6 +366,21 @@ EnginioQmlReply *EnginioQmlClient::uploadFile(const QJSValue &object, const QUrl
     return ereply;
 }
 
+EnginioQmlReply *EnginioQmlClient::createWithFile(const QJSValue &object, const QString &propertyName, const QUrl &url, const Operation operation)
+{
+    Q_D(EnginioQmlClient);
+
+    if (!object.isObject())
+        return 0;
+
+    d->setEngine(object);
+    ObjectAdaptor<QJSValue> o(object, d);
+    QNetworkReply *nreply = d_ptr->createWithFile<QJSValue>(o, propertyName, url, operation);
+    EnginioQmlReply *ereply = new EnginioQmlReply(d, nreply);
+
+    return ereply;
+}
+
 QByteArray EnginioQmlClientPrivate::toJson(const QJSValue &value)
 {
     if (!_stringify.isCallable())
@@ -53,18 +53,22 @@ public:
     EnginioQmlClient(QObject *parent = 0);
 
     using EnginioClient::query;
+    using EnginioClient::count;
     using EnginioClient::create;
     using EnginioClient::update;
     using EnginioClient::remove;
     using EnginioClient::downloadFile;
     using EnginioClient::uploadFile;
+    using EnginioClient::createWithFile;
 
     Q_INVOKABLE EnginioQmlReply *query(const QJSValue &query, const Operation operation = ObjectOperation);
+    Q_INVOKABLE EnginioQmlReply *count(const QJSValue &query, const Operation operation = ObjectOperation);
     Q_INVOKABLE EnginioQmlReply *create(const QJSValue &object, const Operation operation = ObjectOperation);
     Q_INVOKABLE EnginioQmlReply *update(const QJSValue &object, const Operation operation = ObjectOperation);
     Q_INVOKABLE EnginioQmlReply *remove(const QJSValue &object, const Operation operation = ObjectOperation);
     Q_INVOKABLE EnginioQmlReply *downloadFile(const QJSValue &object);
     Q_INVOKABLE EnginioQmlReply *uploadFile(const QJSValue &object, const QUrl &url);
+    Q_INVOKABLE EnginioQmlReply *createWithFile(const QJSValue &object, const QString &propertyName, const QUrl &url, const Operation operation = ObjectOperation);
 
 private:
     Q_DECLARE_PRIVATE(EnginioQmlClient);
@@ -37,6 +37,9 @@
 
 #include "enginioqmlmodel.h"
 
+#include <QtCore/qdebug.h>
+#include <QtQml/qjsengine.h>
+
 /*!
   \qmltype EnginioModel
   \instantiates EnginioQmlModel
@@ -80,6 +83,74 @@
   The operation used for the \l query.
 */
 
+/*!
+  \qmlproperty string Enginio1::EnginioModel::journalFile
+  The file in which changes are journaled, so that they are not lost without connectivity.
+  Setting it enables the offline mode, see \l {EnginioModel::journalFile}{EnginioModel C++}
+  for the details.
+*/
+
+/*!
+  \qmlproperty bool Enginio1::EnginioModel::offline
+  True if the backend could not be reached and journaled changes wait for connectivity.
+*/
+
+/*!
+  \qmlproperty string Enginio1::EnginioModel::snapshotDirectory
+  The directory in which the model keeps snapshots of its data, so that it can
+  be populated immediately after the application is started.
+*/
+
+/*!
+  \qmlproperty bool Enginio1::EnginioModel::deltaSync
+  If true, \l refresh() fetches only the objects updated since the last fetch.
+*/
+
+/*!
+  \qmlproperty enumeration Enginio1::EnginioModel::conflictPolicy
+  How local changes are reconciled with objects changed or removed on the backend:
+  \list
+  \li EnginioModel.ServerWins - the backend version replaces local changes, the default
+  \li EnginioModel.LastWriterWins - the newer change is kept
+  \li EnginioModel.MergeProperties - locally changed properties keep their local values
+  \li EnginioModel.CustomPolicy - the \l conflictResolver function decides
+  \endlist
+*/
+
+/*!
+  \qmlproperty function Enginio1::EnginioModel::conflictResolver
+  The function resolving conflicts if the \l conflictPolicy is \c EnginioModel.CustomPolicy.
+  It is called with the local object, the object from the backend, which is empty if the
+  object was removed from the backend, and the list of locally changed properties. The
+  returned object is shown in the model, returning nothing removes the row.
+
+  \code
+    conflictPolicy: EnginioModel.CustomPolicy
+    conflictResolver: function(local, server, properties) {
+        if (server.id === undefined)
+            return local // keep the objects removed from the backend
+        server.title = local.title
+        return server
+    }
+  \endcode
+*/
+
+/*!
+  \qmlproperty int Enginio1::EnginioModel::totalCount
+  The number of objects on the backend matching the query, also with pagination,
+  or -1 while it is not known.
+*/
+
+/*!
+  \qmlmethod void Enginio1::EnginioModel::refresh()
+  \brief Fetch the query again, only the changed objects if deltaSync is set
+*/
+
+/*!
+  \qmlmethod void Enginio1::EnginioModel::synchronize()
+  \brief Send the journaled changes now
+*/
+
 /*!
   \qmlmethod EnginioReply Enginio1::EnginioModel::append(QJsonObject value)
   \brief Add a new object to the model and database.
@@ -110,3 +181,32 @@ EnginioQmlModel::EnginioQmlModel(QObject *parent)
     : EnginioModel(parent)
 {
 }
+
+QJSValue EnginioQmlModel::conflictResolver() const
+{
+    return _conflictResolver;
+}
+
+void EnginioQmlModel::setConflictResolver(const QJSValue &resolver)
+{
+    _conflictResolver = resolver;
+    emit conflictResolverChanged();
+}
+
+QJsonObject EnginioQmlModel::resolveConflict(const QJsonObject &local, const QJsonObject &server, const QStringList &properties)
+{
+    if (!_conflictResolver.isCallable())
+        return EnginioModel::resolveConflict(local, server, properties);
+
+    QJSEngine *engine = _conflictResolver.engine();
+    QJSValueList arguments;
+    arguments << engine->toScriptValue(local.toVariantMap())
+              << engine->toScriptValue(server.toVariantMap())
+              << engine->toScriptValue(properties);
+    const QJSValue result = _conflictResolver.call(arguments);
+    if (result.isError()) {
+        qWarning() << "EnginioModel: conflictResolver failed:" << result.toString();
+        return EnginioModel::resolveConflict(local, server, properties);
+    }
+    return QJsonObject::fromVariantMap(result.toVariant().toMap());
+}
@@ -41,12 +41,27 @@
 #include "enginiomodel.h"
 #include "enginioqmlclient.h"
 
+#include <QtQml/qjsvalue.h>
+
 class EnginioQmlModel : public EnginioModel
 {
     Q_OBJECT
     Q_DISABLE_COPY(EnginioQmlModel)
+    Q_PROPERTY(QJSValue conflictResolver READ conflictResolver WRITE setConflictResolver NOTIFY conflictResolverChanged)
 public:
     EnginioQmlModel(QObject *parent = 0);
+
+    QJSValue conflictResolver() const Q_REQUIRED_RESULT;
+    void setConflictResolver(const QJSValue &resolver);
+
+Q_SIGNALS:
+    void conflictResolverChanged();
+
+protected:
+    virtual QJsonObject resolveConflict(const QJsonObject &local, const QJsonObject &server, const QStringList &properties) Q_DECL_OVERRIDE;
+
+private:
+    QJSValue _conflictResolver;
 };
 
 #endif // ENGINIOQMLOBJECTMODEL_H
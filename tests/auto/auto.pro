@@ -4,6 +4,7 @@ SUBDIRS += \
     enginioclient \
     enginiomodel \
     files \
+    mockserver \
     notifications \
 
 qtHaveModule(quick) {
@@ -0,0 +1,1255 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#include "mockserver.h"
+
+#include <Enginio/private/enginioclient_p.h>
+
+#include <QtCore/qcryptographichash.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qjsondocument.h>
+#include <QtCore/qqueue.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qtendian.h>
+#include <QtCore/qtimer.h>
+#include <QtCore/quuid.h>
+#include <QtNetwork/qtcpsocket.h>
+
+namespace EnginioTests
+{
+
+namespace {
+
+enum WebSocketOpcode {
+    TextFrameOp = 0x1,
+    ConnectionCloseOp = 0x8,
+    PingOp = 0x9,
+    PongOp = 0xA
+};
+
+QString timestamp()
+{
+    return QDateTime::currentDateTimeUtc().toString(QStringLiteral("yyyy-MM-dd'T'HH:mm:ss.zzz'Z'"));
+}
+
+QByteArray reasonPhrase(int status)
+{
+    switch (status) {
+    case 101: return QByteArrayLiteral("Switching Protocols");
+    case 200: return QByteArrayLiteral("OK");
+    case 206: return QByteArrayLiteral("Partial Content");
+    case 400: return QByteArrayLiteral("Bad Request");
+    case 401: return QByteArrayLiteral("Unauthorized");
+    case 404: return QByteArrayLiteral("Not Found");
+    case 405: return QByteArrayLiteral("Method Not Allowed");
+    case 411: return QByteArrayLiteral("Length Required");
+    case 416: return QByteArrayLiteral("Requested Range Not Satisfiable");
+    case 501: return QByteArrayLiteral("Not Implemented");
+    default: return QByteArrayLiteral("Unknown");
+    }
+}
+
+EnginioMockServer::Response error(int status, const QString &message)
+{
+    QJsonObject description;
+    description[QStringLiteral("message")] = message;
+    description[QStringLiteral("reason")] = QString::fromLatin1(reasonPhrase(status));
+    QJsonArray errors;
+    errors.append(description);
+    QJsonObject response;
+    response[QStringLiteral("errors")] = errors;
+    return EnginioMockServer::Response(status, response);
+}
+
+// Returns false if the values can not be ordered
+bool compare(const QJsonValue &left, const QJsonValue &right, int *result)
+{
+    if (left.isDouble() && right.isDouble()) {
+        const double l = left.toDouble();
+        const double r = right.toDouble();
+        *result = l < r ? -1 : (r < l ? 1 : 0);
+        return true;
+    }
+    if (left.isString() && right.isString()) {
+        *result = QString::compare(left.toString(), right.toString());
+        return true;
+    }
+    return false;
+}
+
+bool matches(const QJsonValue &value, const QJsonValue &condition)
+{
+    const QJsonObject operators = condition.toObject();
+    if (operators.isEmpty() || !operators.constBegin().key().startsWith(QLatin1Char('$')))
+        return value == condition;
+
+    for (QJsonObject::const_iterator i = operators.constBegin(); i != operators.constEnd(); ++i) {
+        QJsonValue operand = i.value();
+        if (operand.toObject().contains(QStringLiteral("$value")))
+            operand = operand.toObject()[QStringLiteral("$value")]; // {"$type": "time", "$value": ...}
+
+        const QString op = i.key();
+        int result;
+        if (op == QStringLiteral("$ne")) {
+            if (value == operand)
+                return false;
+        } else if (op == QStringLiteral("$in")) {
+            if (!operand.toArray().contains(value))
+                return false;
+        } else if (!compare(value, operand, &result)) {
+            return false;
+        } else if ((op == QStringLiteral("$gt") && result <= 0)
+                   || (op == QStringLiteral("$gte") && result < 0)
+                   || (op == QStringLiteral("$lt") && result >= 0)
+                   || (op == QStringLiteral("$lte") && result > 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool matches(const QJsonObject &object, const QJsonObject &query)
+{
+    for (QJsonObject::const_iterator i = query.constBegin(); i != query.constEnd(); ++i) {
+        if (!matches(object[i.key()], i.value()))
+            return false;
+    }
+    return true;
+}
+
+class SortKeyLess
+{
+    QJsonArray _keys; // [{"sortBy": "name", "direction": "asc"}]
+public:
+    SortKeyLess(const QJsonArray &keys)
+        : _keys(keys)
+    {}
+
+    bool operator ()(const QJsonObject &left, const QJsonObject &right) const
+    {
+        foreach (const QJsonValue &key, _keys) {
+            const QString property = key.toObject()[QStringLiteral("sortBy")].toString();
+            int result;
+            if (!compare(left[property], right[property], &result) || !result)
+                continue;
+            if (key.toObject()[QStringLiteral("direction")].toString() == QStringLiteral("desc"))
+                result = -result;
+            return result < 0;
+        }
+        return false;
+    }
+};
+
+QJsonObject parseJson(const QByteArray &data, bool *ok)
+{
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(data, &error);
+    *ok = error.error == QJsonParseError::NoError && document.isObject();
+    return document.object();
+}
+
+// A minimal RFC 1951 decoder after zlib's contrib/puff, enough for the request bodies
+class Inflater
+{
+    enum { MaxBits = 15, MaxLiteralCodes = 286, MaxDistanceCodes = 30, FixedLiteralCodes = 288 };
+
+    struct Huffman
+    {
+        short count[MaxBits + 1]; // the number of codes of each length
+        short symbol[FixedLiteralCodes]; // ordered by their codes
+    };
+
+    const uchar *_data;
+    int _size;
+    int _pos;
+    quint32 _bitBuffer;
+    int _bitCount;
+    bool _error;
+    QByteArray _out;
+
+    int bits(int count)
+    {
+        quint32 value = _bitBuffer;
+        while (_bitCount < count) {
+            if (_pos == _size) {
+                _error = true;
+                return 0;
+            }
+            value |= quint32(_data[_pos++]) << _bitCount;
+            _bitCount += 8;
+        }
+        _bitBuffer = value >> count;
+        _bitCount -= count;
+        return int(value & ((1u << count) - 1));
+    }
+
+    int decode(const Huffman &huffman)
+    {
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        for (int length = 1; length <= MaxBits; ++length) {
+            code |= bits(1);
+            if (_error)
+                return -1;
+            const int count = huffman.count[length];
+            if (code - count < first)
+                return huffman.symbol[index + (code - first)];
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+    static bool construct(Huffman *huffman, const short *lengths, int count)
+    {
+        for (int length = 0; length <= MaxBits; ++length)
+            huffman->count[length] = 0;
+        for (int symbol = 0; symbol < count; ++symbol)
+            ++huffman->count[lengths[symbol]];
+        int left = 1;
+        for (int length = 1; length <= MaxBits; ++length) {
+            left = (left << 1) - huffman->count[length];
+            if (left < 0)
+                return false; // over-subscribed
+        }
+        short offsets[MaxBits + 1];
+        offsets[1] = 0;
+        for (int length = 1; length < MaxBits; ++length)
+            offsets[length + 1] = offsets[length] + huffman->count[length];
+        for (int symbol = 0; symbol < count; ++symbol) {
+            if (lengths[symbol])
+                huffman->symbol[offsets[lengths[symbol]]++] = symbol;
+        }
+        return true;
+    }
+
+    bool stored()
+    {
+        _bitBuffer = 0;
+        _bitCount = 0;
+        if (_pos + 4 > _size)
+            return false;
+        const int length = _data[_pos] | (_data[_pos + 1] << 8);
+        const int complement = _data[_pos + 2] | (_data[_pos + 3] << 8);
+        _pos += 4;
+        if (length != (~complement & 0xffff) || _pos + length > _size)
+            return false;
+        _out.append(reinterpret_cast<const char *>(_data + _pos), length);
+        _pos += length;
+        return true;
+    }
+
+    bool codes(const Huffman &literalCode, const Huffman &distanceCode)
+    {
+        static const short lengthBase[29] = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const short lengthExtra[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const short distanceBase[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+        static const short distanceExtra[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+        forever {
+            int symbol = decode(literalCode);
+            if (symbol < 0)
+                return false;
+            if (symbol < 256) {
+                _out.append(char(symbol));
+                continue;
+            }
+            if (symbol == 256)
+                return true;
+            symbol -= 257;
+            if (symbol >= 29)
+                return false;
+            const int length = lengthBase[symbol] + bits(lengthExtra[symbol]);
+            symbol = decode(distanceCode);
+            if (symbol < 0 || symbol >= 30)
+                return false;
+            const int distance = distanceBase[symbol] + bits(distanceExtra[symbol]);
+            if (_error || distance > _out.size())
+                return false;
+            for (int i = 0; i < length; ++i)
+                _out.append(_out.at(_out.size() - distance));
+        }
+    }
+
+    bool fixed()
+    {
+        short lengths[FixedLiteralCodes];
+        int symbol = 0;
+        for (; symbol < 144; ++symbol)
+            lengths[symbol] = 8;
+        for (; symbol < 256; ++symbol)
+            lengths[symbol] = 9;
+        for (; symbol < 280; ++symbol)
+            lengths[symbol] = 7;
+        for (; symbol < FixedLiteralCodes; ++symbol)
+            lengths[symbol] = 8;
+        Huffman literalCode;
+        construct(&literalCode, lengths, FixedLiteralCodes);
+        for (symbol = 0; symbol < MaxDistanceCodes; ++symbol)
+            lengths[symbol] = 5;
+        Huffman distanceCode;
+        construct(&distanceCode, lengths, MaxDistanceCodes);
+        return codes(literalCode, distanceCode);
+    }
+
+    bool dynamic()
+    {
+        static const short order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+        const int literalCount = bits(5) + 257;
+        const int distanceCount = bits(5) + 1;
+        const int codeCount = bits(4) + 4;
+        if (_error || literalCount > MaxLiteralCodes || distanceCount > MaxDistanceCodes)
+            return false;
+
+        short lengths[MaxLiteralCodes + MaxDistanceCodes];
+        int index = 0;
+        for (; index < codeCount; ++index)
+            lengths[order[index]] = bits(3);
+        for (; index < 19; ++index)
+            lengths[order[index]] = 0;
+        Huffman literalCode;
+        if (_error || !construct(&literalCode, lengths, 19))
+            return false;
+
+        // the code lengths of the literal and distance codes, encoded with the code above
+        index = 0;
+        while (index < literalCount + distanceCount) {
+            const int symbol = decode(literalCode);
+            if (symbol < 0)
+                return false;
+            if (symbol < 16) {
+                lengths[index++] = symbol;
+                continue;
+            }
+            short length = 0;
+            int repeat;
+            if (symbol == 16) {
+                if (!index)
+                    return false;
+                length = lengths[index - 1];
+                repeat = 3 + bits(2);
+            } else if (symbol == 17) {
+                repeat = 3 + bits(3);
+            } else {
+                repeat = 11 + bits(7);
+            }
+            if (_error || index + repeat > literalCount + distanceCount)
+                return false;
+            while (repeat--)
+                lengths[index++] = length;
+        }
+        if (!lengths[256])
+            return false; // no end of block code
+
+        Huffman distanceCode;
+        if (!construct(&literalCode, lengths, literalCount) || !construct(&distanceCode, lengths + literalCount, distanceCount))
+            return false;
+        return codes(literalCode, distanceCode);
+    }
+
+public:
+    Inflater(const uchar *data, int size)
+        : _data(data)
+        , _size(size)
+        , _pos(0)
+        , _bitBuffer(0)
+        , _bitCount(0)
+        , _error(false)
+    {}
+
+    bool inflate(QByteArray *result)
+    {
+        int last;
+        do {
+            last = bits(1);
+            const int type = bits(2);
+            bool ok = !_error;
+            if (ok) {
+                switch (type) {
+                case 0: ok = stored(); break;
+                case 1: ok = fixed(); break;
+                case 2: ok = dynamic(); break;
+                default: ok = false;
+                }
+            }
+            if (!ok || _error)
+                return false;
+        } while (!last);
+        *result = _out;
+        return true;
+    }
+};
+
+// http://tools.ietf.org/html/rfc1952, the optional header fields are not supported.
+// qUncompress can not be used, a zlib stream would need the adler32 of the decoded data.
+bool gunzip(const QByteArray &data, QByteArray *result)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+    if (data.size() < 18 || bytes[0] != 0x1f || bytes[1] != 0x8b || bytes[2] != 8 || bytes[3] != 0)
+        return false;
+    Inflater inflater(bytes + 10, data.size() - 18);
+    return inflater.inflate(result)
+            && qFromLittleEndian<quint32>(bytes + data.size() - 8) == EnginioClientPrivate::crc32(*result)
+            && qFromLittleEndian<quint32>(bytes + data.size() - 4) == quint32(result->size());
+}
+
+} // namespace
+
+/*
+  One client connection of EnginioMockServer. HTTP requests are answered in order,
+  each after the configured latency and the time the request body needs at the
+  configured bandwidth, the responses are written at that bandwidth as well.
+  After a WebSocket handshake the connection carries notification frames.
+*/
+class EnginioMockConnection: public QObject
+{
+    enum { TickInterval = 10 }; // ms
+
+    struct PendingRequest
+    {
+        EnginioMockServer::Request request;
+        qint64 due;
+    };
+
+    EnginioMockServer *_server;
+    QTcpSocket *_socket;
+    QByteArray _input;
+    QByteArray _output;
+    QQueue<PendingRequest> _requests;
+    QTimer _requestTimer;
+    QTimer _writeTimer;
+    QElapsedTimer _clock;
+    bool _webSocket;
+
+public:
+    EnginioMockConnection(EnginioMockServer *server, qintptr socketDescriptor)
+        : _server(server)
+        , _socket(new QTcpSocket(this))
+        , _webSocket(false)
+    {
+        _clock.start();
+        _requestTimer.setSingleShot(true);
+        _writeTimer.setInterval(TickInterval);
+        connect(&_requestTimer, &QTimer::timeout, this, &EnginioMockConnection::processRequests);
+        connect(&_writeTimer, &QTimer::timeout, this, &EnginioMockConnection::writeData);
+        connect(_socket, &QTcpSocket::readyRead, this, &EnginioMockConnection::readyRead);
+        connect(_socket, &QTcpSocket::disconnected, this, &EnginioMockConnection::deleteLater);
+        _socket->setSocketDescriptor(socketDescriptor);
+    }
+
+    ~EnginioMockConnection()
+    {
+        _server->removeConnection(this);
+    }
+
+    void sendText(const QByteArray &message)
+    {
+        if (_socket->state() == QAbstractSocket::ConnectedState)
+            sendFrame(TextFrameOp, message);
+    }
+
+private:
+    qint64 transferTime(qint64 bytes) const
+    {
+        const qint64 bandwidth = _server->bandwidth();
+        return bandwidth ? bytes * 1000 / bandwidth : 0;
+    }
+
+    void readyRead()
+    {
+        _input.append(_socket->readAll());
+        if (_webSocket)
+            parseFrames();
+        else
+            while (parseRequest()) {}
+    }
+
+    bool parseRequest()
+    {
+        const int headerEnd = _input.indexOf("\r\n\r\n");
+        if (headerEnd == -1)
+            return false;
+
+        EnginioMockServer::Request request;
+        const QList<QByteArray> lines = _input.left(headerEnd).split('\n');
+        const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+        if (requestLine.count() != 3) {
+            _socket->abort();
+            return false;
+        }
+        for (int i = 1; i < lines.count(); ++i) {
+            const int colon = lines[i].indexOf(':');
+            if (colon > 0)
+                request.headers.insert(lines[i].left(colon).trimmed().toLower(), lines[i].mid(colon + 1).trimmed());
+        }
+
+        if (request.headers.contains("transfer-encoding")) {
+            respond(EnginioMockServer::Response(411));
+            _socket->disconnectFromHost();
+            return false;
+        }
+
+        const qint64 contentLength = request.headers.value("content-length").toLongLong();
+        const qint64 requestSize = headerEnd + 4 + contentLength;
+        if (_input.size() < requestSize)
+            return false;
+
+        request.method = requestLine[0];
+        const QByteArray target = requestLine[1];
+        const int queryStart = target.indexOf('?');
+        request.path = QUrl::fromPercentEncoding(target.left(queryStart));
+        if (queryStart != -1)
+            request.query.setQuery(QString::fromLatin1(target.mid(queryStart + 1)));
+        request.body = _input.mid(headerEnd + 4, contentLength);
+        _input.remove(0, requestSize);
+
+        PendingRequest pending;
+        pending.request = request;
+        pending.due = _clock.elapsed() + _server->latency() + transferTime(requestSize);
+        _requests.enqueue(pending);
+        scheduleRequests();
+        return !_webSocket;
+    }
+
+    void scheduleRequests()
+    {
+        if (!_requests.isEmpty() && !_requestTimer.isActive())
+            _requestTimer.start(qMax(Q_INT64_C(0), _requests.head().due - _clock.elapsed()));
+    }
+
+    void processRequests()
+    {
+        while (!_requests.isEmpty() && _requests.head().due <= _clock.elapsed()) {
+            const EnginioMockServer::Request request = _requests.dequeue().request;
+            if (request.headers.value("upgrade").toLower() == "websocket") {
+                upgrade(request);
+                return;
+            }
+            EnginioMockServer::Response response = _server->handle(request);
+            if (_server->compressResponses() && !response.body.isEmpty()
+                    && request.headers.value("accept-encoding").contains("gzip")) {
+                response.body = EnginioClientPrivate::gzip(response.body);
+                response.headers.append(qMakePair(QByteArrayLiteral("Content-Encoding"), QByteArrayLiteral("gzip")));
+            }
+            respond(response);
+        }
+        scheduleRequests();
+    }
+
+    void respond(const EnginioMockServer::Response &response)
+    {
+        QByteArray data = "HTTP/1.1 " + QByteArray::number(response.status) + ' ' + reasonPhrase(response.status) + "\r\n";
+        for (int i = 0; i < response.headers.count(); ++i)
+            data += response.headers[i].first + ": " + response.headers[i].second + "\r\n";
+        if (response.status != 101)
+            data += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+        data += "\r\n";
+        data += response.body;
+        write(data);
+    }
+
+    void upgrade(const EnginioMockServer::Request &request)
+    {
+        // http://tools.ietf.org/html/rfc6455#section-4.2.2
+        const QByteArray key = request.headers.value("sec-websocket-key") + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        EnginioMockServer::Response response(101);
+        response.headers.append(qMakePair(QByteArrayLiteral("Upgrade"), QByteArrayLiteral("websocket")));
+        response.headers.append(qMakePair(QByteArrayLiteral("Connection"), QByteArrayLiteral("Upgrade")));
+        response.headers.append(qMakePair(QByteArrayLiteral("Sec-WebSocket-Accept"), QCryptographicHash::hash(key, QCryptographicHash::Sha1).toBase64()));
+        respond(response);
+
+        _webSocket = true;
+        _requests.clear();
+        bool ok;
+        const QJsonObject filter = parseJson(request.query.queryItemValue(QStringLiteral("filter"), QUrl::FullyDecoded).toUtf8(), &ok);
+        _server->addStream(this, filter);
+        parseFrames();
+    }
+
+    void parseFrames()
+    {
+        // http://tools.ietf.org/html/rfc6455#section-5.2, the client frames are masked
+        forever {
+            if (_input.size() < 2)
+                return;
+            const uchar *header = reinterpret_cast<const uchar *>(_input.constData());
+            const int opcode = header[0] & 0x0F;
+            const bool masked = header[1] & 0x80;
+            quint64 length = header[1] & 0x7F;
+            int offset = 2;
+            if (length == 126) {
+                if (_input.size() < 4)
+                    return;
+                length = qFromBigEndian<quint16>(header + 2);
+                offset = 4;
+            } else if (length == 127) {
+                if (_input.size() < 10)
+                    return;
+                length = qFromBigEndian<quint64>(header + 2);
+                offset = 10;
+            }
+            const int maskOffset = offset;
+            if (masked)
+                offset += 4;
+            if (quint64(_input.size()) < offset + length)
+                return;
+
+            QByteArray payload = _input.mid(offset, int(length));
+            if (masked) {
+                for (int i = 0; i < payload.size(); ++i)
+                    payload[i] = char(payload[i] ^ _input.at(maskOffset + i % 4));
+            }
+            _input.remove(0, offset + int(length));
+
+            if (opcode == PingOp) {
+                sendFrame(PongOp, payload);
+            } else if (opcode == ConnectionCloseOp) {
+                sendFrame(ConnectionCloseOp, payload.left(2));
+                _socket->disconnectFromHost();
+                return;
+            }
+        }
+    }
+
+    void sendFrame(int opcode, const QByteArray &payload)
+    {
+        QByteArray frame;
+        frame.append(char(0x80 | opcode)); // FIN, server frames are not masked
+        if (payload.size() < 126) {
+            frame.append(char(payload.size()));
+        } else if (payload.size() <= 0xFFFF) {
+            frame.append(char(126));
+            uchar length[2];
+            qToBigEndian<quint16>(payload.size(), length);
+            frame.append(reinterpret_cast<char *>(length), 2);
+        } else {
+            frame.append(char(127));
+            uchar length[8];
+            qToBigEndian<quint64>(payload.size(), length);
+            frame.append(reinterpret_cast<char *>(length), 8);
+        }
+        frame.append(payload);
+        write(frame);
+    }
+
+    void write(const QByteArray &data)
+    {
+        _output.append(data);
+        if (!_writeTimer.isActive())
+            writeData();
+    }
+
+    void writeData()
+    {
+        const qint64 bandwidth = _server->bandwidth();
+        if (!bandwidth) {
+            _socket->write(_output);
+            _output.clear();
+        } else {
+            const int quota = int(qMax(Q_INT64_C(1), bandwidth * TickInterval / 1000));
+            _socket->write(_output.constData(), qMin(quota, _output.size()));
+            _output.remove(0, quota);
+        }
+        if (_output.isEmpty())
+            _writeTimer.stop();
+        else if (!_writeTimer.isActive())
+            _writeTimer.start();
+    }
+};
+
+EnginioMockServer::Response::Response(int status, const QByteArray &body)
+    : status(status)
+    , body(body)
+{}
+
+EnginioMockServer::Response::Response(int status, const QJsonObject &object)
+    : status(status)
+    , body(QJsonDocument(object).toJson(QJsonDocument::Compact))
+{
+    headers.append(qMakePair(QByteArrayLiteral("Content-Type"), QByteArrayLiteral("application/json")));
+}
+
+EnginioMockServer::EnginioMockServer(QObject *parent)
+    : QTcpServer(parent)
+    , _latency(0)
+    , _bandwidth(0)
+    , _compressResponses(false)
+    , _rangedResponses(-1)
+    , _requestCount(0)
+    , _nextId(0)
+{}
+
+EnginioMockServer::~EnginioMockServer()
+{
+    const QSet<EnginioMockConnection *> connections = _connections;
+    _connections.clear();
+    _streams.clear();
+    qDeleteAll(connections);
+}
+
+bool EnginioMockServer::listen(const QHostAddress &address, quint16 port)
+{
+    return QTcpServer::listen(address, port);
+}
+
+QUrl EnginioMockServer::serviceUrl() const
+{
+    QUrl url;
+    url.setScheme(QStringLiteral("http"));
+    url.setHost(serverAddress().toString());
+    url.setPort(serverPort());
+    return url;
+}
+
+void EnginioMockServer::setBackend(const QByteArray &backendId, const QByteArray &backendSecret)
+{
+    _backendId = backendId;
+    _backendSecret = backendSecret;
+}
+
+void EnginioMockServer::addUser(const QString &username, const QString &password)
+{
+    _passwords.insert(username, password);
+    QJsonObject user;
+    user[QStringLiteral("username")] = username;
+    createObject(QStringLiteral("users"), user);
+}
+
+int EnginioMockServer::latency() const
+{
+    return _latency;
+}
+
+void EnginioMockServer::setLatency(int msecs)
+{
+    _latency = msecs;
+}
+
+qint64 EnginioMockServer::bandwidth() const
+{
+    return _bandwidth;
+}
+
+void EnginioMockServer::setBandwidth(qint64 bytesPerSecond)
+{
+    _bandwidth = bytesPerSecond;
+}
+
+bool EnginioMockServer::compressResponses() const
+{
+    return _compressResponses;
+}
+
+void EnginioMockServer::setCompressResponses(bool compress)
+{
+    _compressResponses = compress;
+}
+
+int EnginioMockServer::rangedResponses() const
+{
+    return _rangedResponses;
+}
+
+void EnginioMockServer::setRangedResponses(int count)
+{
+    _rangedResponses = count;
+}
+
+int EnginioMockServer::requestCount() const
+{
+    return _requestCount;
+}
+
+QJsonArray EnginioMockServer::objects(const QString &objectType) const
+{
+    QJsonArray result;
+    const Collection collection = _collections.value(objectType);
+    for (Collection::const_iterator i = collection.constBegin(); i != collection.constEnd(); ++i)
+        result.append(i.value());
+    return result;
+}
+
+void EnginioMockServer::clear()
+{
+    _collections.clear();
+    _files.clear();
+    _passwords.clear();
+    _requestCount = 0;
+}
+
+void EnginioMockServer::incomingConnection(qintptr socketDescriptor)
+{
+    _connections.insert(new EnginioMockConnection(this, socketDescriptor));
+}
+
+void EnginioMockServer::addStream(EnginioMockConnection *connection, const QJsonObject &filter)
+{
+    _streams.insert(connection, filter);
+}
+
+void EnginioMockServer::removeConnection(EnginioMockConnection *connection)
+{
+    _connections.remove(connection);
+    _streams.remove(connection);
+}
+
+EnginioMockServer::Response EnginioMockServer::handle(const Request &request)
+{
+    if (request.headers.value("content-encoding") == "gzip") {
+        Request decoded = request;
+        decoded.headers.remove("content-encoding");
+        if (!gunzip(request.body, &decoded.body)) {
+            ++_requestCount;
+            return error(400, QStringLiteral("Invalid gzip body"));
+        }
+        return handle(decoded);
+    }
+
+    // a query too long for the url, the parameters are sent as a JSON object
+    if (request.method == "POST" && request.headers.value("x-http-method-override") == "GET") {
+        bool ok;
+        const QJsonObject parameters = parseJson(request.body, &ok);
+        if (!ok) {
+            ++_requestCount;
+            return error(400, QStringLiteral("Invalid JSON body"));
+        }
+        Request get = request;
+        get.method = "GET";
+        get.body.clear();
+        QByteArray encoded;
+        for (QJsonObject::const_iterator i = parameters.constBegin(); i != parameters.constEnd(); ++i) {
+            QByteArray value;
+            if (i.value().isString())
+                value = i.value().toString().toUtf8();
+            else if (i.value().isDouble())
+                value = QByteArray::number(i.value().toDouble());
+            else if (i.value().isArray())
+                value = QJsonDocument(i.value().toArray()).toJson(QJsonDocument::Compact);
+            else
+                value = QJsonDocument(i.value().toObject()).toJson(QJsonDocument::Compact);
+            if (!encoded.isEmpty())
+                encoded.append('&');
+            encoded.append(QUrl::toPercentEncoding(i.key()) + '=' + QUrl::toPercentEncoding(value));
+        }
+        get.query.setQuery(QString::fromLatin1(encoded));
+        return handle(get);
+    }
+
+    ++_requestCount;
+
+    QStringList segments = request.path.split(QLatin1Char('/'), QString::SkipEmptyParts);
+    if (segments.isEmpty() || segments.takeFirst() != QStringLiteral("v1"))
+        return error(404, QStringLiteral("Unknown path"));
+
+    // download urls are valid without credentials
+    if (segments.count() == 3 && segments[0] == QStringLiteral("files") && segments[2] == QStringLiteral("content"))
+        return handleFiles(request, segments.mid(1));
+
+    if (!_backendId.isEmpty() && (request.headers.value("enginio-backend-id") != _backendId
+                                  || request.headers.value("enginio-backend-secret") != _backendSecret))
+        return error(401, QStringLiteral("Invalid backend credentials"));
+
+    const QString resource = segments.value(0);
+    if (resource == QStringLiteral("auth") && segments.value(1) == QStringLiteral("identity") && segments.count() == 2)
+        return handleIdentity(request);
+    if (resource == QStringLiteral("stream_url") && segments.count() == 1)
+        return handleStreamUrl(request);
+    if (resource == QStringLiteral("search") && segments.count() == 1)
+        return handleSearch(request);
+    if (resource == QStringLiteral("files"))
+        return handleFiles(request, segments.mid(1));
+    if (resource == QStringLiteral("objects") && segments.count() >= 2 && segments.count() <= 3)
+        return handleObjects(request, QStringLiteral("objects.") + segments[1], segments.value(2));
+    if ((resource == QStringLiteral("users") || resource == QStringLiteral("usergroups")) && segments.count() <= 2)
+        return handleObjects(request, resource, segments.value(1));
+
+    return error(501, QStringLiteral("Not supported by the mock server: ") + request.path);
+}
+
+EnginioMockServer::Response EnginioMockServer::handleIdentity(const Request &request)
+{
+    if (request.method == "DELETE")
+        return Response(200, QJsonObject());
+    if (request.method != "POST")
+        return error(405, QStringLiteral("Only POST and DELETE are supported"));
+
+    bool ok;
+    const QJsonObject credentials = parseJson(request.body, &ok);
+    const QString username = credentials[QStringLiteral("username")].toString();
+    if (!ok || !_passwords.contains(username) || _passwords.value(username) != credentials[QStringLiteral("password")].toString())
+        return error(401, QStringLiteral("Invalid username or password"));
+
+    QJsonObject user;
+    const Collection users = _collections.value(QStringLiteral("users"));
+    for (Collection::const_iterator i = users.constBegin(); i != users.constEnd(); ++i) {
+        if (i.value()[QStringLiteral("username")].toString() == username)
+            user = i.value();
+    }
+
+    QJsonObject response;
+    response[QStringLiteral("sessionToken")] = QString::fromLatin1(QUuid::createUuid().toRfc4122().toHex());
+    response[QStringLiteral("user")] = user;
+    response[QStringLiteral("usergroups")] = QJsonArray();
+    return Response(200, response);
+}
+
+EnginioMockServer::Response EnginioMockServer::handleStreamUrl(const Request &request)
+{
+    QUrl url = serviceUrl();
+    url.setScheme(QStringLiteral("ws"));
+    url.setPath(QStringLiteral("/v1/stream"));
+    QUrlQuery query;
+    query.addQueryItem(QStringLiteral("filter"), request.query.queryItemValue(QStringLiteral("filter")));
+    url.setQuery(query);
+
+    QJsonObject response;
+    response[QStringLiteral("expiringUrl")] = url.toString(QUrl::FullyEncoded);
+    response[QStringLiteral("expiresAt")] = QDateTime::currentDateTimeUtc().addSecs(3600).toString(Qt::ISODate);
+    return Response(200, response);
+}
+
+EnginioMockServer::Response EnginioMockServer::handleSearch(const Request &request)
+{
+    bool ok;
+    const QJsonObject search = parseJson(request.query.queryItemValue(QStringLiteral("search"), QUrl::FullyDecoded).toUtf8(), &ok);
+    QString phrase = search[QStringLiteral("phrase")].toString();
+    phrase.remove(QLatin1Char('*'));
+    const QJsonArray properties = search[QStringLiteral("properties")].toArray();
+
+    QJsonArray results;
+    foreach (const QString &objectType, request.query.allQueryItemValues(QStringLiteral("objectTypes[]"), QUrl::FullyDecoded)) {
+        const Collection collection = _collections.value(objectType);
+        for (Collection::const_iterator i = collection.constBegin(); i != collection.constEnd(); ++i) {
+            const QJsonObject object = i.value();
+            for (QJsonObject::const_iterator property = object.constBegin(); property != object.constEnd(); ++property) {
+                if ((properties.isEmpty() || properties.contains(property.key()))
+                        && property.value().toString().contains(phrase, Qt::CaseInsensitive)) {
+                    results.append(object);
+                    break;
+                }
+            }
+        }
+    }
+
+    QJsonObject response;
+    response[QStringLiteral("results")] = results;
+    return Response(200, response);
+}
+
+EnginioMockServer::Response EnginioMockServer::handleFiles(const Request &request, const QStringList &segments)
+{
+    const QString files = QStringLiteral("files");
+    Collection &collection = _collections[files];
+    const QString id = segments.value(0);
+
+    if (id.isEmpty()) {
+        if (request.method != "POST")
+            return error(405, QStringLiteral("Files can only be created"));
+
+        QJsonObject metadata;
+        File file;
+        const QByteArray contentType = request.headers.value("content-type");
+        bool ok = true;
+        if (contentType.startsWith("multipart/form-data")) {
+            // the object description and the file in one request
+            QByteArray boundary = contentType.mid(contentType.indexOf("boundary=") + 9);
+            if (boundary.startsWith('"'))
+                boundary = boundary.mid(1, boundary.size() - 2);
+            if (boundary.isEmpty())
+                return error(400, QStringLiteral("Invalid multipart request"));
+
+            const QByteArray delimiter = "--" + boundary;
+            int position = request.body.indexOf(delimiter);
+            while (position != -1) {
+                const int headerStart = position + delimiter.size() + 2;
+                const int headerEnd = request.body.indexOf("\r\n\r\n", headerStart);
+                const int next = request.body.indexOf(delimiter, headerStart);
+                if (headerEnd == -1 || next == -1)
+                    break;
+                const QByteArray headers = request.body.mid(headerStart, headerEnd - headerStart);
+                const QByteArray content = request.body.mid(headerEnd + 4, next - headerEnd - 4 - 2);
+                if (headers.contains("name=\"object\""))
+                    metadata = parseJson(content, &ok);
+                else if (headers.contains("name=\"file\""))
+                    file.data = content;
+                position = next;
+            }
+        } else {
+            metadata = parseJson(request.body, &ok);
+        }
+        if (!ok)
+            return error(400, QStringLiteral("Invalid file description"));
+
+        file.target = metadata[QStringLiteral("targetFileProperty")].toObject();
+        QJsonObject properties;
+        properties[QStringLiteral("fileName")] = metadata[QStringLiteral("file")].toObject()[QStringLiteral("fileName")];
+        properties[QStringLiteral("fileSize")] = file.data.size();
+        properties[QStringLiteral("status")] = file.data.isEmpty() ? QStringLiteral("empty") : QStringLiteral("complete");
+        const QJsonObject object = createObject(files, properties);
+        const QString fileId = object[QStringLiteral("id")].toString();
+        _files.insert(fileId, file);
+        if (!file.data.isEmpty())
+            completeFile(fileId);
+        return Response(200, collection.value(fileId));
+    }
+
+    if (!collection.contains(id))
+        return error(404, QStringLiteral("File not found"));
+    const QString operation = segments.value(1);
+
+    if (operation == QStringLiteral("chunk") && request.method == "PUT") {
+        // Content-Range: {chunkStart}-{chunkEnd}/{totalFileSize}
+        const QByteArray range = request.headers.value("content-range");
+        const int dash = range.indexOf('-');
+        const int slash = range.indexOf('/');
+        const qint64 start = range.left(dash).toLongLong();
+        const qint64 total = range.mid(slash + 1).toLongLong();
+        File &file = _files[id];
+        if (dash == -1 || slash == -1 || start != file.data.size() || start + request.body.size() > total)
+            return error(400, QStringLiteral("Invalid chunk"));
+
+        file.data.append(request.body);
+        QJsonObject &object = collection[id];
+        object[QStringLiteral("fileSize")] = total;
+        object[QStringLiteral("status")] = file.data.size() == total ? QStringLiteral("complete") : QStringLiteral("incomplete");
+        object[QStringLiteral("updatedAt")] = timestamp();
+        if (file.data.size() == total)
+            completeFile(id);
+        return Response(200, collection.value(id));
+    }
+
+    if (operation == QStringLiteral("download_url") && request.method == "GET") {
+        QUrl url = serviceUrl();
+        url.setPath(QStringLiteral("/v1/files/") + id + QStringLiteral("/content"));
+        QJsonObject response;
+        response[QStringLiteral("expiringUrl")] = url.toString();
+        response[QStringLiteral("expiresAt")] = QDateTime::currentDateTimeUtc().addSecs(3600).toString(Qt::ISODate);
+        return Response(200, response);
+    }
+
+    if (operation == QStringLiteral("content") && request.method == "GET") {
+        const QByteArray data = _files.value(id).data;
+        const QByteArray range = request.headers.value("range");
+        // like a server or a proxy without range support
+        if (!range.startsWith("bytes=") || !_rangedResponses)
+            return Response(200, data);
+        if (_rangedResponses > 0)
+            --_rangedResponses;
+
+        // Range: bytes={first}-{last}, the last position is optional
+        const QList<QByteArray> positions = range.mid(6).split('-');
+        const qint64 first = positions.value(0).toLongLong();
+        qint64 last = positions.value(1).isEmpty() ? data.size() - 1 : positions.value(1).toLongLong();
+        last = qMin(last, qint64(data.size()) - 1);
+        if (first > last) {
+            Response response(416);
+            response.headers.append(qMakePair(QByteArrayLiteral("Content-Range"), "bytes */" + QByteArray::number(data.size())));
+            return response;
+        }
+        Response response(206, data.mid(first, last - first + 1));
+        response.headers.append(qMakePair(QByteArrayLiteral("Content-Range"),
+                                          "bytes " + QByteArray::number(first) + '-' + QByteArray::number(last)
+                                          + '/' + QByteArray::number(data.size())));
+        return response;
+    }
+
+    if (operation.isEmpty() && request.method == "GET")
+        return Response(200, collection.value(id));
+
+    if (operation.isEmpty() && request.method == "DELETE") {
+        _files.remove(id);
+        notify(QStringLiteral("delete"), collection.take(id));
+        return Response(200, QJsonObject());
+    }
+
+    return error(501, QStringLiteral("Not supported by the mock server: ") + request.path);
+}
+
+EnginioMockServer::Response EnginioMockServer::handleObjects(const Request &request, const QString &objectType, const QString &id)
+{
+    Collection &collection = _collections[objectType];
+
+    if (request.method == "GET") {
+        if (id.isEmpty())
+            return query(request, objectType);
+        if (!collection.contains(id))
+            return error(404, QStringLiteral("Object not found"));
+        return Response(200, collection.value(id));
+    }
+
+    bool ok = true;
+    const QJsonObject properties = request.body.isEmpty() ? QJsonObject() : parseJson(request.body, &ok);
+    if (!ok)
+        return error(400, QStringLiteral("Invalid JSON"));
+
+    if (request.method == "POST" && id.isEmpty()) {
+        const QJsonObject object = createObject(objectType, properties);
+        notify(QStringLiteral("create"), object);
+        return Response(200, object);
+    }
+
+    if (id.isEmpty())
+        return error(405, QStringLiteral("The operation requires an id"));
+    if (!collection.contains(id))
+        return error(404, QStringLiteral("Object not found"));
+
+    if (request.method == "PUT") {
+        QJsonObject &object = collection[id];
+        for (QJsonObject::const_iterator i = properties.constBegin(); i != properties.constEnd(); ++i) {
+            if (i.key() != QStringLiteral("id") && i.key() != QStringLiteral("objectType") && i.key() != QStringLiteral("createdAt"))
+                object[i.key()] = i.value();
+        }
+        object[QStringLiteral("updatedAt")] = timestamp();
+        notify(QStringLiteral("update"), object);
+        return Response(200, object);
+    }
+
+    if (request.method == "DELETE") {
+        notify(QStringLiteral("delete"), collection.take(id));
+        return Response(200, QJsonObject());
+    }
+
+    return error(405, QStringLiteral("Unsupported method"));
+}
+
+EnginioMockServer::Response EnginioMockServer::query(const Request &request, const QString &objectType)
+{
+    bool ok = true;
+    const QString q = request.query.queryItemValue(QStringLiteral("q"), QUrl::FullyDecoded);
+    const QJsonObject filter = q.isEmpty() ? QJsonObject() : parseJson(q.toUtf8(), &ok);
+    if (!ok)
+        return error(400, QStringLiteral("Invalid query"));
+
+    QList<QJsonObject> objects;
+    const Collection collection = _collections.value(objectType);
+    for (Collection::const_iterator i = collection.constBegin(); i != collection.constEnd(); ++i) {
+        if (matches(i.value(), filter))
+            objects.append(i.value());
+    }
+
+    const QString sort = request.query.queryItemValue(QStringLiteral("sort"), QUrl::FullyDecoded);
+    if (!sort.isEmpty())
+        qStableSort(objects.begin(), objects.end(), SortKeyLess(QJsonDocument::fromJson(sort.toUtf8()).array()));
+
+    const int offset = request.query.queryItemValue(QStringLiteral("offset")).toInt();
+    const bool limited = request.query.hasQueryItem(QStringLiteral("limit"));
+    const int limit = request.query.queryItemValue(QStringLiteral("limit")).toInt();
+    const QJsonArray fields = QJsonDocument::fromJson(request.query.queryItemValue(QStringLiteral("fields"), QUrl::FullyDecoded).toUtf8()).array();
+
+    QJsonArray results;
+    for (int i = offset; i < objects.count() && (!limited || results.count() < limit); ++i) {
+        if (fields.isEmpty()) {
+            results.append(objects[i]);
+            continue;
+        }
+        QJsonObject projected;
+        projected[QStringLiteral("id")] = objects[i][QStringLiteral("id")];
+        projected[QStringLiteral("objectType")] = objects[i][QStringLiteral("objectType")];
+        projected[QStringLiteral("createdAt")] = objects[i][QStringLiteral("createdAt")];
+        projected[QStringLiteral("updatedAt")] = objects[i][QStringLiteral("updatedAt")];
+        foreach (const QJsonValue &field, fields) {
+            if (objects[i].contains(field.toString()))
+                projected[field.toString()] = objects[i][field.toString()];
+        }
+        results.append(projected);
+    }
+
+    QJsonObject response;
+    response[QStringLiteral("results")] = results;
+    if (request.query.hasQueryItem(QStringLiteral("count")))
+        response[QStringLiteral("count")] = objects.count();
+    return Response(200, response);
+}
+
+QJsonObject EnginioMockServer::createObject(const QString &objectType, const QJsonObject &properties)
+{
+    QJsonObject object(properties);
+    const QString now = timestamp();
+    object[QStringLiteral("id")] = QStringLiteral("%1").arg(++_nextId, 24, 16, QLatin1Char('0'));
+    object[QStringLiteral("objectType")] = objectType;
+    object[QStringLiteral("createdAt")] = now;
+    if (!object.contains(QStringLiteral("updatedAt")))
+        object[QStringLiteral("updatedAt")] = now;
+    _collections[objectType].insert(object[QStringLiteral("id")].toString(), object);
+    return object;
+}
+
+void EnginioMockServer::completeFile(const QString &id)
+{
+    // attach the file to the object property it was uploaded for
+    const QJsonObject target = _files.value(id).target;
+    const QString objectType = target[QStringLiteral("objectType")].toString();
+    const QString objectId = target[QStringLiteral("id")].toString();
+    if (!_collections.value(objectType).contains(objectId))
+        return;
+
+    QJsonObject file;
+    file[QStringLiteral("id")] = id;
+    file[QStringLiteral("objectType")] = QStringLiteral("files");
+    QJsonObject &object = _collections[objectType][objectId];
+    object[target[QStringLiteral("propertyName")].toString()] = file;
+    object[QStringLiteral("updatedAt")] = timestamp();
+    notify(QStringLiteral("update"), object);
+}
+
+void EnginioMockServer::notify(const QString &event, const QJsonObject &object)
+{
+    QJsonObject message;
+    message[QStringLiteral("event")] = event;
+    message[QStringLiteral("data")] = object;
+    const QByteArray data = QJsonDocument(message).toJson(QJsonDocument::Compact);
+
+    for (QHash<EnginioMockConnection *, QJsonObject>::const_iterator i = _streams.constBegin(); i != _streams.constEnd(); ++i) {
+        const QJsonObject filter = i.value();
+        if (filter.contains(QStringLiteral("event")) && filter[QStringLiteral("event")].toString() != event)
+            continue;
+        if (!matches(object, filter[QStringLiteral("data")].toObject()))
+            continue;
+        i.key()->sendText(data);
+    }
+}
+
+}
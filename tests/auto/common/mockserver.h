@@ -0,0 +1,170 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#ifndef ENGINIOTESTSMOCKSERVER_H
+#define ENGINIOTESTSMOCKSERVER_H
+
+#include <QtCore/qhash.h>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qset.h>
+#include <QtCore/qurl.h>
+#include <QtCore/qurlquery.h>
+#include <QtNetwork/qtcpserver.h>
+
+namespace EnginioTests
+{
+
+class EnginioMockConnection;
+
+/*
+  A local stand-in for the Enginio backend, so that the client can be tested
+  and measured without network access or credentials.
+
+  It keeps the objects in memory and implements /v1/objects, /v1/users,
+  /v1/usergroups, /v1/search, /v1/files (multipart and chunked uploads,
+  download urls and ranged downloads), /v1/auth/identity, /v1/stream_url and
+  the WebSocket notification stream.
+
+  Request bodies may be gzip encoded, responses are gzip encoded as well
+  if compressResponses() is set and the client accepts it.
+
+  latency() delays every request and bandwidth() limits the transfer rate
+  in both directions, to simulate a remote backend:
+
+      EnginioTests::EnginioMockServer server;
+      server.setLatency(50);
+      server.setBandwidth(256 * 1024);
+      server.listen();
+      client.setServiceUrl(server.serviceUrl());
+*/
+class EnginioMockServer: public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    struct Request
+    {
+        QByteArray method;
+        QString path;
+        QUrlQuery query;
+        QHash<QByteArray, QByteArray> headers; // lower case names
+        QByteArray body;
+    };
+
+    struct Response
+    {
+        Response(int status = 200, const QByteArray &body = QByteArray());
+        Response(int status, const QJsonObject &object);
+
+        int status;
+        QList<QPair<QByteArray, QByteArray> > headers;
+        QByteArray body;
+    };
+
+    explicit EnginioMockServer(QObject *parent = 0);
+    ~EnginioMockServer();
+
+    bool listen(const QHostAddress &address = QHostAddress::LocalHost, quint16 port = 0);
+    QUrl serviceUrl() const;
+
+    // if set, requests with other credentials are rejected with 401
+    void setBackend(const QByteArray &backendId, const QByteArray &backendSecret);
+    void addUser(const QString &username, const QString &password);
+
+    int latency() const;
+    void setLatency(int msecs);
+    qint64 bandwidth() const;
+    void setBandwidth(qint64 bytesPerSecond); // 0 means unlimited
+    bool compressResponses() const;
+    void setCompressResponses(bool compress);
+    int rangedResponses() const;
+    void setRangedResponses(int count); // Range headers are ignored after count responses, -1 means never
+
+    int requestCount() const;
+    QJsonArray objects(const QString &objectType) const;
+    void clear();
+
+    // fixtures, bypassing HTTP, the properties may set updatedAt
+    QJsonObject createObject(const QString &objectType, const QJsonObject &properties);
+    void notify(const QString &event, const QJsonObject &object);
+
+    Response handle(const Request &request);
+    void addStream(EnginioMockConnection *connection, const QJsonObject &filter);
+    void removeConnection(EnginioMockConnection *connection);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) Q_DECL_OVERRIDE;
+
+private:
+    typedef QMap<QString, QJsonObject> Collection; // by id
+
+    struct File
+    {
+        QByteArray data;
+        QJsonObject target; // the object property the file is attached to
+    };
+
+    Response handleIdentity(const Request &request);
+    Response handleStreamUrl(const Request &request);
+    Response handleSearch(const Request &request);
+    Response handleFiles(const Request &request, const QStringList &segments);
+    Response handleObjects(const Request &request, const QString &objectType, const QString &id);
+
+    Response query(const Request &request, const QString &objectType);
+    void completeFile(const QString &id);
+
+    QByteArray _backendId;
+    QByteArray _backendSecret;
+    QHash<QString, QString> _passwords;
+    int _latency;
+    qint64 _bandwidth;
+    bool _compressResponses;
+    int _rangedResponses;
+    int _requestCount;
+    quint64 _nextId;
+    QHash<QString, Collection> _collections;
+    QHash<QString, File> _files;
+    QSet<EnginioMockConnection *> _connections;
+    QHash<EnginioMockConnection *, QJsonObject> _streams; // the notification filters
+};
+
+}
+
+#endif // ENGINIOTESTSMOCKSERVER_H
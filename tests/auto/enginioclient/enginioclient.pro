@@ -1,4 +1,4 @@
-QT       += testlib enginio
+QT       += testlib enginio network
 QT       -= gui
 
 DEFINES += TEST_FILE_PATH=\\\"$$_PRO_FILE_PWD_/../common/enginio.png\\\"
@@ -41,6 +41,8 @@
 #include <QtTest/QtTest>
 #include <QtCore/qobject.h>
 #include <QtCore/qthread.h>
+#include <QtNetwork/qtcpserver.h>
+#include <QtNetwork/qtcpsocket.h>
 
 #include <Enginio/enginioclient.h>
 #include <Enginio/enginioreply.h>
@@ -82,6 +84,7 @@ private slots:
     void query_todos_filter();
     void query_todos_limit();
     void query_todos_count();
+    void count_todos();
     void query_todos_sort();
     void remove_todos();
     void update_todos_invalidId();
@@ -103,6 +106,9 @@ private slots:
     void acl();
     void sharingNetworkManager();
     void search();
+    void retry();
+    void timeout();
+    void abort();
 
 private:
     QString usergroupId(EnginioClient *client)
@@ -288,6 +294,33 @@ void tst_EnginioClient::query_todos_count()
     QVERIFY(data.contains("count"));
 }
 
+void tst_EnginioClient::count_todos()
+{
+    EnginioClient client;
+    QObject::connect(&client, SIGNAL(error(EnginioReply *)), this, SLOT(error(EnginioReply *)));
+    client.setBackendId(_backendId);
+    client.setBackendSecret(_backendSecret);
+    client.setServiceUrl(EnginioTests::TESTAPP_URL);
+
+    QJsonObject obj;
+    obj["objectType"] = QString::fromUtf8("objects.todos");
+    obj["count"] = true;
+    const EnginioReply *queryReply = client.query(obj);
+    QTRY_VERIFY(queryReply->isFinished());
+    CHECK_NO_ERROR(queryReply);
+
+    obj.remove("count");
+    obj["limit"] = 1; // ignored when counting
+    const EnginioReply *countReply = client.count(obj);
+    QVERIFY(countReply);
+    QTRY_VERIFY(countReply->isFinished());
+    CHECK_NO_ERROR(countReply);
+    QJsonObject data = countReply->data();
+    QVERIFY(data.contains("count"));
+    QCOMPARE(data["count"].toDouble(), queryReply->data()["count"].toDouble());
+    QVERIFY(data["results"].toArray().count() <= 1);
+}
+
 void tst_EnginioClient::query_todos_sort()
 {
     EnginioClient client;
@@ -1667,5 +1700,117 @@ void tst_EnginioClient::prepareForSearch()
     }
 }
 
+void tst_EnginioClient::retry()
+{
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    QUrl url(QString::fromLatin1("http://127.0.0.1:%1/v1/objects/retry").arg(server.serverPort()));
+
+    EnginioClient client;
+    client.setMaxAttempts(3);
+    client.setRetryDelay(10);
+    QSignalSpy spyError(&client, SIGNAL(error(EnginioReply*)));
+
+    const EnginioReply *reply = client.customRequest(url, "GET");
+    QVERIFY(reply);
+
+    // the first attempt fails with a closed connection
+    QTRY_VERIFY(server.hasPendingConnections());
+    QTcpSocket *socket = server.nextPendingConnection();
+    QTRY_VERIFY(socket->bytesAvailable() > 0);
+    socket->close();
+    socket->deleteLater();
+
+    // the second one is answered
+    QTRY_VERIFY(server.hasPendingConnections());
+    socket = server.nextPendingConnection();
+    QTRY_VERIFY(socket->bytesAvailable() > 0);
+    socket->write("HTTP/1.1 200 OK\r\n"
+                  "Content-Type: application/json\r\n"
+                  "Content-Length: 11\r\n"
+                  "Connection: close\r\n"
+                  "\r\n"
+                  "{\"ok\":true}");
+
+    QTRY_VERIFY(reply->isFinished());
+    QCOMPARE(spyError.count(), 0);
+    QCOMPARE(reply->networkError(), QNetworkReply::NoError);
+    QVERIFY(reply->data()["ok"].toBool());
+
+    // a not idempotent request fails on the first error
+    reply = client.customRequest(url, "POST");
+    QVERIFY(reply);
+    QTRY_VERIFY(server.hasPendingConnections());
+    socket = server.nextPendingConnection();
+    QTRY_VERIFY(socket->bytesAvailable() > 0);
+    socket->close();
+    QTRY_VERIFY(reply->isFinished());
+    QCOMPARE(spyError.count(), 1);
+    QCOMPARE(reply->errorType(), EnginioReply::NetworkError);
+}
+
+void tst_EnginioClient::timeout()
+{
+    // the server accepts connections but never answers
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    QUrl url(QString::fromLatin1("http://127.0.0.1:%1/v1/objects/timeout").arg(server.serverPort()));
+
+    EnginioClient client;
+    QSignalSpy spyError(&client, SIGNAL(error(EnginioReply*)));
+    client.setRequestTimeout(200);
+
+    const EnginioReply *reply = client.customRequest(url, "GET");
+    QVERIFY(reply);
+    QTRY_VERIFY(reply->isFinished());
+    QCOMPARE(spyError.count(), 1);
+    QCOMPARE(reply->errorType(), EnginioReply::TimeoutError);
+    QCOMPARE(reply->networkError(), QNetworkReply::OperationCanceledError);
+
+    // a timeout of a single request
+    client.setRequestTimeout(0);
+    EnginioReply *single = client.customRequest(url, "GET");
+    QVERIFY(single);
+    single->setTimeout(200);
+    QTRY_VERIFY(single->isFinished());
+    QCOMPARE(spyError.count(), 2);
+    QCOMPARE(single->errorType(), EnginioReply::TimeoutError);
+}
+
+void tst_EnginioClient::abort()
+{
+    // the server accepts connections but never answers
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    QUrl url(QString::fromLatin1("http://127.0.0.1:%1/v1/objects/abort").arg(server.serverPort()));
+
+    EnginioClient client;
+    QSignalSpy spyError(&client, SIGNAL(error(EnginioReply*)));
+
+    EnginioReply *reply = client.customRequest(url, "GET");
+    QVERIFY(reply);
+    QSignalSpy spyFinished(reply, SIGNAL(finished(EnginioReply*)));
+    QTRY_VERIFY(server.hasPendingConnections());
+    reply->abort();
+    QTRY_COMPARE(spyFinished.count(), 1);
+    QVERIFY(reply->isFinished());
+    QCOMPARE(spyError.count(), 1);
+    QCOMPARE(reply->networkError(), QNetworkReply::OperationCanceledError);
+
+    // aborting a finished reply does nothing
+    reply->abort();
+    QTest::qWait(50);
+    QCOMPARE(spyFinished.count(), 1);
+    QCOMPARE(spyError.count(), 1);
+
+    // a reply which did not reach the network yet
+    EnginioReply *invalid = client.query(QJsonObject(), EnginioClient::UsergroupMembersOperation);
+    QVERIFY(invalid);
+    invalid->abort();
+    QTRY_VERIFY(invalid->isFinished());
+    QCOMPARE(invalid->networkError(), QNetworkReply::OperationCanceledError);
+    QVERIFY(invalid->data().isEmpty());
+}
+
 QTEST_MAIN(tst_EnginioClient)
 #include "tst_enginioclient.moc"
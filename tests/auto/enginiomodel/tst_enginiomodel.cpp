@@ -48,6 +48,7 @@
 #include <Enginio/enginioclient.h>
 #include <Enginio/enginioreply.h>
 #include <Enginio/enginiomodel.h>
+#include <Enginio/enginiosortfilterproxymodel.h>
 #include <Enginio/enginioidentity.h>
 
 #include "../common/common.h"
@@ -89,6 +90,13 @@ private slots:
     void removeExternallyRemovedObject();
     void setPropertyOnExternallyRemovedObject();
     void createAndModify();
+    void journal();
+    void snapshot();
+    void deltaSync();
+    void conflictPolicy();
+    void sortFilterProxy();
+    void totalCount();
+    void fields();
 private:
     template<class T>
     void externallyRemovedImpl();
@@ -1001,5 +1009,440 @@ void tst_EnginioModel::createAndModify()
     }
 }
 
+
+void tst_EnginioModel::journal()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString journalFile = dir.path() + QStringLiteral("/model.journal");
+    const QString propertyName = "title";
+    const QString objectType = "objects." + EnginioTests::CUSTOM_OBJECT1;
+    const QString title = QStringLiteral("journal") + QString::number(QDateTime::currentMSecsSinceEpoch());
+    QJsonObject query;
+    query.insert("objectType", objectType);
+
+    EnginioClient client;
+    client.setBackendId(_backendId);
+    client.setBackendSecret(_backendSecret);
+    client.setServiceUrl(QUrl(QStringLiteral("http://127.0.0.1:1"))); // nothing is listening there
+
+    {   // changes made without connectivity are kept
+        EnginioModel model;
+        model.setQuery(query);
+        model.setJournalFile(journalFile);
+        QCOMPARE(model.journalFile(), journalFile);
+        model.setEnginio(&client);
+        QTRY_VERIFY(model.isOffline());
+
+        QJsonObject object;
+        object.insert(propertyName, title + QStringLiteral("-1"));
+        EnginioReply *reply = model.append(object);
+        QVERIFY(reply);
+        QTRY_VERIFY(reply->isFinished());
+        QVERIFY(!reply->isError());
+        QCOMPARE(reply->backendStatus(), 202);
+        QCOMPARE(model.rowCount(), 1);
+
+        model.setProperty(0, propertyName, title + QStringLiteral("-2"));
+        model.setProperty(0, propertyName, title);
+        QCOMPARE(model.data(model.index(0), EnginioModel::SyncedRole).value<bool>(), false);
+
+        // a replay attempt fails, but the change is neither reverted nor lost
+        model.synchronize();
+        QTest::qWait(500);
+        QVERIFY(model.isOffline());
+        QCOMPARE(model.rowCount(), 1);
+        QCOMPARE(model.data(model.index(0)).value<QJsonValue>().toObject()[propertyName].toString(), title);
+        QCOMPARE(model.data(model.index(0), EnginioModel::SyncedRole).value<bool>(), false);
+    }
+
+    client.setServiceUrl(EnginioTests::TESTAPP_URL);
+    QObject::connect(&client, SIGNAL(error(EnginioReply *)), this, SLOT(error(EnginioReply *)));
+
+    {   // a new model replays the journal
+        EnginioModel model;
+        model.setQuery(query);
+        model.setJournalFile(journalFile);
+        model.setEnginio(&client);
+
+        QTRY_VERIFY(model.rowCount() > 0);
+        int row = -1;
+        for (int i = 0; i < model.rowCount(); ++i) {
+            if (model.data(model.index(i)).value<QJsonValue>().toObject()[propertyName].toString() == title)
+                row = i;
+        }
+        QVERIFY(row != -1);
+        QTRY_COMPARE(model.data(model.index(row), EnginioModel::SyncedRole).value<bool>(), true);
+        QVERIFY(!model.isOffline());
+        QVERIFY(!model.data(model.index(row), EnginioModel::IdRole).value<QJsonValue>().toString().startsWith("tmp"));
+    }
+
+    {   // the edits were coalesced into the create request
+        QJsonObject objectQuery;
+        QJsonObject titles;
+        titles.insert("$regex", QStringLiteral("^") + title);
+        objectQuery.insert(propertyName, titles);
+        QJsonObject fullQuery(query);
+        fullQuery.insert("query", objectQuery);
+
+        EnginioReply *reply = client.query(fullQuery);
+        QTRY_VERIFY(reply->isFinished());
+        QVERIFY(!reply->isError());
+        QJsonArray results = reply->data()["results"].toArray();
+        QCOMPARE(results.count(), 1);
+        QCOMPARE(results[0].toObject()[propertyName].toString(), title);
+    }
+}
+
+void tst_EnginioModel::snapshot()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString objectType = "objects." + EnginioTests::CUSTOM_OBJECT1;
+    QJsonObject query;
+    query.insert("objectType", objectType);
+
+    EnginioClient client;
+    QObject::connect(&client, SIGNAL(error(EnginioReply *)), this, SLOT(error(EnginioReply *)));
+    client.setBackendId(_backendId);
+    client.setBackendSecret(_backendSecret);
+    client.setServiceUrl(EnginioTests::TESTAPP_URL);
+
+    {
+        QJsonObject object;
+        object.insert("objectType", objectType);
+        object.insert("title", QStringLiteral("snapshot"));
+        EnginioReply *reply = client.create(object);
+        QTRY_VERIFY(reply->isFinished());
+        QVERIFY(!reply->isError());
+    }
+
+    int rowCount;
+    {
+        EnginioModel model;
+        model.setSnapshotDirectory(dir.path());
+        QCOMPARE(model.snapshotDirectory(), dir.path());
+        model.setQuery(query);
+        QSignalSpy spy(&model, SIGNAL(modelReset()));
+        model.setEnginio(&client);
+        QTRY_VERIFY(spy.count() > 0);
+        rowCount = model.rowCount();
+        QVERIFY(rowCount > 0);
+    }
+    QCOMPARE(QDir(dir.path()).entryList(QDir::Files).count(), 1);
+
+    {   // the model is populated before the backend answers
+        EnginioModel model;
+        model.setSnapshotDirectory(dir.path());
+        model.setQuery(query);
+        model.setEnginio(&client);
+        QCOMPARE(model.rowCount(), rowCount);
+
+        // the backend data is merged without a reset
+        QSignalSpy resetSpy(&model, SIGNAL(modelReset()));
+        QSignalSpy finishedSpy(&client, SIGNAL(finished(EnginioReply*)));
+        QTRY_VERIFY(finishedSpy.count() > 0);
+        QCOMPARE(resetSpy.count(), 0);
+        QCOMPARE(model.rowCount(), rowCount);
+    }
+}
+
+void tst_EnginioModel::deltaSync()
+{
+    const QString objectType = "objects." + EnginioTests::CUSTOM_OBJECT1;
+    QJsonObject query;
+    query.insert("objectType", objectType);
+
+    EnginioClient client;
+    QObject::connect(&client, SIGNAL(error(EnginioReply *)), this, SLOT(error(EnginioReply *)));
+    client.setBackendId(_backendId);
+    client.setBackendSecret(_backendSecret);
+    client.setServiceUrl(EnginioTests::TESTAPP_URL);
+
+    QJsonObject object;
+    object.insert("objectType", objectType);
+    object.insert("title", QStringLiteral("deltaSync"));
+    {
+        EnginioReply *reply = client.create(object);
+        QTRY_VERIFY(reply->isFinished());
+        QVERIFY(!reply->isError());
+    }
+
+    EnginioModel model;
+    model.setDeltaSync(true);
+    QVERIFY(model.deltaSync());
+    model.setQuery(query);
+    {
+        QSignalSpy spy(&model, SIGNAL(modelReset()));
+        model.setEnginio(&client);
+        QTRY_VERIFY(spy.count() > 0);
+    }
+    const int rowCount = model.rowCount();
+    QVERIFY(rowCount > 0);
+
+    QTest::qWait(1000); // updatedAt has to differ from the watermark
+    {
+        EnginioReply *reply = client.create(object);
+        QTRY_VERIFY(reply->isFinished());
+        QVERIFY(!reply->isError());
+    }
+
+    QSignalSpy resetSpy(&model, SIGNAL(modelReset()));
+    QSignalSpy insertSpy(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    model.refresh();
+    QTRY_COMPARE(model.rowCount(), rowCount + 1);
+    QCOMPARE(insertSpy.count(), 1);
+    QCOMPARE(resetSpy.count(), 0);
+}
+
+class ConflictResolvingModel: public EnginioModel
+{
+public:
+    int conflicts;
+    ConflictResolvingModel()
+        : conflicts(0)
+    {
+        setConflictPolicy(EnginioModel::CustomPolicy);
+    }
+
+protected:
+    QJsonObject resolveConflict(const QJsonObject &local, const QJsonObject &server, const QStringList &properties) Q_DECL_OVERRIDE
+    {
+        ++conflicts;
+        Q_ASSERT(server.isEmpty());
+        Q_ASSERT(properties.contains("title"));
+        return local; // keep the locally modified object
+    }
+};
+
+void tst_EnginioModel::conflictPolicy()
+{
+    QString objectType = "objects." + EnginioTests::CUSTOM_OBJECT1;
+    QJsonObject query;
+    query.insert("objectType", objectType);
+    query.insert("limit", 1);
+
+    EnginioClient client;
+    client.setBackendId(_backendId);
+    client.setBackendSecret(_backendSecret);
+    client.setServiceUrl(EnginioTests::TESTAPP_URL);
+
+    {
+        QJsonObject o;
+        o.insert("title", QString::fromLatin1("IWillBeRemoved"));
+        o.insert("objectType", objectType);
+        EnginioReply *r = client.create(o);
+        QTRY_VERIFY(r->isFinished());
+        QVERIFY(!r->isError());
+    }
+
+    ConflictResolvingModel model;
+    QCOMPARE(model.conflictPolicy(), EnginioModel::CustomPolicy);
+    model.setQuery(query);
+    {
+        QSignalSpy spy(&model, SIGNAL(modelReset()));
+        model.setEnginio(&client);
+        QTRY_VERIFY(spy.count() > 0);
+        QVERIFY(model.rowCount());
+    }
+    QString id = model.data(model.index(0), EnginioModel::IdRole).value<QJsonValue>().toString();
+    QVERIFY(!id.isEmpty());
+    const QString updatedAt = model.data(model.index(0), EnginioModel::UpdatedAtRole).value<QJsonValue>().toString();
+    QVERIFY(!updatedAt.isEmpty());
+
+    QJsonObject o;
+    o.insert("id", id);
+    o.insert("objectType", objectType);
+    EnginioReply *r1 = client.remove(o);
+    QTRY_VERIFY(r1->isFinished());
+
+    // the update conflicts with the removal, the custom policy keeps the object
+    EnginioReply *r2 = model.setProperty(0, "title", "IAmStillHere");
+    QTRY_VERIFY(r2->isFinished());
+    QCOMPARE(r2->backendStatus(), 404);
+    QTRY_COMPARE(model.conflicts, 1);
+    QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(model.data(model.index(0)).value<QJsonValue>().toObject()["title"].toString(), QString::fromLatin1("IAmStillHere"));
+    // the kept object is as old as the local row
+    QCOMPARE(model.data(model.index(0), EnginioModel::UpdatedAtRole).value<QJsonValue>().toString(), updatedAt);
+}
+
+void tst_EnginioModel::sortFilterProxy()
+{
+    const QString objectType = "objects." + EnginioTests::CUSTOM_OBJECT1;
+    QJsonObject query;
+    query.insert("objectType", objectType);
+    QJsonObject testCase;
+    testCase.insert("testCase", QStringLiteral("sortFilterProxy"));
+    query.insert("query", testCase);
+
+    EnginioClient client;
+    QObject::connect(&client, SIGNAL(error(EnginioReply *)), this, SLOT(error(EnginioReply *)));
+    client.setBackendId(_backendId);
+    client.setBackendSecret(_backendSecret);
+    client.setServiceUrl(EnginioTests::TESTAPP_URL);
+
+    const int counts[] = {3, 1, 2};
+    for (int i = 0; i < 3; ++i) {
+        QJsonObject object;
+        object.insert("objectType", objectType);
+        object.insert("testCase", QStringLiteral("sortFilterProxy"));
+        object.insert("count", counts[i]);
+        EnginioReply *reply = client.create(object);
+        QTRY_VERIFY(reply->isFinished());
+        QVERIFY(!reply->isError());
+    }
+
+    EnginioModel model;
+    model.setQuery(query);
+    {
+        QSignalSpy spy(&model, SIGNAL(modelReset()));
+        model.setEnginio(&client);
+        QTRY_VERIFY(spy.count() > 0);
+    }
+    QVERIFY(model.rowCount() >= 3);
+
+    EnginioSortFilterProxyModel proxy;
+    proxy.setSourceModel(&model);
+    QCOMPARE(proxy.sourceModel(), static_cast<QAbstractItemModel *>(&model));
+    QCOMPARE(proxy.rowCount(), model.rowCount());
+
+    QSignalSpy sortOrderSpy(&proxy, SIGNAL(sortOrderChanged(Qt::SortOrder)));
+    proxy.setSortProperty("count");
+    QCOMPARE(proxy.sortProperty(), QString::fromLatin1("count"));
+    for (int row = 1; row < proxy.rowCount(); ++row) {
+        const double previous = proxy.data(proxy.index(row - 1, 0)).value<QJsonValue>().toObject()["count"].toDouble();
+        QVERIFY(previous <= proxy.data(proxy.index(row, 0)).value<QJsonValue>().toObject()["count"].toDouble());
+    }
+
+    proxy.setSortOrder(Qt::DescendingOrder);
+    QCOMPARE(sortOrderSpy.count(), 1);
+    for (int row = 1; row < proxy.rowCount(); ++row) {
+        const double previous = proxy.data(proxy.index(row - 1, 0)).value<QJsonValue>().toObject()["count"].toDouble();
+        QVERIFY(previous >= proxy.data(proxy.index(row, 0)).value<QJsonValue>().toObject()["count"].toDouble());
+    }
+
+    {
+        // an appended object is placed according to its sort key
+        QJsonObject object;
+        object.insert("objectType", objectType);
+        object.insert("testCase", QStringLiteral("sortFilterProxy"));
+        object.insert("count", 1000);
+        EnginioReply *reply = model.append(object);
+        QTRY_VERIFY(reply->isFinished());
+        QVERIFY(!reply->isError());
+        QCOMPARE(proxy.rowCount(), model.rowCount());
+        QCOMPARE(proxy.data(proxy.index(0, 0)).value<QJsonValue>().toObject()["count"].toDouble(), 1000.);
+    }
+
+    proxy.setFilterProperty("count");
+    proxy.setFilterValue(2);
+    QVERIFY(proxy.rowCount() > 0);
+    QVERIFY(proxy.rowCount() < model.rowCount());
+    for (int row = 0; row < proxy.rowCount(); ++row)
+        QCOMPARE(proxy.data(proxy.index(row, 0)).value<QJsonValue>().toObject()["count"].toDouble(), 2.);
+
+    proxy.setFilterProperty(QString());
+    QCOMPARE(proxy.rowCount(), model.rowCount());
+}
+
+void tst_EnginioModel::totalCount()
+{
+    const QString objectType = "objects." + EnginioTests::CUSTOM_OBJECT1;
+    QJsonObject query;
+    query.insert("objectType", objectType);
+
+    EnginioClient client;
+    QObject::connect(&client, SIGNAL(error(EnginioReply *)), this, SLOT(error(EnginioReply *)));
+    client.setBackendId(_backendId);
+    client.setBackendSecret(_backendSecret);
+    client.setServiceUrl(EnginioTests::TESTAPP_URL);
+
+    for (int i = 0; i < 3; ++i) {
+        QJsonObject object;
+        object.insert("objectType", objectType);
+        object.insert("title", QStringLiteral("totalCount"));
+        EnginioReply *reply = client.create(object);
+        QTRY_VERIFY(reply->isFinished());
+        QVERIFY(!reply->isError());
+    }
+
+    int total;
+    {
+        // without pagination the model contains all objects
+        EnginioModel model;
+        QCOMPARE(model.totalCount(), -1);
+        model.setQuery(query);
+        model.setEnginio(&client);
+        QTRY_VERIFY(model.rowCount() >= 3);
+        QCOMPARE(model.totalCount(), model.rowCount());
+        total = model.totalCount();
+    }
+
+    query.insert("pageSize", 2);
+    EnginioModel model;
+    QSignalSpy spy(&model, SIGNAL(totalCountChanged(int)));
+    model.setQuery(query);
+    model.setEnginio(&client);
+    QTRY_COMPARE(model.totalCount(), total);
+    QTRY_COMPARE(model.rowCount(), 2);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy[0][0].toInt(), total);
+
+    QJsonObject object;
+    object.insert("title", QStringLiteral("totalCount"));
+    EnginioReply *reply = model.append(object);
+    QCOMPARE(model.totalCount(), total + 1);
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(!reply->isError());
+}
+
+void tst_EnginioModel::fields()
+{
+    const QString objectType = "objects." + EnginioTests::CUSTOM_OBJECT1;
+    QJsonObject query;
+    query.insert("objectType", objectType);
+    query.insert("limit", 5);
+    QJsonArray fields;
+    fields.append(QStringLiteral("title"));
+    query.insert("fields", fields);
+
+    EnginioClient client;
+    QObject::connect(&client, SIGNAL(error(EnginioReply *)), this, SLOT(error(EnginioReply *)));
+    client.setBackendId(_backendId);
+    client.setBackendSecret(_backendSecret);
+    client.setServiceUrl(EnginioTests::TESTAPP_URL);
+
+    QJsonObject object;
+    object.insert("objectType", objectType);
+    object.insert("title", QStringLiteral("fields"));
+    object.insert("count", 42);
+    {
+        EnginioReply *reply = client.create(object);
+        QTRY_VERIFY(reply->isFinished());
+        QVERIFY(!reply->isError());
+    }
+
+    EnginioModel model;
+    model.setQuery(query);
+    {
+        QSignalSpy spy(&model, SIGNAL(modelReset()));
+        model.setEnginio(&client);
+        QTRY_VERIFY(spy.count() > 0);
+    }
+    QVERIFY(model.rowCount());
+
+    for (int row = 0; row < model.rowCount(); ++row) {
+        const QJsonObject stored = model.data(model.index(row)).value<QJsonValue>().toObject();
+        QVERIFY(stored.contains("id"));
+        QVERIFY(stored.contains("objectType"));
+        QVERIFY(!stored.contains("count"));
+        QVERIFY(!stored.contains("testCase"));
+    }
+
+    const QList<QByteArray> roles = model.roleNames().values();
+    QVERIFY(!roles.contains("count"));
+}
+
 QTEST_MAIN(tst_EnginioModel)
 #include "tst_enginiomodel.moc"
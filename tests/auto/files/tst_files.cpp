@@ -74,6 +74,8 @@ private slots:
     void cleanupTestCase();
     void fileUploadDownload_data();
     void fileUploadDownload();
+    void createWithFile_data();
+    void createWithFile();
 };
 
 void tst_Files::initTestCase()
@@ -222,6 +224,69 @@ void tst_Files::fileUploadDownload()
         QByteArray imageData = reply->readAll();
         QImage img = QImage::fromData(imageData);
         QCOMPARE(img.size(), QSize(181, 54));
+
+        // the download url is valid for a while, so it is served from the cache
+        const EnginioReply *replyCached = client.downloadFile(object);
+        QVERIFY(replyCached);
+        QTRY_VERIFY(replyCached->isFinished());
+        QCOMPARE(spyError.count(), 0);
+        QCOMPARE(replyCached->data()["expiringUrl"].toString(), downloadData["expiringUrl"].toString());
+        QCOMPARE(replyCached->data()["expiresAt"].toString(), downloadData["expiresAt"].toString());
+    }
+
+    // Download directly into a device
+    {
+        QFile file(filePath);
+        QVERIFY(file.open(QFile::ReadOnly));
+        const QByteArray expected = file.readAll();
+
+        const int segmentSize = client.downloadSegmentSize();
+        // force a few parallel ranged requests
+        client.setDownloadSegmentSize(1024);
+
+        QJsonObject object;
+        object["id"] = fileId;
+
+        QBuffer buffer;
+        QVERIFY(buffer.open(QIODevice::WriteOnly));
+        const EnginioReply *replyDownload = client.downloadFile(object, &buffer);
+        QVERIFY(replyDownload);
+        QSignalSpy progressSpy(replyDownload, SIGNAL(progress(qint64,qint64)));
+        QTRY_VERIFY(replyDownload->isFinished());
+        QCOMPARE(spyError.count(), 0);
+        QCOMPARE(buffer.data(), expected);
+        QVERIFY(progressSpy.count() > 1);
+        QCOMPARE(progressSpy.last()[0].value<qint64>(), qint64(expected.size()));
+
+        // resume from the middle of the file
+        QBuffer partial;
+        partial.setData(expected.left(expected.size() / 2));
+        QVERIFY(partial.open(QIODevice::ReadWrite));
+        QVERIFY(partial.seek(partial.size()));
+        replyDownload = client.downloadFile(object, &partial);
+        QVERIFY(replyDownload);
+        QTRY_VERIFY(replyDownload->isFinished());
+        QCOMPARE(spyError.count(), 0);
+        QCOMPARE(partial.data(), expected);
+
+        // one segment at a time and a limited byte rate
+        const int maxRunning = client.maxRunningRequests(EnginioClient::BulkRequests);
+        QCOMPARE(client.maxBytesPerSecond(EnginioClient::BulkRequests), 0);
+        client.setMaxRunningRequests(EnginioClient::BulkRequests, 1);
+        client.setMaxBytesPerSecond(EnginioClient::BulkRequests, 16 * 1024);
+        QCOMPARE(client.maxRunningRequests(EnginioClient::BulkRequests), 1);
+        QCOMPARE(client.maxBytesPerSecond(EnginioClient::BulkRequests), 16 * 1024);
+        QBuffer throttled;
+        QVERIFY(throttled.open(QIODevice::WriteOnly));
+        replyDownload = client.downloadFile(object, &throttled);
+        QVERIFY(replyDownload);
+        QTRY_VERIFY(replyDownload->isFinished());
+        QCOMPARE(spyError.count(), 0);
+        QCOMPARE(throttled.data(), expected);
+        client.setMaxRunningRequests(EnginioClient::BulkRequests, maxRunning);
+        client.setMaxBytesPerSecond(EnginioClient::BulkRequests, 0);
+
+        client.setDownloadSegmentSize(segmentSize);
     }
 
     // View/Query the file details
@@ -286,5 +351,69 @@ void tst_Files::fileUploadDownload()
 }
 
 
+void tst_Files::createWithFile_data()
+{
+    fileUploadDownload_data();
+}
+
+void tst_Files::createWithFile()
+{
+    QFETCH(int, chunkSize);
+
+    EnginioClient client;
+    QObject::connect(&client, SIGNAL(error(EnginioReply *)), this, SLOT(error(EnginioReply *)));
+    client.setBackendId(_backendId);
+    client.setBackendSecret(_backendSecret);
+    client.setServiceUrl(EnginioTests::TESTAPP_URL);
+
+    if (chunkSize > 0) {
+        EnginioClientPrivate *clientPrivate = EnginioClientPrivate::get(&client);
+        clientPrivate->_uploadChunkSize = chunkSize;
+    }
+
+    QSignalSpy spyError(&client, SIGNAL(error(EnginioReply*)));
+
+    QJsonObject obj;
+    obj["objectType"] = QString::fromUtf8("objects.%1").arg(EnginioTests::CUSTOM_OBJECT1);
+    obj["title"] = QString::fromUtf8("Object Created With File");
+
+    QString filePath = QStringLiteral(TEST_FILE_PATH);
+    const EnginioReply *reply = client.createWithFile(obj, QStringLiteral("fileAttachment"), QUrl(filePath));
+    QVERIFY(reply);
+    QSignalSpy progressSpy(reply, SIGNAL(progress(qint64,qint64)));
+    QSignalSpy finishedSpy(reply, SIGNAL(finished(EnginioReply*)));
+    QTRY_VERIFY(reply->isFinished());
+    QCOMPARE(spyError.count(), 0);
+    QCOMPARE(finishedSpy.count(), 1);
+    QVERIFY(progressSpy.count() > 0);
+
+    QJsonObject data = reply->data();
+    QVERIFY(!data["id"].toString().isEmpty());
+    QCOMPARE(data["title"], obj["title"]);
+    QJsonObject file = data["fileAttachment"].toObject();
+    QVERIFY(!file["id"].toString().isEmpty());
+
+    // the object references the uploaded file
+    QJsonObject query = QJsonDocument::fromJson(
+                "{\"include\": {\"fileAttachment\": {}},"
+                "\"objectType\": \"objects." + EnginioTests::CUSTOM_OBJECT1.toUtf8() + "\","
+                "\"query\": {\"id\": \"" + data["id"].toString().toUtf8() + "\"}}").object();
+    const EnginioReply *queryReply = client.query(query);
+    QVERIFY(queryReply);
+    QTRY_VERIFY(queryReply->isFinished());
+    QCOMPARE(spyError.count(), 0);
+    QJsonObject attachment = queryReply->data()["results"].toArray().first().toObject()["fileAttachment"].toObject();
+    QCOMPARE(attachment["id"].toString(), file["id"].toString());
+    QCOMPARE(attachment["fileName"].toString(), QStringLiteral("test.png"));
+
+    // nothing is created for a missing file
+    const EnginioReply *missing = client.createWithFile(obj, QStringLiteral("fileAttachment"), QUrl(QStringLiteral("does-not-exist.png")));
+    QVERIFY(missing);
+    QTRY_VERIFY(missing->isFinished());
+    QVERIFY(missing->isError());
+    QCOMPARE(missing->errorType(), EnginioReply::BackendError);
+    QTRY_COMPARE(spyError.count(), 1);
+}
+
 QTEST_MAIN(tst_Files)
 #include "tst_files.moc"
@@ -0,0 +1,16 @@
+QT       += testlib network enginio enginio-private
+QT       -= gui
+
+DEFINES += TEST_FILE_PATH=\\\"$$_PRO_FILE_PWD_/../common/enginio.png\\\"
+
+TARGET = tst_mockserver
+CONFIG   += console testcase
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += \
+    tst_mockserver.cpp \
+    ../common/mockserver.cpp
+
+HEADERS += ../common/mockserver.h
@@ -0,0 +1,945 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#include <QtTest/QtTest>
+#include <QtCore/qendian.h>
+#include <QtCore/qobject.h>
+
+#include <Enginio/enginioclient.h>
+#include <Enginio/private/enginioclient_p.h>
+#include <Enginio/private/enginiobackendconnection_p.h>
+#include <Enginio/enginioreply.h>
+#include <Enginio/enginioidentity.h>
+#include <Enginio/enginiometrics.h>
+#include <Enginio/enginiomodel.h>
+#include <Enginio/enginioquery.h>
+
+#include "../common/mockserver.h"
+
+#define CHECK_NO_ERROR(response) \
+    QVERIFY(!response->isError()); \
+    QCOMPARE(response->errorType(), EnginioReply::NoError);\
+    QCOMPARE(response->networkError(), QNetworkReply::NoError);\
+    QVERIFY(response->backendStatus() >= 200 && response->backendStatus() < 300);
+
+// Unlike the other tests this one does not need a backend, it runs
+// the client against EnginioTests::EnginioMockServer.
+
+class tst_MockServer: public QObject
+{
+    Q_OBJECT
+
+    EnginioTests::EnginioMockServer _server;
+
+    void prepareClient(EnginioClient *client);
+
+private slots:
+    void initTestCase();
+    void init();
+    void crud();
+    void query();
+    void typedQuery();
+    void largeQuery();
+    void count();
+    void invalidCredentials();
+    void identity();
+    void chunkedUpload();
+    void downloadIgnoredRange();
+    void downloadToFile();
+    void createWithFileFailure();
+    void notifications();
+    void latency();
+    void metrics();
+    void debugInfo();
+    void requestTemplates();
+    void compression();
+    void deltaSync();
+    void deltaSyncLimit();
+};
+
+void tst_MockServer::prepareClient(EnginioClient *client)
+{
+    client->setBackendId(QByteArrayLiteral("backendId"));
+    client->setBackendSecret(QByteArrayLiteral("backendSecret"));
+    client->setServiceUrl(_server.serviceUrl());
+}
+
+void tst_MockServer::initTestCase()
+{
+    QVERIFY(_server.listen());
+    _server.setBackend(QByteArrayLiteral("backendId"), QByteArrayLiteral("backendSecret"));
+}
+
+void tst_MockServer::init()
+{
+    _server.clear();
+    _server.setLatency(0);
+    _server.setBandwidth(0);
+    _server.setCompressResponses(false);
+    _server.setRangedResponses(-1);
+}
+
+void tst_MockServer::crud()
+{
+    EnginioClient client;
+    prepareClient(&client);
+
+    QJsonObject object;
+    object["objectType"] = QStringLiteral("objects.todos");
+    object["title"] = QStringLiteral("Buy milk");
+    EnginioReply *reply = client.create(object);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QString id = reply->data()["id"].toString();
+    QVERIFY(!id.isEmpty());
+    QCOMPARE(reply->data()["title"], object["title"]);
+    QVERIFY(!reply->data()["createdAt"].toString().isEmpty());
+    QCOMPARE(_server.objects(QStringLiteral("objects.todos")).count(), 1);
+
+    object["id"] = id;
+    object["title"] = QStringLiteral("Buy bread");
+    reply = client.update(object);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(reply->data()["title"], object["title"]);
+    QCOMPARE(_server.objects(QStringLiteral("objects.todos")).first().toObject()["title"], object["title"]);
+
+    reply = client.remove(object);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QVERIFY(reply->data().isEmpty());
+    QVERIFY(_server.objects(QStringLiteral("objects.todos")).isEmpty());
+
+    reply = client.update(object);
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(reply->isError());
+    QCOMPARE(reply->backendStatus(), 404);
+}
+
+void tst_MockServer::query()
+{
+    EnginioClient client;
+    prepareClient(&client);
+
+    QSignalSpy spy(&client, SIGNAL(finished(EnginioReply*)));
+    QJsonObject object;
+    object["objectType"] = QStringLiteral("objects.todos");
+    for (int i = 0; i < 10; ++i) {
+        object["count"] = i;
+        object["title"] = i % 2 ? QStringLiteral("odd") : QStringLiteral("even");
+        client.create(object);
+    }
+    QTRY_COMPARE(spy.count(), 10);
+
+    QJsonObject query;
+    query["objectType"] = QStringLiteral("objects.todos");
+    query["query"] = QJsonDocument::fromJson("{\"title\": \"odd\", \"count\": {\"$gt\": 2}}").object();
+    query["sort"] = QJsonDocument::fromJson("[{\"sortBy\": \"count\", \"direction\": \"desc\"}]").array();
+    query["limit"] = 2;
+    query["offset"] = 1;
+    EnginioReply *reply = client.query(query);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QJsonArray results = reply->data()["results"].toArray();
+    QCOMPARE(results.count(), 2);
+    QCOMPARE(results[0].toObject()["count"].toDouble(), 7.0);
+    QCOMPARE(results[1].toObject()["count"].toDouble(), 5.0);
+
+    reply = client.count(query);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(reply->data()["count"].toDouble(), 3.0);
+
+    QJsonObject search;
+    QJsonArray objectTypes;
+    objectTypes.append(QStringLiteral("objects.todos"));
+    search["objectTypes"] = objectTypes;
+    search["search"] = QJsonDocument::fromJson("{\"phrase\": \"eve*\"}").object();
+    reply = client.search(search);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(reply->data()["results"].toArray().count(), 5);
+}
+
+void tst_MockServer::typedQuery()
+{
+    EnginioClient client;
+    prepareClient(&client);
+
+    QSignalSpy spy(&client, SIGNAL(finished(EnginioReply*)));
+    QJsonObject object;
+    object["objectType"] = QStringLiteral("objects.todos");
+    for (int i = 0; i < 10; ++i) {
+        object["count"] = i;
+        object["title"] = i % 2 ? QStringLiteral("odd \"&= 1+1") : QStringLiteral("even");
+        client.create(object);
+    }
+    QTRY_COMPARE(spy.count(), 10);
+
+    QJsonObject filter;
+    filter["title"] = QStringLiteral("odd \"&= 1+1");
+    EnginioQuery query(QStringLiteral("objects.todos"));
+    query.setFilter(filter).addSort(QStringLiteral("count"), Qt::DescendingOrder).setLimit(3).setOffset(1).addField(QStringLiteral("count"));
+
+    EnginioReply *reply = client.query(query);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QJsonArray results = reply->data()["results"].toArray();
+    QCOMPARE(results.count(), 3);
+    QCOMPARE(results[0].toObject()["count"].toDouble(), 7.0);
+    QCOMPARE(results[2].toObject()["count"].toDouble(), 3.0);
+    QVERIFY(!results[0].toObject().contains("title"));
+
+    // the JSON form gives the same results
+    reply = client.query(query.toJson());
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(reply->data()["results"].toArray(), results);
+
+    reply = client.query(EnginioQuery()); // no object type
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(reply->isError());
+    QCOMPARE(reply->backendStatus(), 400);
+}
+
+void tst_MockServer::largeQuery()
+{
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioClientPrivate *d = EnginioClientPrivate::get(&client);
+    QCOMPARE(client.maxQueryUrlSize(), 0); // the backend has to support the method override
+    client.setMaxQueryUrlSize(4 * 1024);
+
+    QSignalSpy spy(&client, SIGNAL(finished(EnginioReply*)));
+    QJsonObject object;
+    object["objectType"] = QStringLiteral("objects.todos");
+    for (int i = 0; i < 10; ++i) {
+        object["count"] = i;
+        client.create(object);
+    }
+    QTRY_COMPARE(spy.count(), 10);
+
+    // hundreds of values do not fit in the url
+    QJsonArray counts;
+    for (int i = 0; i < 500; ++i)
+        counts.append(i * 2);
+    QJsonObject in;
+    in["$in"] = counts;
+    QJsonObject filter;
+    filter["count"] = in;
+
+    QJsonObject query;
+    query["objectType"] = QStringLiteral("objects.todos");
+    query["query"] = filter;
+    query["limit"] = 3;
+    QJsonObject sort;
+    sort["sortBy"] = QStringLiteral("count");
+    sort["direction"] = QStringLiteral("desc");
+    query["sort"] = QJsonArray() << sort;
+
+    EnginioReply *reply = client.query(query);
+    QNetworkReply *nreply = d->_replyReplyMap.key(reply);
+    QCOMPARE(nreply->operation(), QNetworkAccessManager::PostOperation);
+    QCOMPARE(nreply->request().rawHeader("X-HTTP-Method-Override"), QByteArrayLiteral("GET"));
+    QVERIFY(!nreply->url().hasQuery());
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QJsonArray results = reply->data()["results"].toArray();
+    QCOMPARE(results.count(), 3);
+    QCOMPARE(results[0].toObject()["count"].toDouble(), 8.0);
+    QCOMPARE(results[2].toObject()["count"].toDouble(), 4.0);
+
+    reply = client.count(query);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(reply->data()["count"].toDouble(), 5.0);
+
+    // the same query in the url gives the same results
+    client.setMaxQueryUrlSize(0);
+    reply = client.query(query);
+    QCOMPARE(d->_replyReplyMap.key(reply)->operation(), QNetworkAccessManager::GetOperation);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(reply->data()["results"].toArray(), results);
+
+    // a small limit moves the typed query to the body as well
+    client.setMaxQueryUrlSize(64);
+    EnginioQuery typed(QStringLiteral("objects.todos"));
+    typed.setFilter(filter).addSort(QStringLiteral("count"), Qt::DescendingOrder).setLimit(3);
+    reply = client.query(typed);
+    QCOMPARE(d->_replyReplyMap.key(reply)->operation(), QNetworkAccessManager::PostOperation);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(reply->data()["results"].toArray(), results);
+}
+
+void tst_MockServer::count()
+{
+    EnginioClient client;
+    prepareClient(&client);
+
+    QSignalSpy spy(&client, SIGNAL(finished(EnginioReply*)));
+    QJsonObject object;
+    object["objectType"] = QStringLiteral("objects.todos");
+    for (int i = 0; i < 10; ++i) {
+        object["count"] = i;
+        client.create(object);
+    }
+    QTRY_COMPARE(spy.count(), 10);
+
+    QJsonObject filter;
+    QJsonObject gte;
+    gte["$gte"] = 4;
+    filter["count"] = gte;
+    QJsonObject query;
+    query["objectType"] = QStringLiteral("objects.todos");
+    query["query"] = filter;
+    query["limit"] = 2; // ignored
+
+    // the count does not depend on how the backend treats limit=0
+    EnginioReply *reply = client.count(query);
+    QVERIFY(!EnginioClientPrivate::get(&client)->_replyReplyMap.key(reply)->url().query().contains(QStringLiteral("limit=0")));
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(reply->data()["count"].toDouble(), 6.0);
+    const QJsonArray results = reply->data()["results"].toArray();
+    QVERIFY(results.count() <= 1);
+    if (!results.isEmpty())
+        QVERIFY(!results.first().toObject().contains("count")); // projected to the id
+}
+
+void tst_MockServer::invalidCredentials()
+{
+    EnginioClient client;
+    prepareClient(&client);
+    client.setBackendSecret(QByteArrayLiteral("wrong"));
+
+    QJsonObject query;
+    query["objectType"] = QStringLiteral("objects.todos");
+    EnginioReply *reply = client.query(query);
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(reply->isError());
+    QCOMPARE(reply->backendStatus(), 401);
+    QVERIFY(reply->data()["errors"].isArray());
+}
+
+void tst_MockServer::identity()
+{
+    _server.addUser(QStringLiteral("logintest"), QStringLiteral("logintest"));
+
+    EnginioClient client;
+    prepareClient(&client);
+
+    EnginioBasicAuthentication identity;
+    identity.setUser(QStringLiteral("logintest"));
+    identity.setPassword(QStringLiteral("wrong"));
+    client.setIdentity(&identity);
+    QTRY_COMPARE(client.authenticationState(), EnginioClient::AuthenticationFailure);
+
+    identity.setPassword(QStringLiteral("logintest"));
+    QTRY_COMPARE(client.authenticationState(), EnginioClient::Authenticated);
+}
+
+void tst_MockServer::chunkedUpload()
+{
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioClientPrivate::get(&client)->_uploadChunkSize = 1024;
+
+    QJsonObject object;
+    object["objectType"] = QStringLiteral("objects.files");
+    EnginioReply *reply = client.create(object);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    const QString id = reply->data()["id"].toString();
+
+    QJsonObject target;
+    target["id"] = id;
+    target["objectType"] = QStringLiteral("objects.files");
+    target["propertyName"] = QStringLiteral("fileAttachment");
+    QJsonObject file;
+    file["fileName"] = QStringLiteral("enginio.png");
+    QJsonObject upload;
+    upload["targetFileProperty"] = target;
+    upload["file"] = file;
+    reply = client.uploadFile(upload, QUrl::fromLocalFile(QStringLiteral(TEST_FILE_PATH)));
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(reply->data()["status"].toString(), QStringLiteral("complete"));
+    const QString fileId = reply->data()["id"].toString();
+
+    QJsonObject attached = _server.objects(QStringLiteral("objects.files")).first().toObject();
+    QCOMPARE(attached["fileAttachment"].toObject()["id"].toString(), fileId);
+
+    QFile expected(QStringLiteral(TEST_FILE_PATH));
+    QVERIFY(expected.open(QIODevice::ReadOnly));
+    client.setDownloadSegmentSize(1024);
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    QJsonObject download;
+    download["id"] = fileId;
+    reply = client.downloadFile(download, &buffer);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(buffer.data(), expected.readAll());
+}
+
+void tst_MockServer::downloadIgnoredRange()
+{
+    EnginioClient client;
+    prepareClient(&client);
+
+    QJsonObject object;
+    object["objectType"] = QStringLiteral("objects.files");
+    EnginioReply *reply = client.create(object);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+
+    QJsonObject target;
+    target["id"] = reply->data()["id"];
+    target["objectType"] = QStringLiteral("objects.files");
+    target["propertyName"] = QStringLiteral("fileAttachment");
+    QJsonObject file;
+    file["fileName"] = QStringLiteral("enginio.png");
+    QJsonObject upload;
+    upload["targetFileProperty"] = target;
+    upload["file"] = file;
+    reply = client.uploadFile(upload, QUrl::fromLocalFile(QStringLiteral(TEST_FILE_PATH)));
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+
+    QFile expectedFile(QStringLiteral(TEST_FILE_PATH));
+    QVERIFY(expectedFile.open(QIODevice::ReadOnly));
+    const QByteArray expected = expectedFile.readAll();
+
+    // the first segment tells the size, the parallel ones get the whole file
+    _server.setRangedResponses(1);
+    client.setDownloadSegmentSize(1024);
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    QJsonObject download;
+    download["id"] = reply->data()["id"];
+    reply = client.downloadFile(download, &buffer);
+    QSignalSpy progressSpy(reply, SIGNAL(progress(qint64,qint64)));
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(buffer.data(), expected);
+
+    QVERIFY(progressSpy.count());
+    foreach (const QList<QVariant> &progress, progressSpy)
+        QVERIFY(progress[0].value<qint64>() <= progress[1].value<qint64>());
+    QCOMPARE(progressSpy.last()[0].value<qint64>(), qint64(expected.size()));
+}
+
+void tst_MockServer::downloadToFile()
+{
+    EnginioClient client;
+    prepareClient(&client);
+
+    QJsonObject object;
+    object["objectType"] = QStringLiteral("objects.files");
+    EnginioReply *reply = client.create(object);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+
+    QJsonObject target;
+    target["id"] = reply->data()["id"];
+    target["objectType"] = QStringLiteral("objects.files");
+    target["propertyName"] = QStringLiteral("fileAttachment");
+    QJsonObject file;
+    file["fileName"] = QStringLiteral("enginio.png");
+    QJsonObject upload;
+    upload["targetFileProperty"] = target;
+    upload["file"] = file;
+    reply = client.uploadFile(upload, QUrl::fromLocalFile(QStringLiteral(TEST_FILE_PATH)));
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QJsonObject download;
+    download["id"] = reply->data()["id"];
+
+    QFile expectedFile(QStringLiteral(TEST_FILE_PATH));
+    QVERIFY(expectedFile.open(QIODevice::ReadOnly));
+    const QByteArray expected = expectedFile.readAll();
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.path() + QStringLiteral("/enginio.png");
+    const QString infoPath = path + QStringLiteral(".download");
+    QFile result(path);
+
+    // an unrelated file is overwritten, even if it is shorter
+    QVERIFY(result.open(QIODevice::WriteOnly));
+    QVERIFY(result.write(expected.left(expected.size() / 2).toUpper()) > 0);
+    result.close();
+    reply = client.downloadFile(download, QUrl::fromLocalFile(path));
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QVERIFY(result.open(QIODevice::ReadOnly));
+    QCOMPARE(result.readAll(), expected);
+    result.close();
+    QVERIFY(!QFile::exists(infoPath));
+
+    // a partial copy of the same file is resumed
+    QVERIFY(result.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    QVERIFY(result.write(expected.left(expected.size() / 2)) > 0);
+    result.close();
+    QFile info(infoPath);
+    QVERIFY(info.open(QIODevice::WriteOnly));
+    QJsonObject partial;
+    partial["id"] = download["id"];
+    partial["size"] = expected.size();
+    QVERIFY(info.write(QJsonDocument(partial).toJson()) > 0);
+    info.close();
+    const int requestCount = _server.requestCount();
+    reply = client.downloadFile(download, QUrl::fromLocalFile(path));
+    QSignalSpy progressSpy(reply, SIGNAL(progress(qint64,qint64)));
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QVERIFY(result.open(QIODevice::ReadOnly));
+    QCOMPARE(result.readAll(), expected);
+    result.close();
+    QVERIFY(!QFile::exists(infoPath));
+    // the download url is cached and only the second half was requested
+    QCOMPARE(_server.requestCount(), requestCount + 1);
+    QVERIFY(progressSpy.first()[0].value<qint64>() > expected.size() / 2);
+    QCOMPARE(progressSpy.last()[0].value<qint64>(), qint64(expected.size()));
+}
+
+void tst_MockServer::createWithFileFailure()
+{
+    EnginioClient client;
+    prepareClient(&client);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.path() + QStringLiteral("/test.png");
+    QVERIFY(QFile::copy(QStringLiteral(TEST_FILE_PATH), path));
+
+    QJsonObject object;
+    object["objectType"] = QStringLiteral("objects.todos");
+    object["title"] = QStringLiteral("Object Created With File");
+    EnginioReply *reply = client.createWithFile(object, QStringLiteral("fileAttachment"), QUrl::fromLocalFile(path));
+    // the file is gone when the object is created, so the upload fails
+    QVERIFY(QFile::remove(path));
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(reply->isError());
+
+    // the object is not left behind without its file
+    QTRY_COMPARE(_server.objects(QStringLiteral("objects.todos")).count(), 0);
+}
+
+void tst_MockServer::notifications()
+{
+    EnginioClient client;
+    prepareClient(&client);
+
+    EnginioBackendConnection connection;
+    QSignalSpy notificationSpy(&connection, SIGNAL(dataReceived(QJsonObject)));
+    QJsonObject filter;
+    filter["event"] = QStringLiteral("create");
+    connection.connectToBackend(&client, filter);
+    QTRY_VERIFY(connection.isConnected());
+
+    QSignalSpy pongSpy(&connection, SIGNAL(pong()));
+    connection.ping();
+    QTRY_VERIFY(pongSpy.count());
+
+    QJsonObject object;
+    object["objectType"] = QStringLiteral("objects.todos");
+    object["title"] = QStringLiteral("Notify me");
+    EnginioReply *reply = client.create(object);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+
+    // updates are filtered out
+    object["id"] = reply->data()["id"];
+    reply = client.update(object);
+    QTRY_VERIFY(reply->isFinished());
+
+    QTRY_COMPARE(notificationSpy.count(), 1);
+    QJsonObject message = notificationSpy[0][0].value<QJsonObject>();
+    QCOMPARE(message["messageType"].toString(), QStringLiteral("data"));
+    QCOMPARE(message["event"].toString(), QStringLiteral("create"));
+    QCOMPARE(message["data"].toObject()["title"], object["title"]);
+
+    connection.close(EnginioBackendConnection::NormalCloseStatus);
+    QTRY_VERIFY(!connection.isConnected());
+}
+
+void tst_MockServer::latency()
+{
+    _server.setLatency(100);
+    _server.setBandwidth(64 * 1024);
+
+    EnginioClient client;
+    prepareClient(&client);
+
+    QJsonObject query;
+    query["objectType"] = QStringLiteral("objects.todos");
+    QElapsedTimer timer;
+    timer.start();
+    EnginioReply *reply = client.query(query);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QVERIFY(timer.elapsed() >= 100);
+}
+
+void tst_MockServer::metrics()
+{
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioMetrics *metrics = client.metrics();
+    QVERIFY(metrics);
+    QVERIFY(!metrics->isEnabled());
+
+    QJsonObject object;
+    object["objectType"] = QStringLiteral("objects.todos");
+    object["title"] = QStringLiteral("Buy milk");
+
+    // nothing is collected by default
+    EnginioReply *reply = client.create(object);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(metrics->requestCount(), 0);
+    QCOMPARE(metrics->bytesSent(), qint64(0));
+
+    metrics->setEnabled(true);
+    metrics->setTracing(true);
+    QSignalSpy traceSpy(metrics, SIGNAL(requestTraced(QJsonObject)));
+
+    reply = client.create(object);
+    QCOMPARE(metrics->inFlight(), 1);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+
+    QJsonObject query;
+    query["objectType"] = QStringLiteral("objects.todos");
+    reply = client.query(query);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+
+    object["id"] = QStringLiteral("doesNotExist");
+    reply = client.remove(object);
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(reply->isError());
+
+    QCOMPARE(metrics->requestCount(), 3);
+    QCOMPARE(metrics->errorCount(), 1);
+    QCOMPARE(metrics->inFlight(), 0);
+    QVERIFY(metrics->bytesSent() > 0);
+    QVERIFY(metrics->bytesReceived() > 0);
+
+    QJsonObject snapshot = metrics->snapshot();
+    QCOMPARE(snapshot["requests"].toDouble(), 3.0);
+    QJsonObject operations = snapshot["operations"].toObject();
+    QCOMPARE(operations["POST objects"].toObject()["count"].toDouble(), 1.0);
+    QCOMPARE(operations["GET objects"].toObject()["count"].toDouble(), 1.0);
+    QCOMPARE(operations["DELETE objects"].toObject()["errors"].toDouble(), 1.0);
+    QJsonArray buckets = operations["GET objects"].toObject()["latency"].toObject()["buckets"].toArray();
+    QCOMPARE(buckets.last().toObject()["le"].toString(), QStringLiteral("+Inf"));
+    QCOMPARE(buckets.last().toObject()["count"].toDouble(), 1.0);
+    QCOMPARE(snapshot["statuses"].toObject()["404"].toDouble(), 1.0);
+
+    QCOMPARE(traceSpy.count(), 3);
+    QJsonObject span = traceSpy[1][0].value<QJsonObject>();
+    QCOMPARE(span["operation"].toString(), QStringLiteral("GET objects"));
+    QCOMPARE(span["status"].toDouble(), 200.0);
+    QCOMPARE(span["attempts"].toDouble(), 1.0);
+    QVERIFY(span["sent"].toDouble() <= span["firstByte"].toDouble());
+    QVERIFY(span["firstByte"].toDouble() <= span["received"].toDouble());
+    QVERIFY(span["received"].toDouble() <= span["finished"].toDouble());
+
+    metrics->reset();
+    QCOMPARE(metrics->requestCount(), 0);
+    QVERIFY(metrics->snapshot()["operations"].toObject().isEmpty());
+}
+
+void tst_MockServer::debugInfo()
+{
+    const bool enableDebugInfo = gEnableEnginioDebugInfo;
+
+    {
+        gEnableEnginioDebugInfo = false;
+        EnginioClient client;
+        prepareClient(&client);
+        EnginioClientPrivate *d = EnginioClientPrivate::get(&client);
+
+        QJsonObject object;
+        object["objectType"] = QStringLiteral("objects.todos");
+        object["title"] = QStringLiteral("Buy milk");
+        EnginioReply *reply = client.create(object);
+        QCOMPARE(d->_requestData.count(), 0);
+        QTRY_VERIFY(reply->isFinished());
+        CHECK_NO_ERROR(reply);
+    }
+
+    {
+        gEnableEnginioDebugInfo = true;
+        EnginioClient client;
+        prepareClient(&client);
+        EnginioClientPrivate *d = EnginioClientPrivate::get(&client);
+        d->_requestData.setLimits(2, 64, 100, 1);
+
+        QJsonObject object;
+        object["objectType"] = QStringLiteral("objects.todos");
+        object["title"] = QString(1000, QLatin1Char('x'));
+        QList<EnginioReply*> replies;
+        for (int i = 0; i < 3; ++i)
+            replies.append(client.create(object));
+
+        // only the latest payloads are kept, truncated to the limits
+        QCOMPARE(d->_requestData.count(), 1);
+        QVERIFY(d->_requestData.totalSize() <= 100);
+        QVERIFY(d->_requestData.value(d->_replyReplyMap.key(replies[0])).isEmpty());
+        QCOMPARE(d->_requestData.value(d->_replyReplyMap.key(replies[2])).size(), 64 + 3);
+
+        foreach (EnginioReply *reply, replies) {
+            QTRY_VERIFY(reply->isFinished());
+            CHECK_NO_ERROR(reply);
+        }
+        QCOMPARE(d->_requestData.count(), 0);
+        QCOMPARE(d->_requestData.totalSize(), 0);
+
+        d->_requestData.setLimits(4, 1024, 4096, 2);
+        replies.clear();
+        for (int i = 0; i < 4; ++i)
+            replies.append(client.create(object));
+        QCOMPARE(d->_requestData.count(), 2);
+        foreach (EnginioReply *reply, replies)
+            QTRY_VERIFY(reply->isFinished());
+    }
+
+    gEnableEnginioDebugInfo = enableDebugInfo;
+}
+
+void tst_MockServer::requestTemplates()
+{
+    EnginioClient client;
+    prepareClient(&client);
+    EnginioClientPrivate *d = EnginioClientPrivate::get(&client);
+
+    QJsonObject object;
+    object["objectType"] = QStringLiteral("objects.todos");
+    object["title"] = QStringLiteral("Buy milk");
+    EnginioReply *reply = client.create(object);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(d->_requestTemplates.count(), 1);
+
+    object["id"] = reply->data()["id"].toString();
+    reply = client.update(object);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(d->_requestTemplates.count(), 1); // the id is appended to the template
+
+    // the templates carry the credentials, a change has to be visible in the next request
+    client.setBackendSecret(QByteArrayLiteral("wrong"));
+    QVERIFY(d->_requestTemplates.isEmpty());
+    reply = client.update(object);
+    QTRY_VERIFY(reply->isFinished());
+    QCOMPARE(reply->backendStatus(), 401);
+
+    client.setBackendSecret(QByteArrayLiteral("backendSecret"));
+    reply = client.update(object);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+
+    client.setServiceUrl(QUrl(QStringLiteral("http://127.0.0.1:1")));
+    QVERIFY(d->_requestTemplates.isEmpty());
+    reply = client.update(object);
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(reply->isError());
+    QCOMPARE(reply->errorType(), EnginioReply::NetworkError);
+}
+
+void tst_MockServer::compression()
+{
+    // the check value of http://reveng.sourceforge.net/crc-catalogue/17plus.htm#crc.cat.crc-32
+    QCOMPARE(EnginioClientPrivate::crc32(QByteArrayLiteral("123456789")), 0xCBF43926u);
+
+    // the deflate stream of the gzip member decoded by qUncompress, in a zlib stream
+    const QByteArray data = QJsonDocument(QJsonObject()).toJson() + QByteArray(1024, 'a') + "123456789";
+    const QByteArray gzip = EnginioClientPrivate::gzip(data);
+    QVERIFY(gzip.startsWith("\x1f\x8b\x08"));
+    quint32 a = 1, b = 0; // adler32
+    foreach (char c, data) {
+        a = (a + uchar(c)) % 65521;
+        b = (b + a) % 65521;
+    }
+    uchar size[4];
+    uchar adler[4];
+    qToBigEndian<quint32>(data.size(), size);
+    qToBigEndian<quint32>((b << 16) | a, adler);
+    const QByteArray zlib = QByteArray(reinterpret_cast<const char *>(size), 4) + "\x78\x9c"
+            + gzip.mid(10, gzip.size() - 18) + QByteArray(reinterpret_cast<const char *>(adler), 4);
+    QCOMPARE(qUncompress(zlib), data);
+    QCOMPARE(qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(gzip.constData()) + gzip.size() - 8), EnginioClientPrivate::crc32(data));
+
+    EnginioClient client;
+    prepareClient(&client);
+    client.setCompressionThreshold(256);
+    client.metrics()->setEnabled(true);
+    EnginioClientPrivate *d = EnginioClientPrivate::get(&client);
+
+    QJsonObject object;
+    object["objectType"] = QStringLiteral("objects.todos");
+    object["title"] = QString(1024, QLatin1Char('a'));
+    EnginioReply *reply = client.create(object);
+    QCOMPARE(d->_replyReplyMap.key(reply)->request().rawHeader("Content-Encoding"), QByteArrayLiteral("gzip"));
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(_server.objects("objects.todos").first().toObject()["title"].toString(), object["title"].toString());
+    QVERIFY(client.metrics()->compressionRatio() < 0.5);
+
+    // a small body is not worth it
+    object["id"] = reply->data()["id"].toString();
+    object["title"] = QStringLiteral("Buy milk");
+    reply = client.update(object);
+    QVERIFY(d->_replyReplyMap.key(reply)->request().rawHeader("Content-Encoding").isEmpty());
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(_server.objects("objects.todos").first().toObject()["title"].toString(), object["title"].toString());
+
+    QJsonObject compression = client.metrics()->snapshot()["compression"].toObject();
+    QCOMPARE(compression["requests"].toDouble(), 1.0);
+    QVERIFY(compression["requestBytesSent"].toDouble() < compression["requestBytes"].toDouble());
+    QCOMPARE(compression["responses"].toDouble(), 0.0);
+
+    // the responses are decoded by QNetworkAccessManager
+    _server.setCompressResponses(true);
+    QJsonObject query;
+    query["objectType"] = QStringLiteral("objects.todos");
+    reply = client.query(query);
+    QTRY_VERIFY(reply->isFinished());
+    CHECK_NO_ERROR(reply);
+    QCOMPARE(reply->data()["results"].toArray().first().toObject()["title"].toString(), object["title"].toString());
+    compression = client.metrics()->snapshot()["compression"].toObject();
+    QCOMPARE(compression["responses"].toDouble(), 1.0);
+    QVERIFY(compression["responseBytes"].toDouble() > 0);
+}
+
+void tst_MockServer::deltaSync()
+{
+    EnginioClient client;
+    prepareClient(&client);
+
+    const QString objectType = QStringLiteral("objects.todos");
+    QJsonObject object;
+    object["updatedAt"] = QStringLiteral("2014-01-01T10:00:00.000Z");
+    _server.createObject(objectType, object);
+
+    EnginioModel model;
+    model.setDeltaSync(true);
+    QJsonObject query;
+    query["objectType"] = objectType;
+    model.setQuery(query);
+    {
+        QSignalSpy spy(&model, SIGNAL(modelReset()));
+        model.setEnginio(&client);
+        QTRY_VERIFY(spy.count() > 0);
+    }
+    QCOMPARE(model.rowCount(), 1);
+
+    // one object more than fits into a page of changes, all with the same updatedAt
+    object["updatedAt"] = QStringLiteral("2014-01-01T10:00:01.000Z");
+    for (int i = 0; i < 101; ++i)
+        _server.createObject(objectType, object);
+
+    QSignalSpy resetSpy(&model, SIGNAL(modelReset()));
+    model.refresh();
+    QTRY_COMPARE(model.rowCount(), 102);
+    QCOMPARE(resetSpy.count(), 0);
+
+    QSet<QString> ids;
+    for (int row = 0; row < model.rowCount(); ++row)
+        ids.insert(model.data(model.index(row), EnginioModel::IdRole).value<QJsonValue>().toString());
+    QCOMPARE(ids.count(), 102);
+
+    // a failed refresh keeps the rows and reports the error
+    QSignalSpy errorSpy(&client, SIGNAL(error(EnginioReply*)));
+    _server.setBackend(QByteArrayLiteral("otherBackendId"), QByteArrayLiteral("otherBackendSecret"));
+    model.refresh();
+    QTRY_COMPARE(errorSpy.count(), 1);
+    QCOMPARE(model.rowCount(), 102);
+    _server.setBackend(QByteArrayLiteral("backendId"), QByteArrayLiteral("backendSecret"));
+
+    // without delta sync the model is reset
+    model.setDeltaSync(false);
+    model.refresh();
+    QTRY_COMPARE(resetSpy.count(), 1);
+    QCOMPARE(model.rowCount(), 102);
+}
+
+void tst_MockServer::deltaSyncLimit()
+{
+    EnginioClient client;
+    prepareClient(&client);
+
+    const QString objectType = QStringLiteral("objects.todos");
+    QJsonObject object;
+    object["updatedAt"] = QStringLiteral("2014-01-01T10:00:00.000Z");
+    for (int i = 0; i < 3; ++i)
+        _server.createObject(objectType, object);
+
+    EnginioModel model;
+    model.setDeltaSync(true);
+    QJsonObject query;
+    query["objectType"] = objectType;
+    query["limit"] = 2;
+    model.setQuery(query);
+    {
+        QSignalSpy spy(&model, SIGNAL(modelReset()));
+        model.setEnginio(&client);
+        QTRY_VERIFY(spy.count() > 0);
+    }
+    QCOMPARE(model.rowCount(), 2);
+
+    // the changes are not merged into a limited result, it is fetched again
+    object["updatedAt"] = QStringLiteral("2014-01-01T10:00:01.000Z");
+    for (int i = 0; i < 2; ++i)
+        _server.createObject(objectType, object);
+
+    QSignalSpy resetSpy(&model, SIGNAL(modelReset()));
+    model.refresh();
+    QTRY_COMPARE(resetSpy.count(), 1);
+    QCOMPARE(model.rowCount(), 2);
+}
+
+QTEST_MAIN(tst_MockServer)
+#include "tst_mockserver.moc"
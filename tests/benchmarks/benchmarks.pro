@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    enginioclient \
+    enginiomodel \
+    notifications
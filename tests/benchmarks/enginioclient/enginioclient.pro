@@ -0,0 +1,11 @@
+QT       += testlib enginio enginio-private
+QT       -= gui
+
+TARGET = tst_bench_enginioclient
+CONFIG   += console release
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += \
+    tst_bench_enginioclient.cpp
@@ -0,0 +1,389 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+
+#include <QtTest/QtTest>
+#include <QtCore/qobject.h>
+#include <QtCore/qbuffer.h>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qjsondocument.h>
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qurlquery.h>
+
+#include <Enginio/enginioclient.h>
+#include <Enginio/private/chunkdevice_p.h>
+#include <Enginio/private/enginioclient_p.h>
+#include <Enginio/private/enginiofakereply_p.h>
+#include <Enginio/private/enginioobjectadaptor_p.h>
+#include <Enginio/private/enginioqueryencoder_p.h>
+#include <Enginio/private/enginioreply_p.h>
+#include <Enginio/private/enginiostring_p.h>
+
+// Everything runs on local data, nothing is sent over the network.
+
+class tst_bench_EnginioClient: public QObject
+{
+    Q_OBJECT
+
+    static QJsonObject object(int propertyCount);
+    static QJsonObject queryResponse(int count);
+
+private slots:
+    void getPath_data();
+    void getPath();
+    void prepareRequest_data();
+    void prepareRequest();
+    void buildQueryUrl_data();
+    void buildQueryUrl();
+    void encodeQuery_data();
+    void encodeQuery();
+    void toJson_data();
+    void toJson();
+    void replyData_data();
+    void replyData();
+    void chunkDevice_data();
+    void chunkDevice();
+};
+
+QJsonObject tst_bench_EnginioClient::object(int propertyCount)
+{
+    QJsonObject result;
+    result["id"] = QStringLiteral("51cdbc08989e975ec300772a");
+    result["objectType"] = QStringLiteral("objects.todos");
+    result["createdAt"] = QStringLiteral("2013-06-28T16:33:12.803Z");
+    result["updatedAt"] = QStringLiteral("2013-06-28T16:33:12.803Z");
+    for (int i = 0; i < propertyCount; ++i) {
+        const QString name = QStringLiteral("property") + QString::number(i);
+        if (i % 3 == 0)
+            result[name] = i;
+        else if (i % 3 == 1)
+            result[name] = QStringLiteral("The value of property number ") + QString::number(i);
+        else
+            result[name] = bool(i % 2);
+    }
+    return result;
+}
+
+QJsonObject tst_bench_EnginioClient::queryResponse(int count)
+{
+    QJsonArray results;
+    for (int i = 0; i < count; ++i)
+        results.append(object(10));
+    QJsonObject response;
+    response["results"] = results;
+    return response;
+}
+
+void tst_bench_EnginioClient::getPath_data()
+{
+    QTest::addColumn<int>("operation");
+    QTest::addColumn<bool>("includeId");
+
+    QTest::newRow("object") << int(EnginioClientPrivate::ObjectOperation) << false;
+    QTest::newRow("object with id") << int(EnginioClientPrivate::ObjectOperation) << true;
+    QTest::newRow("acl") << int(EnginioClientPrivate::ObjectAclOperation) << false;
+    QTest::newRow("user") << int(EnginioClientPrivate::UserOperation) << false;
+    QTest::newRow("usergroup member") << int(EnginioClientPrivate::UsergroupMemberOperation) << false;
+    QTest::newRow("file") << int(EnginioClientPrivate::FileOperation) << false;
+    QTest::newRow("download url") << int(EnginioClientPrivate::FileGetDownloadUrlOperation) << false;
+    QTest::newRow("chunk") << int(EnginioClientPrivate::FileChunkUploadOperation) << false;
+}
+
+void tst_bench_EnginioClient::getPath()
+{
+    QFETCH(int, operation);
+    QFETCH(bool, includeId);
+
+    const QJsonObject data = object(0);
+    const ObjectAdaptor<QJsonObject> adaptor(data);
+    const EnginioClientPrivate::PathOptions flags = includeId ? EnginioClientPrivate::IncludeIdInPath : EnginioClientPrivate::Default;
+
+    QString path;
+    QByteArray errorMsg;
+    QBENCHMARK {
+        path.clear();
+        EnginioClientPrivate::getPath(adaptor, operation, &path, &errorMsg, flags);
+    }
+    QVERIFY(errorMsg.isEmpty());
+    QVERIFY(path.startsWith(QStringLiteral("/v1/")));
+}
+
+void tst_bench_EnginioClient::prepareRequest_data()
+{
+    QTest::addColumn<int>("operation");
+    QTest::addColumn<bool>("includeId");
+    QTest::addColumn<bool>("cached");
+
+    QTest::newRow("object") << int(EnginioClientPrivate::ObjectOperation) << false << true;
+    QTest::newRow("object, uncached") << int(EnginioClientPrivate::ObjectOperation) << false << false;
+    QTest::newRow("object with id") << int(EnginioClientPrivate::ObjectOperation) << true << true;
+    QTest::newRow("object with id, uncached") << int(EnginioClientPrivate::ObjectOperation) << true << false;
+    QTest::newRow("user") << int(EnginioClientPrivate::UserOperation) << false << true;
+    QTest::newRow("acl") << int(EnginioClientPrivate::ObjectAclOperation) << false << true;
+}
+
+void tst_bench_EnginioClient::prepareRequest()
+{
+    QFETCH(int, operation);
+    QFETCH(bool, includeId);
+    QFETCH(bool, cached);
+
+    EnginioClient client;
+    client.setBackendId(QByteArrayLiteral("5376033f5a3d8b1f2f00a1c9"));
+    client.setBackendSecret(QByteArrayLiteral("d6e7d3c8a3f9a1a8b1c5b8e0e7a8f1d3"));
+    EnginioClientPrivate *d = EnginioClientPrivate::get(&client);
+
+    const QJsonObject data = object(0);
+    const ObjectAdaptor<QJsonObject> adaptor(data);
+    const EnginioClientPrivate::PathOptions flags = includeId ? EnginioClientPrivate::IncludeIdInPath : EnginioClientPrivate::Default;
+
+    QNetworkRequest request;
+    QByteArray errorMsg;
+    QBENCHMARK {
+        if (!cached)
+            d->_requestTemplates.clear();
+        d->prepareRequest(&request, adaptor, operation, &errorMsg, flags);
+    }
+    QVERIFY(errorMsg.isEmpty());
+    QVERIFY(request.url().path().startsWith(QStringLiteral("/v1/")));
+    QCOMPARE(request.rawHeader("Enginio-Backend-Id"), client.backendId());
+}
+
+void tst_bench_EnginioClient::buildQueryUrl_data()
+{
+    QTest::addColumn<QJsonObject>("query");
+
+    QJsonObject query;
+    query["objectType"] = QStringLiteral("objects.todos");
+    QTest::newRow("objectType") << query;
+
+    query["limit"] = 100;
+    query["offset"] = 200;
+    query["sort"] = QJsonDocument::fromJson("[{\"sortBy\": \"createdAt\", \"direction\": \"desc\"}]").array();
+    QTest::newRow("paginated") << query;
+
+    query["query"] = QJsonDocument::fromJson(
+                "{\"title\": {\"$in\": [\"first\", \"second\", \"third\"]},"
+                " \"completed\": false,"
+                " \"createdAt\": {\"$gt\": {\"$type\": \"time\", \"$value\": \"2013-06-28T16:33:12.803Z\"}}}").object();
+    query["include"] = QJsonDocument::fromJson("{\"creator\": {}}").object();
+    query["fields"] = QJsonDocument::fromJson("[\"title\", \"completed\"]").array();
+    QTest::newRow("filtered") << query;
+}
+
+void tst_bench_EnginioClient::buildQueryUrl()
+{
+    QFETCH(QJsonObject, query);
+
+    // mirrors EnginioClientPrivate::query() up to the encoded url handed to QNetworkAccessManager
+    const ObjectAdaptor<QJsonObject> object(query);
+    const QUrl serviceUrl(QStringLiteral("https://api.engin.io"));
+    QByteArray encoded;
+    QBENCHMARK {
+        QUrl url(serviceUrl);
+        QString path;
+        QByteArray errorMsg;
+        EnginioClientPrivate::getPath(object, EnginioClientPrivate::ObjectOperation, &path, &errorMsg);
+        url.setPath(path);
+
+        QUrlQuery urlQuery;
+        if (int limit = object[EnginioString::limit].toInt())
+            urlQuery.addQueryItem(EnginioString::limit, QString::number(limit));
+        if (int offset = object[EnginioString::offset].toInt())
+            urlQuery.addQueryItem(EnginioString::offset, QString::number(offset));
+        ValueAdaptor<QJsonObject> include = object[EnginioString::include];
+        if (include.isComposedType())
+            urlQuery.addQueryItem(EnginioString::include, QString::fromUtf8(include.toJson()));
+        ValueAdaptor<QJsonObject> sort = object[EnginioString::sort];
+        if (sort.isComposedType())
+            urlQuery.addQueryItem(EnginioString::sort, QString::fromUtf8(sort.toJson()));
+        ValueAdaptor<QJsonObject> fields = object[EnginioString::fields];
+        if (fields.isComposedType())
+            urlQuery.addQueryItem(EnginioString::fields, QString::fromUtf8(fields.toJson()));
+        if (object[EnginioString::query].isComposedType())
+            urlQuery.addQueryItem(QStringLiteral("q"), QString::fromUtf8(object[EnginioString::query].toJson()));
+        url.setQuery(urlQuery);
+        encoded = url.toEncoded();
+    }
+    QVERIFY(encoded.startsWith("https://api.engin.io/v1/objects/todos"));
+}
+
+void tst_bench_EnginioClient::encodeQuery_data()
+{
+    QTest::addColumn<QJsonObject>("filter");
+    QTest::addColumn<bool>("direct");
+
+    QJsonObject filter = QJsonDocument::fromJson(
+                "{\"title\": \"Buy milk & bread\", \"completed\": false, \"priority\": {\"$gt\": 2.5}}").object();
+    QTest::newRow("small, QUrlQuery") << filter << false;
+    QTest::newRow("small, direct") << filter << true;
+
+    QJsonArray ids;
+    for (int i = 0; i < 500; ++i)
+        ids.append(QStringLiteral("51cdbc08989e975ec3") + QString::number(100000 + i));
+    QJsonObject in;
+    in["$in"] = ids;
+    filter = QJsonObject();
+    filter["id"] = in;
+    QTest::newRow("500 ids, QUrlQuery") << filter << false;
+    QTest::newRow("500 ids, direct") << filter << true;
+}
+
+void tst_bench_EnginioClient::encodeQuery()
+{
+    QFETCH(QJsonObject, filter);
+    QFETCH(bool, direct);
+
+    const QUrl serviceUrl(QStringLiteral("https://api.engin.io/v1/objects/todos"));
+    QByteArray encoded;
+    if (direct) {
+        QBENCHMARK {
+            QUrl url(serviceUrl);
+            EnginioQueryEncoder encoder;
+            encoder.addItem(QLatin1String("q"), QJsonValue(filter));
+            encoder.applyTo(&url);
+            encoded = url.toEncoded();
+        }
+    } else {
+        // the way EnginioClientPrivate::query() used to build the url
+        QBENCHMARK {
+            QUrl url(serviceUrl);
+            QUrlQuery urlQuery;
+            urlQuery.addQueryItem(QStringLiteral("q"), QString::fromUtf8(QJsonDocument(filter).toJson(QJsonDocument::Compact)));
+            url.setQuery(urlQuery);
+            encoded = url.toEncoded();
+        }
+    }
+
+    const QUrlQuery query(QUrl::fromEncoded(encoded));
+    const QString decoded = query.queryItemValue(QStringLiteral("q"), QUrl::FullyDecoded);
+    QCOMPARE(QJsonDocument::fromJson(decoded.toUtf8()).object(), filter);
+    if (direct) {
+        EnginioQueryEncoder encoder;
+        encoder.addItem(QLatin1String("q"), QJsonValue(filter));
+        QCOMPARE(QByteArray::fromPercentEncoding(encoder.encoded().mid(2)), QJsonDocument(filter).toJson(QJsonDocument::Compact));
+    }
+}
+
+void tst_bench_EnginioClient::toJson_data()
+{
+    QTest::addColumn<int>("propertyCount");
+    QTest::newRow("10 properties") << 10;
+    QTest::newRow("100 properties") << 100;
+    QTest::newRow("1000 properties") << 1000;
+}
+
+void tst_bench_EnginioClient::toJson()
+{
+    QFETCH(int, propertyCount);
+    const QJsonObject data = object(propertyCount);
+    const ObjectAdaptor<QJsonObject> adaptor(data);
+
+    QByteArray json;
+    QBENCHMARK {
+        json = adaptor.toJson();
+    }
+    QVERIFY(!json.isEmpty());
+}
+
+void tst_bench_EnginioClient::replyData_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1 object") << 1;
+    QTest::newRow("100 objects") << 100;
+    QTest::newRow("1000 objects") << 1000;
+}
+
+void tst_bench_EnginioClient::replyData()
+{
+    QFETCH(int, count);
+    const QByteArray json = QJsonDocument(queryResponse(count)).toJson(QJsonDocument::Compact);
+
+    EnginioClient client;
+    EnginioClientPrivate *clientPrivate = EnginioClientPrivate::get(&client);
+    EnginioFakeReply *networkReply = new EnginioFakeReply(clientPrivate, json, 200);
+    EnginioReplyPrivate reply(clientPrivate, networkReply);
+
+    QBENCHMARK {
+        networkReply->seek(0);
+        reply._data = QJsonObject();
+        QCOMPARE(reply.data()["results"].toArray().count(), count);
+    }
+}
+
+void tst_bench_EnginioClient::chunkDevice_data()
+{
+    QTest::addColumn<int>("chunkSize");
+    QTest::addColumn<int>("readSize");
+
+    // QNetworkAccessManager reads the upload data in blocks of 16kB
+    QTest::newRow("64kB chunks") << 64 * 1024 << 16 * 1024;
+    QTest::newRow("512kB chunks") << 512 * 1024 << 16 * 1024;
+    QTest::newRow("4MB chunks") << 4 * 1024 * 1024 << 16 * 1024;
+    QTest::newRow("4MB chunks, readAll") << 4 * 1024 * 1024 << 0;
+}
+
+void tst_bench_EnginioClient::chunkDevice()
+{
+    QFETCH(int, chunkSize);
+    QFETCH(int, readSize);
+
+    QByteArray file(16 * 1024 * 1024, 'e');
+    QBuffer source(&file);
+    QVERIFY(source.open(QIODevice::ReadOnly));
+    QByteArray block(readSize, Qt::Uninitialized);
+
+    qint64 total = 0;
+    QBENCHMARK {
+        total = 0;
+        for (qint64 start = 0; start < file.size(); start += chunkSize) {
+            ChunkDevice chunk(&source, start, chunkSize);
+            chunk.open(QIODevice::ReadOnly);
+            if (!readSize) {
+                total += chunk.readAll().size();
+                continue;
+            }
+            qint64 read;
+            while ((read = chunk.read(block.data(), qMin(qint64(readSize), chunk.bytesAvailable()))) > 0)
+                total += read;
+        }
+    }
+    QCOMPARE(total, qint64(file.size()));
+}
+
+QTEST_MAIN(tst_bench_EnginioClient)
+#include "tst_bench_enginioclient.moc"
@@ -0,0 +1,14 @@
+QT       += testlib network enginio enginio-private
+QT       -= gui
+
+TARGET = tst_bench_enginiomodel
+CONFIG   += console release
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += \
+    tst_bench_enginiomodel.cpp \
+    ../../auto/common/mockserver.cpp
+
+HEADERS += ../../auto/common/mockserver.h
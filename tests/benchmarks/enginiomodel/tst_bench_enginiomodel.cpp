@@ -0,0 +1,312 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qobject.h>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qabstractitemmodel.h>
+
+#include <Enginio/enginioclient.h>
+#include <Enginio/enginiomodel.h>
+#include <Enginio/enginiosortfilterproxymodel.h>
+#include <Enginio/private/enginiomodelattacheddata_p.h>
+#include <Enginio/private/enginiotimestamp_p.h>
+
+#include "../../auto/common/mockserver.h"
+
+// Exposes the objects the same way as EnginioModel, without a backend
+class ObjectListModel: public QAbstractListModel
+{
+    QJsonArray _objects;
+public:
+    explicit ObjectListModel(const QJsonArray &objects)
+        : _objects(objects)
+    {}
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE
+    {
+        return parent.isValid() ? 0 : _objects.count();
+    }
+
+    QVariant data(const QModelIndex &index, int role) const Q_DECL_OVERRIDE
+    {
+        if (role != Qt::DisplayRole || !index.isValid())
+            return QVariant();
+        return _objects.at(index.row());
+    }
+
+    void append(const QJsonObject &object)
+    {
+        beginInsertRows(QModelIndex(), _objects.count(), _objects.count());
+        _objects.append(object);
+        endInsertRows();
+    }
+};
+
+class tst_bench_EnginioModel: public QObject
+{
+    Q_OBJECT
+
+    QJsonArray objects(int count, qint64 start) const;
+
+private slots:
+    void timestamp_data();
+    void timestamp();
+    void bulkUpdate_data();
+    void bulkUpdate();
+    void proxySort_data();
+    void proxySort();
+    void proxyInsert();
+    void modelData_data();
+    void modelData();
+    void attachedData_data();
+    void attachedData();
+};
+
+QJsonArray tst_bench_EnginioModel::objects(int count, qint64 start) const
+{
+    QJsonArray result;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject object;
+        object.insert("id", QString::number(i));
+        object.insert("count", (i * 7919) % count);
+        object.insert("updatedAt", QDateTime::fromMSecsSinceEpoch(start + i * 1001).toUTC().toString("yyyy-MM-dd'T'HH:mm:ss.zzz'Z'"));
+        result.append(object);
+    }
+    return result;
+}
+
+void tst_bench_EnginioModel::timestamp_data()
+{
+    QTest::addColumn<bool>("qdatetime");
+    QTest::newRow("QDateTime") << true;
+    QTest::newRow("EnginioTimestamp") << false;
+}
+
+void tst_bench_EnginioModel::timestamp()
+{
+    QFETCH(bool, qdatetime);
+    const QString updatedAt = QStringLiteral("2013-05-29T11:51:04.123Z");
+    QCOMPARE(EnginioTimestamp::fromString(updatedAt), QDateTime::fromString(updatedAt, Qt::ISODate).toMSecsSinceEpoch());
+
+    qint64 result = 0;
+    if (qdatetime) {
+        QBENCHMARK {
+            result += QDateTime::fromString(updatedAt, Qt::ISODate).toMSecsSinceEpoch();
+        }
+    } else {
+        QBENCHMARK {
+            result += EnginioTimestamp::fromString(updatedAt);
+        }
+    }
+    QVERIFY(result);
+}
+
+void tst_bench_EnginioModel::bulkUpdate_data()
+{
+    // Every update response is checked against the cached object,
+    // the old version of the check parsed both updatedAt values.
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("qdatetime");
+    QTest::newRow("1000 QDateTime") << 1000 << true;
+    QTest::newRow("1000 EnginioTimestamp") << 1000 << false;
+    QTest::newRow("50000 QDateTime") << 50000 << true;
+    QTest::newRow("50000 EnginioTimestamp") << 50000 << false;
+}
+
+void tst_bench_EnginioModel::bulkUpdate()
+{
+    QFETCH(int, count);
+    QFETCH(bool, qdatetime);
+    const qint64 start = QDateTime::currentMSecsSinceEpoch();
+    const QJsonArray cached = objects(count, start);
+    const QJsonArray updates = objects(count, start + 500);
+
+    // rows are converted once when they are received
+    QVector<qint64> cachedUpdatedAt(count);
+    for (int i = 0; i < count; ++i)
+        cachedUpdatedAt[i] = EnginioTimestamp::fromJson(cached.at(i).toObject()["updatedAt"]);
+
+    int accepted = 0;
+    if (qdatetime) {
+        QBENCHMARK {
+            accepted = 0;
+            for (int i = 0; i < count; ++i) {
+                QDateTime currentUpdateAt = QDateTime::fromString(cached.at(i).toObject()["updatedAt"].toString(), Qt::ISODate);
+                QDateTime newUpdateAt = QDateTime::fromString(updates.at(i).toObject()["updatedAt"].toString(), Qt::ISODate);
+                if (!(newUpdateAt < currentUpdateAt))
+                    ++accepted;
+            }
+        }
+    } else {
+        QBENCHMARK {
+            accepted = 0;
+            for (int i = 0; i < count; ++i) {
+                if (!(EnginioTimestamp::fromJson(updates.at(i).toObject()["updatedAt"]) < cachedUpdatedAt.at(i)))
+                    ++accepted;
+            }
+        }
+    }
+    QCOMPARE(accepted, count);
+}
+
+void tst_bench_EnginioModel::proxySort_data()
+{
+    QTest::addColumn<QString>("property");
+    QTest::newRow("20000 numbers") << QStringLiteral("count");
+    QTest::newRow("20000 strings") << QStringLiteral("updatedAt");
+}
+
+void tst_bench_EnginioModel::proxySort()
+{
+    QFETCH(QString, property);
+    ObjectListModel model(objects(20000, QDateTime::currentMSecsSinceEpoch()));
+    EnginioSortFilterProxyModel proxy;
+    proxy.setSourceModel(&model);
+    proxy.setSortProperty(property);
+    QCOMPARE(proxy.rowCount(), 20000);
+
+    Qt::SortOrder order = Qt::AscendingOrder;
+    QBENCHMARK {
+        order = order == Qt::AscendingOrder ? Qt::DescendingOrder : Qt::AscendingOrder;
+        proxy.setSortOrder(order);
+    }
+}
+
+void tst_bench_EnginioModel::proxyInsert()
+{
+    const qint64 start = QDateTime::currentMSecsSinceEpoch();
+    ObjectListModel model(objects(20000, start));
+    EnginioSortFilterProxyModel proxy;
+    proxy.setSourceModel(&model);
+    proxy.setSortProperty("count");
+
+    int count = 0;
+    QBENCHMARK {
+        QJsonObject object;
+        object.insert("id", QString::number(20000 + count));
+        object.insert("count", (count * 104729) % 20000);
+        model.append(object);
+        ++count;
+    }
+    QCOMPARE(proxy.rowCount(), model.rowCount());
+}
+
+void tst_bench_EnginioModel::modelData_data()
+{
+    QTest::addColumn<QByteArray>("role");
+    QTest::newRow("_synced") << QByteArrayLiteral("_synced");
+    QTest::newRow("id") << QByteArrayLiteral("id");
+    QTest::newRow("updatedAt") << QByteArrayLiteral("updatedAt");
+    QTest::newRow("count") << QByteArrayLiteral("count");
+    QTest::newRow("title") << QByteArrayLiteral("title");
+}
+
+void tst_bench_EnginioModel::modelData()
+{
+    QFETCH(QByteArray, role);
+    const int count = 1000;
+
+    // the model is filled from the local mock server
+    EnginioTests::EnginioMockServer server;
+    QVERIFY(server.listen());
+    for (int i = 0; i < count; ++i) {
+        QJsonObject object;
+        object.insert("count", i);
+        object.insert("title", QStringLiteral("Title ") + QString::number(i));
+        server.createObject(QStringLiteral("objects.bench"), object);
+    }
+
+    EnginioClient client;
+    client.setBackendId(QByteArrayLiteral("backendId"));
+    client.setBackendSecret(QByteArrayLiteral("backendSecret"));
+    client.setServiceUrl(server.serviceUrl());
+
+    EnginioModel model;
+    QJsonObject query;
+    query.insert("objectType", QStringLiteral("objects.bench"));
+    model.setQuery(query);
+    model.setEnginio(&client);
+    QTRY_COMPARE(model.rowCount(), count);
+
+    const int roleId = model.roleNames().key(role, EnginioModel::InvalidRole);
+    QVERIFY(roleId != EnginioModel::InvalidRole);
+
+    QBENCHMARK {
+        for (int row = 0; row < count; ++row)
+            QVERIFY(model.data(model.index(row), roleId).isValid());
+    }
+}
+
+void tst_bench_EnginioModel::attachedData_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("100 rows") << 100;
+    QTest::newRow("1000 rows") << 1000;
+}
+
+void tst_bench_EnginioModel::attachedData()
+{
+    QFETCH(int, count);
+
+    // the lookups by row walk the container, as in EnginioModel
+    QBENCHMARK {
+        AttachedDataContainer container;
+        for (int row = 0; row < count; ++row)
+            container.ref(QString::number(row), row);
+        for (int row = 0; row < count; ++row) {
+            QVERIFY(container.contains(row));
+            container.ref(row);
+        }
+        for (int row = 0; row < count; ++row)
+            QCOMPARE(container.value(row).ref, 2u);
+        for (int row = count - 1; row >= 0; row -= 10)
+            container.updateAllDataAfterRow(row);
+        for (int row = 0; row < count; ++row) {
+            container.deref(QString::number(row));
+            container.deref(QString::number(row));
+        }
+        QVERIFY(container.isEmpty());
+    }
+}
+
+QTEST_MAIN(tst_bench_EnginioModel)
+#include "tst_bench_enginiomodel.moc"
@@ -0,0 +1,119 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+
+#include <QtTest/QtTest>
+#include <QtCore/qobject.h>
+#include <QtCore/qjsonobject.h>
+
+#include <Enginio/enginioclient.h>
+#include <Enginio/private/enginiobackendconnection_p.h>
+
+#include "../../auto/common/mockserver.h"
+
+// The WebSocket stream is served by the local mock server.
+
+class tst_bench_Notifications: public QObject
+{
+    Q_OBJECT
+
+    EnginioTests::EnginioMockServer _server;
+    EnginioClient _client;
+    EnginioBackendConnection _connection;
+
+private slots:
+    void initTestCase();
+    void encodeFrames();
+    void decodeFrames_data();
+    void decodeFrames();
+};
+
+void tst_bench_Notifications::initTestCase()
+{
+    QVERIFY(_server.listen());
+    _client.setBackendId(QByteArrayLiteral("backendId"));
+    _client.setBackendSecret(QByteArrayLiteral("backendSecret"));
+    _client.setServiceUrl(_server.serviceUrl());
+    _connection.connectToBackend(&_client);
+    QTRY_VERIFY(_connection.isConnected());
+}
+
+void tst_bench_Notifications::encodeFrames()
+{
+    // every ping is a masked frame written to the socket buffer
+    QSignalSpy pongSpy(&_connection, SIGNAL(pong()));
+    int count = 0;
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i)
+            _connection.ping();
+        count += 1000;
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(pongSpy.count(), count, 30000);
+}
+
+void tst_bench_Notifications::decodeFrames_data()
+{
+    QTest::addColumn<int>("size");
+
+    // each one uses a different payload length encoding
+    QTest::newRow("100 bytes") << 100;
+    QTest::newRow("10kB") << 10 * 1024;
+    QTest::newRow("100kB") << 100 * 1024;
+}
+
+void tst_bench_Notifications::decodeFrames()
+{
+    QFETCH(int, size);
+    const int count = 100;
+
+    QJsonObject object;
+    object["objectType"] = QStringLiteral("objects.todos");
+    object["title"] = QString(size, QLatin1Char('t'));
+
+    QSignalSpy notificationSpy(&_connection, SIGNAL(dataReceived(QJsonObject)));
+    QBENCHMARK {
+        notificationSpy.clear();
+        for (int i = 0; i < count; ++i)
+            _server.notify(QStringLiteral("create"), object);
+        while (notificationSpy.count() < count)
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    QCOMPARE(notificationSpy.last()[0].value<QJsonObject>()["data"].toObject()["title"], object["title"]);
+}
+
+QTEST_MAIN(tst_bench_Notifications)
+#include "tst_bench_notifications.moc"
@@ -0,0 +1,19 @@
+QT       += network enginio
+QT       -= gui
+
+TARGET = enginioload
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += \
+    main.cpp \
+    allocationcounter.cpp \
+    loadgenerator.cpp \
+    ../../tests/auto/common/mockserver.cpp
+
+HEADERS += \
+    allocationcounter.h \
+    loadgenerator.h \
+    ../../tests/auto/common/mockserver.h
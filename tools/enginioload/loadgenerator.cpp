@@ -0,0 +1,358 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#include "loadgenerator.h"
+#include "allocationcounter.h"
+
+#include <Enginio/enginioclient.h>
+#include <Enginio/enginioreply.h>
+
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qmetaobject.h>
+
+#include <cmath>
+
+LoadGenerator::Options::Options()
+    : objectType(QStringLiteral("objects.load"))
+    , requests(1000)
+    , concurrency(8)
+    , seed(100)
+    , payloadSize(64)
+    , uploadSize(16 * 1024)
+    , randomSeed(1)
+    , weights(OperationCount)
+{
+    weights[Create] = 30;
+    weights[Query] = 40;
+    weights[Update] = 15;
+    weights[Remove] = 10;
+    weights[Search] = 5;
+    weights[Upload] = 0;
+}
+
+LoadGenerator::Statistics::Statistics()
+    : count(0)
+    , errors(0)
+    , allocations(0)
+{}
+
+LoadGenerator::LoadGenerator(const Options &options, QObject *parent)
+    : QObject(parent)
+    , _options(options)
+    , _client(0)
+    , _seeded(0)
+    , _seedsFinished(0)
+    , _issued(0)
+    , _startTime(0)
+    , _endTime(0)
+    , _statistics(OperationCount)
+{
+    _options.weights.resize(OperationCount);
+    _options.concurrency = qMax(1, _options.concurrency);
+}
+
+LoadGenerator::~LoadGenerator()
+{}
+
+QString LoadGenerator::operationName(Operation operation)
+{
+    switch (operation) {
+    case Create: return QStringLiteral("create");
+    case Query: return QStringLiteral("query");
+    case Update: return QStringLiteral("update");
+    case Remove: return QStringLiteral("remove");
+    case Search: return QStringLiteral("search");
+    case Upload: return QStringLiteral("upload");
+    case OperationCount: break;
+    }
+    Q_UNREACHABLE();
+    return QString();
+}
+
+QStringList LoadGenerator::operationNames()
+{
+    QStringList names;
+    for (int i = 0; i < OperationCount; ++i)
+        names.append(operationName(Operation(i)));
+    return names;
+}
+
+bool LoadGenerator::start(QString *errorMessage)
+{
+    int totalWeight = 0;
+    foreach (int weight, _options.weights)
+        totalWeight += qMax(0, weight);
+    if (!totalWeight) {
+        *errorMessage = QStringLiteral("The operation mix is empty");
+        return false;
+    }
+
+    if (_options.weights[Upload] > 0) {
+        if (!_uploadFile.open()) {
+            *errorMessage = QStringLiteral("Can not create the upload file: ") + _uploadFile.errorString();
+            return false;
+        }
+        _uploadFile.write(QByteArray(_options.uploadSize, 'e'));
+        _uploadFile.close();
+    }
+
+    qsrand(_options.randomSeed);
+    _client = new EnginioClient(this);
+    _client->setBackendId(_options.backendId);
+    _client->setBackendSecret(_options.backendSecret);
+    _client->setServiceUrl(_options.serviceUrl);
+    connect(_client, SIGNAL(finished(EnginioReply*)), this, SLOT(replyFinished(EnginioReply*)));
+
+    _clock.start();
+    fill();
+    return true;
+}
+
+LoadGenerator::Operation LoadGenerator::pickOperation() const
+{
+    int totalWeight = 0;
+    foreach (int weight, _options.weights)
+        totalWeight += qMax(0, weight);
+
+    int value = qrand() % totalWeight;
+    for (int i = 0; i < OperationCount; ++i) {
+        value -= qMax(0, _options.weights[i]);
+        if (value < 0)
+            return Operation(i);
+    }
+    Q_UNREACHABLE();
+    return Create;
+}
+
+void LoadGenerator::fill()
+{
+    while (_pending.count() < _options.concurrency) {
+        if (_seeded < _options.seed) {
+            ++_seeded;
+            issue(Create, /* measured */ false);
+            continue;
+        }
+        if (_seedsFinished < _seeded || _issued >= _options.requests)
+            break; // the measurement starts when the seed objects exist
+
+        if (!_issued)
+            _startTime = _clock.nsecsElapsed();
+        ++_issued;
+        issue(pickOperation(), /* measured */ true);
+    }
+
+    if (_pending.isEmpty() && _issued >= _options.requests) {
+        _endTime = _clock.nsecsElapsed();
+        QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+    }
+}
+
+void LoadGenerator::issue(Operation operation, bool measured)
+{
+    // these operations need an existing object
+    if ((operation == Update || operation == Remove || operation == Upload) && _ids.isEmpty())
+        operation = Create;
+
+    PendingRequest request;
+    request.operation = operation;
+    request.measured = measured;
+
+    const int allocations = allocationCount();
+    request.start = _clock.nsecsElapsed();
+    EnginioReply *reply = send(operation);
+    if (measured)
+        _statistics[operation].allocations += allocationCount() - allocations;
+    _pending.insert(reply, request);
+}
+
+QJsonObject LoadGenerator::object() const
+{
+    QJsonObject object;
+    object[QStringLiteral("objectType")] = _options.objectType;
+    object[QStringLiteral("title")] = QStringLiteral("load ") + QString(_options.payloadSize, QLatin1Char('x'));
+    object[QStringLiteral("count")] = qrand() % 1000;
+    return object;
+}
+
+EnginioReply *LoadGenerator::send(Operation operation)
+{
+    switch (operation) {
+    case Create:
+        return _client->create(object());
+    case Query: {
+        QJsonObject query;
+        query[QStringLiteral("objectType")] = _options.objectType;
+        query[QStringLiteral("limit")] = 10;
+        return _client->query(query);
+    }
+    case Update: {
+        QJsonObject update = object();
+        update[QStringLiteral("id")] = _ids.at(qrand() % _ids.count());
+        return _client->update(update);
+    }
+    case Remove: {
+        QJsonObject remove;
+        remove[QStringLiteral("objectType")] = _options.objectType;
+        remove[QStringLiteral("id")] = _ids.takeAt(qrand() % _ids.count());
+        return _client->remove(remove);
+    }
+    case Search: {
+        QJsonArray objectTypes;
+        objectTypes.append(_options.objectType);
+        QJsonArray properties;
+        properties.append(QStringLiteral("title"));
+        QJsonObject phrase;
+        phrase[QStringLiteral("phrase")] = QStringLiteral("load*");
+        phrase[QStringLiteral("properties")] = properties;
+        QJsonObject search;
+        search[QStringLiteral("objectTypes")] = objectTypes;
+        search[QStringLiteral("search")] = phrase;
+        return _client->search(search);
+    }
+    case Upload: {
+        QJsonObject target;
+        target[QStringLiteral("id")] = _ids.at(qrand() % _ids.count());
+        target[QStringLiteral("objectType")] = _options.objectType;
+        target[QStringLiteral("propertyName")] = QStringLiteral("fileAttachment");
+        QJsonObject file;
+        file[QStringLiteral("fileName")] = QStringLiteral("enginioload.bin");
+        QJsonObject upload;
+        upload[QStringLiteral("targetFileProperty")] = target;
+        upload[QStringLiteral("file")] = file;
+        return _client->uploadFile(upload, QUrl::fromLocalFile(_uploadFile.fileName()));
+    }
+    case OperationCount:
+        break;
+    }
+    Q_UNREACHABLE();
+    return 0;
+}
+
+void LoadGenerator::replyFinished(EnginioReply *reply)
+{
+    QHash<EnginioReply *, PendingRequest>::iterator i = _pending.find(reply);
+    if (i == _pending.end())
+        return;
+    const PendingRequest request = i.value();
+    _pending.erase(i);
+    const qint64 latency = _clock.nsecsElapsed() - request.start;
+
+    // reading the response is a part of every request
+    const int allocations = allocationCount();
+    const QJsonObject data = reply->data();
+    const bool error = reply->isError();
+    if (!error && request.operation == Create)
+        _ids.append(data[QStringLiteral("id")].toString());
+
+    if (request.measured) {
+        Statistics &statistics = _statistics[request.operation];
+        statistics.allocations += allocationCount() - allocations;
+        statistics.latencies.append(latency);
+        ++statistics.count;
+        if (error)
+            ++statistics.errors;
+    } else {
+        ++_seedsFinished;
+    }
+
+    reply->deleteLater();
+    fill();
+}
+
+QJsonObject LoadGenerator::latencyReport(QVector<qint64> latencies)
+{
+    // nearest rank percentiles, in milliseconds
+    QJsonObject result;
+    if (latencies.isEmpty())
+        return result;
+
+    qSort(latencies);
+    const int count = latencies.count();
+    qint64 sum = 0;
+    foreach (qint64 latency, latencies)
+        sum += latency;
+
+    const double percentiles[] = { 0.5, 0.99, 0.999 };
+    const char * const names[] = { "p50", "p99", "p999" };
+    for (int i = 0; i < 3; ++i) {
+        const int index = qBound(0, int(std::ceil(percentiles[i] * count)) - 1, count - 1);
+        result[QString::fromLatin1(names[i])] = latencies.at(index) / 1e6;
+    }
+    result[QStringLiteral("max")] = latencies.last() / 1e6;
+    result[QStringLiteral("mean")] = double(sum) / count / 1e6;
+    return result;
+}
+
+QJsonObject LoadGenerator::report() const
+{
+    const double seconds = (_endTime - _startTime) / 1e9;
+
+    QJsonObject operations;
+    QVector<qint64> latencies;
+    int count = 0;
+    int errors = 0;
+    qint64 allocations = 0;
+    for (int i = 0; i < OperationCount; ++i) {
+        const Statistics &statistics = _statistics.at(i);
+        if (!statistics.count)
+            continue;
+        QJsonObject operation;
+        operation[QStringLiteral("count")] = statistics.count;
+        operation[QStringLiteral("errors")] = statistics.errors;
+        operation[QStringLiteral("throughput")] = seconds > 0 ? statistics.count / seconds : 0;
+        operation[QStringLiteral("latency")] = latencyReport(statistics.latencies);
+        operation[QStringLiteral("allocationsPerRequest")] = double(statistics.allocations) / statistics.count;
+        operations[operationName(Operation(i))] = operation;
+
+        latencies += statistics.latencies;
+        count += statistics.count;
+        errors += statistics.errors;
+        allocations += statistics.allocations;
+    }
+
+    QJsonObject result;
+    result[QStringLiteral("serviceUrl")] = _options.serviceUrl.toString();
+    result[QStringLiteral("concurrency")] = _options.concurrency;
+    result[QStringLiteral("requests")] = count;
+    result[QStringLiteral("errors")] = errors;
+    result[QStringLiteral("durationMs")] = seconds * 1000;
+    result[QStringLiteral("throughput")] = seconds > 0 ? count / seconds : 0; // requests per second
+    result[QStringLiteral("latency")] = latencyReport(latencies);
+    result[QStringLiteral("allocationsPerRequest")] = count ? double(allocations) / count : 0;
+    result[QStringLiteral("operations")] = operations;
+    return result;
+}
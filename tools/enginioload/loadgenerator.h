@@ -0,0 +1,147 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qtemporaryfile.h>
+#include <QtCore/qurl.h>
+#include <QtCore/qvector.h>
+
+class EnginioClient;
+class EnginioReply;
+
+/*
+  Keeps a fixed number of requests in flight against one EnginioClient, picking
+  the operation of every request at random from a weighted mix, and measures
+  the latency of each of them from the call until the finished signal.
+
+  Objects that can be updated, removed or get a file are created in advance
+  ("seed"), these requests are not measured.
+*/
+class LoadGenerator: public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Operation {
+        Create,
+        Query,
+        Update,
+        Remove,
+        Search,
+        Upload,
+        OperationCount
+    };
+
+    struct Options
+    {
+        Options();
+
+        QUrl serviceUrl;
+        QByteArray backendId;
+        QByteArray backendSecret;
+        QString objectType;
+        int requests;
+        int concurrency;
+        int seed;
+        int payloadSize; // bytes of the "title" property
+        int uploadSize; // bytes
+        uint randomSeed;
+        QVector<int> weights; // by Operation
+    };
+
+    explicit LoadGenerator(const Options &options, QObject *parent = 0);
+    ~LoadGenerator();
+
+    static QString operationName(Operation operation);
+    static QStringList operationNames();
+
+    bool start(QString *errorMessage);
+    QJsonObject report() const;
+
+signals:
+    void finished();
+
+private slots:
+    void replyFinished(EnginioReply *reply);
+
+private:
+    struct PendingRequest
+    {
+        Operation operation;
+        qint64 start; // ns
+        bool measured;
+    };
+
+    struct Statistics
+    {
+        Statistics();
+
+        int count;
+        int errors;
+        qint64 allocations;
+        QVector<qint64> latencies; // ns
+    };
+
+    Operation pickOperation() const;
+    void issue(Operation operation, bool measured);
+    EnginioReply *send(Operation operation);
+    void fill();
+    QJsonObject object() const;
+    static QJsonObject latencyReport(QVector<qint64> latencies);
+
+    Options _options;
+    EnginioClient *_client;
+    QTemporaryFile _uploadFile;
+    QElapsedTimer _clock;
+    QHash<EnginioReply *, PendingRequest> _pending;
+    QStringList _ids;
+    int _seeded;
+    int _seedsFinished;
+    int _issued;
+    qint64 _startTime; // ns
+    qint64 _endTime; // ns
+    QVector<Statistics> _statistics; // by Operation
+};
+
+#endif // LOADGENERATOR_H
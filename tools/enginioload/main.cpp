@@ -0,0 +1,188 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://qt.digia.com/contact-us
+**
+** This file is part of the Enginio Qt Client Library.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+****************************************************************************/
+
+#include "loadgenerator.h"
+#include "../../tests/auto/common/mockserver.h"
+
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qjsondocument.h>
+#include <QtCore/qtextstream.h>
+
+static const char usage[] =
+        "Usage: enginioload [options]\n"
+        "Sends a mix of requests through one EnginioClient and prints the throughput,\n"
+        "latency percentiles and allocation counts as JSON.\n"
+        "\n"
+        "  --url <url>                 service url, https://api.engin.io by default\n"
+        "  --backend-id <id>\n"
+        "  --backend-secret <secret>\n"
+        "  --stub                      use a mock backend running in this process\n"
+        "  --stub-latency <ms>         latency of every request to the mock backend\n"
+        "  --stub-bandwidth <bytes/s>  bandwidth of the mock backend, unlimited by default\n"
+        "  --requests <count>          number of measured requests, 1000 by default\n"
+        "  --concurrency <count>       requests in flight, 8 by default\n"
+        "  --seed <count>              objects created before the measurement, 100 by default\n"
+        "  --mix <operation=weight,...> relative frequency of create, query, update, remove,\n"
+        "                              search and upload, create=30,query=40,update=15,\n"
+        "                              remove=10,search=5 by default\n"
+        "  --object-type <type>        objects.load by default\n"
+        "  --payload-size <bytes>      size of the title of created objects, 64 by default\n"
+        "  --upload-size <bytes>       size of uploaded files, 16384 by default\n"
+        "  --random-seed <number>\n"
+        "  --output <file>             write the report to a file instead of stdout\n";
+
+static bool parseMix(const QString &mix, QVector<int> *weights)
+{
+    const QStringList operations = LoadGenerator::operationNames();
+    weights->fill(0, LoadGenerator::OperationCount);
+    foreach (const QString &item, mix.split(QLatin1Char(','), QString::SkipEmptyParts)) {
+        const QStringList pair = item.split(QLatin1Char('='));
+        const int operation = operations.indexOf(pair.first().trimmed());
+        bool ok;
+        const int weight = pair.value(1).toInt(&ok);
+        if (pair.count() != 2 || operation == -1 || !ok || weight < 0)
+            return false;
+        (*weights)[operation] = weight;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream err(stderr);
+
+    LoadGenerator::Options options;
+    options.serviceUrl = QUrl(QStringLiteral("https://api.engin.io"));
+    bool stub = false;
+    int stubLatency = 0;
+    qint64 stubBandwidth = 0;
+    QString output;
+
+    const QStringList arguments = app.arguments();
+    for (int i = 1; i < arguments.count(); ++i) {
+        const QString argument = arguments.at(i);
+        if (argument == QStringLiteral("--help") || argument == QStringLiteral("-h")) {
+            QTextStream(stdout) << usage;
+            return 0;
+        }
+        if (argument == QStringLiteral("--stub")) {
+            stub = true;
+            continue;
+        }
+        if (i + 1 == arguments.count() || !argument.startsWith(QStringLiteral("--"))) {
+            err << "Invalid argument: " << argument << "\n\n" << usage;
+            return 1;
+        }
+
+        const QString value = arguments.at(++i);
+        bool ok = true;
+        if (argument == QStringLiteral("--url"))
+            options.serviceUrl = QUrl(value);
+        else if (argument == QStringLiteral("--backend-id"))
+            options.backendId = value.toUtf8();
+        else if (argument == QStringLiteral("--backend-secret"))
+            options.backendSecret = value.toUtf8();
+        else if (argument == QStringLiteral("--stub-latency"))
+            stubLatency = value.toInt(&ok);
+        else if (argument == QStringLiteral("--stub-bandwidth"))
+            stubBandwidth = value.toLongLong(&ok);
+        else if (argument == QStringLiteral("--requests"))
+            options.requests = value.toInt(&ok);
+        else if (argument == QStringLiteral("--concurrency"))
+            options.concurrency = value.toInt(&ok);
+        else if (argument == QStringLiteral("--seed"))
+            options.seed = value.toInt(&ok);
+        else if (argument == QStringLiteral("--mix"))
+            ok = parseMix(value, &options.weights);
+        else if (argument == QStringLiteral("--object-type"))
+            options.objectType = value;
+        else if (argument == QStringLiteral("--payload-size"))
+            options.payloadSize = value.toInt(&ok);
+        else if (argument == QStringLiteral("--upload-size"))
+            options.uploadSize = value.toInt(&ok);
+        else if (argument == QStringLiteral("--random-seed"))
+            options.randomSeed = value.toUInt(&ok);
+        else if (argument == QStringLiteral("--output"))
+            output = value;
+        else
+            ok = false;
+
+        if (!ok) {
+            err << "Invalid value for " << argument << ": " << value << "\n\n" << usage;
+            return 1;
+        }
+    }
+
+    EnginioTests::EnginioMockServer server;
+    if (stub) {
+        if (!server.listen()) {
+            err << "Can not start the mock backend: " << server.errorString() << '\n';
+            return 1;
+        }
+        server.setLatency(stubLatency);
+        server.setBandwidth(stubBandwidth);
+        options.serviceUrl = server.serviceUrl();
+        if (options.backendId.isEmpty())
+            options.backendId = QByteArrayLiteral("enginioload");
+        if (options.backendSecret.isEmpty())
+            options.backendSecret = QByteArrayLiteral("enginioload");
+    }
+
+    LoadGenerator generator(options);
+    QObject::connect(&generator, SIGNAL(finished()), &app, SLOT(quit()));
+    QString errorMessage;
+    if (!generator.start(&errorMessage)) {
+        err << errorMessage << '\n';
+        return 1;
+    }
+    app.exec();
+
+    const QByteArray report = QJsonDocument(generator.report()).toJson();
+    if (output.isEmpty()) {
+        QTextStream(stdout) << report;
+        return 0;
+    }
+
+    QFile file(output);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(report) != report.size()) {
+        err << "Can not write " << output << ": " << file.errorString() << '\n';
+        return 1;
+    }
+    return 0;
+}